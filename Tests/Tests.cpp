@@ -9,6 +9,11 @@
 // **** Class stop_watch - Used for timing operations and processes.
 #include <chrono>
 #include <ctime>
+#include <atomic>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
 
 class stop_watch
 {
@@ -29,6 +34,28 @@ public:
 // ********************************
 
 
+// ********************************
+// **** Show where the time of the last process went.
+void print_stats(DSPPTR handle)
+{
+	DSP_SC_STATS s;
+	if (dsp_sc_get_stats(handle, s) != DSP_OK)
+		return;
+
+	std::cout << std::dec
+		<< "  read " << s.frames_read << " frames (" << s.bytes_read << " bytes), wrote "
+		<< s.frames_written << " frames (" << s.bytes_written << " bytes) in " << s.blocks << " blocks\n"
+		<< "  wall/cpu ms: read " << s.read_wall_ns / 1e6 << "/" << s.read_cpu_ns / 1e6
+		<< ", convert " << s.convert_wall_ns / 1e6 << "/" << s.convert_cpu_ns / 1e6
+		<< ", transpose " << s.transpose_wall_ns / 1e6 << "/" << s.transpose_cpu_ns / 1e6
+		<< ", write " << s.write_wall_ns / 1e6 << "/" << s.write_cpu_ns / 1e6
+		<< ", metadata " << s.metadata_wall_ns / 1e6 << "/" << s.metadata_cpu_ns / 1e6 << "\n"
+		<< "  total " << s.wall_ns / 1e6 << "/" << s.cpu_ns / 1e6 << " ms, peak buffers "
+		<< s.peak_buffer_bytes / 1024 << "KB, " << s.mb_per_sec << " MB/s\n" << std::hex;
+}
+// ********************************
+
+
 // ********************************
 // **** Test file splitting
 int test_split(char * input, char * output, int outfmt = 0)
@@ -133,6 +160,7 @@ int test_split(char * input, char * output, int outfmt = 0)
 	if (dsp_sc_do_split(handle) == DSP_OK)
 	{
 		std::cout << "ok. handle = 0x" << handle << "\n";
+		print_stats(handle);
 	}
 	else
 	{
@@ -452,6 +480,794 @@ exit_early:
 // ********************************
 
 
+// ********************************
+// **** Test splitting only a few selected channels using the routing map.
+int test_split_routes(char * input, int * channels, int count)
+{
+	// ********************************
+	// **** Initialize stop watch and display splash.
+	stop_watch t;
+	std::cout << "Test for routed splitting process:\n";
+	// ********************************
+
+
+	// ********************************
+	// **** Start a new split/combine process.
+	DSPPTR handle;
+	std::cout << "Calling dsp_sc_start(handle)...";
+	if (dsp_sc_start(handle) == DSP_OK)
+	{
+		std::cout << "ok. handle = 0x" << std::hex << handle << "\n";
+	}
+	else
+	{
+		std::cout << "error. Couldn't start...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Add input file
+	int Channels;
+	std::cout << "Calling dsp_sc_add_input(handle, \"" << input << "\", channels)...";
+	if (dsp_sc_add_input(handle, input, Channels) == DSP_OK)
+	{
+		std::cout << "ok. handle = 0x" << std::hex << handle << "," << std::dec << Channels << "\n";
+	}
+	else
+	{
+		std::cout << "Error.  Couldn't add input file \"" << input << "\"...\n";
+		char buf[1024];
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << buf << "\n";
+		goto exit_early;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Route each selected channel to its own mono file.
+	for (int i = 0; i < count; ++i)
+	{
+		std::cout << "Calling dsp_sc_add_route(handle, 0, " << std::dec << channels[i] << ", " << i << ", 0)...";
+		if (dsp_sc_add_route(handle, 0, channels[i], i, 0) == DSP_OK)
+		{
+			std::cout << "ok.\n";
+		}
+		else
+		{
+			std::cout << "Error.  Couldn't add route...\n";
+			char buf[1024];
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << buf << "\n";
+			goto exit_early;
+		}
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Do split
+	std::cout << "\nStarting timer section\n{\n";
+	t.start();
+	std::cout << "Calling dsp_sc_do_split(handle)...";
+	if (dsp_sc_do_split(handle) == DSP_OK)
+	{
+		std::cout << "ok. handle = 0x" << std::hex << handle << "\n";
+	}
+	else
+	{
+		std::cout << "Error.  Could not split...\n";
+		char buf[1024];
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << buf << "\n";
+		dsp_sc_end(handle);
+		return DSP_ERROR; // Return false on error.
+	}
+	t.end();
+	std::cout << "}\nStopped timer.  Elapsed time: " << t.elapsed_seconds<double>().count() << "s\n";
+	// ********************************
+
+
+	// ********************************
+	// **** End the split/combine process.
+exit_early:
+	std::cout << "Calling dsp_sc_end(handle)...";
+	if (dsp_sc_end(handle) == DSP_OK)
+	{
+		std::cout << "ok. handle = 0x" << handle << "\n";
+	}
+	else
+	{
+		std::cout << "Error.  Couldn't end...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+	// ********************************
+
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** Test splitting into multichannel stems using a channel grouping layout.
+int test_split_layout(char * input, int * groups, int count)
+{
+	stop_watch t;
+	std::cout << "Test for grouped splitting process:\n";
+
+	// ********************************
+	// **** Start a new split/combine process.
+	DSPPTR handle;
+	std::cout << "Calling dsp_sc_start(handle)...";
+	if (dsp_sc_start(handle) != DSP_OK)
+	{
+		std::cout << "error. Couldn't start...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+	std::cout << "ok. handle = 0x" << std::hex << handle << "\n";
+	// ********************************
+
+
+	// ********************************
+	// **** Add input file and set the layout.
+	int Channels;
+	char buf[1024];
+	std::cout << "Calling dsp_sc_add_input(handle, \"" << input << "\", channels)...";
+	if (dsp_sc_add_input(handle, input, Channels) != DSP_OK)
+	{
+		std::cout << "Error.  Couldn't add input file \"" << input << "\"...\n";
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << buf << "\n";
+		goto exit_early;
+	}
+	std::cout << "ok. channels = " << std::dec << Channels << "\n";
+
+	// A layout that leaves a channel out must be turned down.
+	if (Channels > 1)
+	{
+		int short_group = Channels - 1;
+		std::cout << "Calling dsp_sc_do_split(handle) with a layout of " << short_group << " channels...";
+		if (dsp_sc_set_split_layout(handle, &short_group, 1) != DSP_OK || dsp_sc_do_split(handle) == DSP_OK)
+		{
+			std::cout << "Error.  A layout that leaves a channel out was accepted.\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << "failed as it should: " << buf;
+	}
+
+	std::cout << "Calling dsp_sc_set_split_layout(handle, groups, " << count << ")...";
+	if (dsp_sc_set_split_layout(handle, groups, count) != DSP_OK)
+	{
+		std::cout << "Error.  Couldn't set layout...\n";
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << buf << "\n";
+		goto exit_early;
+	}
+	std::cout << "ok.\n";
+	// ********************************
+
+
+	// ********************************
+	// **** Do split
+	t.start();
+	std::cout << "Calling dsp_sc_do_split(handle)...";
+	if (dsp_sc_do_split(handle) != DSP_OK)
+	{
+		std::cout << "Error.  Could not split...\n";
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << buf << "\n";
+		dsp_sc_end(handle);
+		return DSP_ERROR; // Return false on error.
+	}
+	t.end();
+	std::cout << "ok.  Elapsed time: " << t.elapsed_seconds<double>().count() << "s\n";
+	// ********************************
+
+exit_early:
+	std::cout << "Calling dsp_sc_end(handle)...";
+	if (dsp_sc_end(handle) != DSP_OK)
+	{
+		std::cout << "Error.  Couldn't end...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+	std::cout << "ok.\n";
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** Test a fan-out.  Splits a file, writes a FLAC copy of it and measures its
+// **** levels with one read of the input.  A tap counts the frames it was given.
+void VBCALL count_tap(DSPPTR user, const float *samples, int channels, int64_t frames)
+{
+	*(int64_t *)user += frames;
+}
+
+int test_fanout(char * input, char * copy)
+{
+	stop_watch t;
+	DSPPTR handle;
+	int Channels;
+	int64_t tapped = 0;
+	char buf[1024];
+	std::cout << "Test for fan-out:\n";
+
+	if (dsp_sc_start(handle) != DSP_OK)
+	{
+		std::cout << "error. Couldn't start...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+	if (dsp_sc_add_input(handle, input, Channels) != DSP_OK ||
+		dsp_sc_add_copy_output(handle, copy, 0, 0) != DSP_OK ||
+		dsp_sc_add_tap(handle, count_tap, (DSPPTR)&tapped) != DSP_OK ||
+		dsp_sc_set_levels(handle, 1) != DSP_OK)
+	{
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << "Error.  " << buf << "\n";
+		dsp_sc_end(handle);
+		return DSP_ERROR; // Return false on error.
+	}
+
+	t.start();
+	std::cout << "Calling dsp_sc_do_split(handle)...";
+	if (dsp_sc_do_split(handle) != DSP_OK)
+	{
+		std::cout << "Error.  Could not split...\n";
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << buf << "\n";
+		dsp_sc_end(handle);
+		return DSP_ERROR; // Return false on error.
+	}
+	t.end();
+	std::cout << "ok.  Elapsed time: " << t.elapsed_seconds<double>().count() << "s\n";
+	print_stats(handle);
+
+	// The input was only read once.
+	DSP_SC_STATS s;
+	int ret = DSP_OK;
+	if (dsp_sc_get_stats(handle, s) == DSP_OK && s.frames_read != tapped)
+	{
+		std::cout << "Error.  Read " << std::dec << s.frames_read << " frames but the tap saw " << tapped << "\n";
+		ret = DSP_ERROR;
+	}
+
+	for (int i = 0; i < Channels; ++i)
+	{
+		double peak, rms;
+		if (dsp_sc_get_levels(handle, i, peak, rms) == DSP_OK)
+			std::cout << "  ch" << std::dec << i + 1 << " peak " << peak << ", rms " << rms << "\n";
+	}
+
+	dsp_sc_end(handle);
+	return ret;
+}
+// ********************************
+
+
+// ********************************
+// **** Where libsndfile says the samples of 'name' are.  The file is opened on a handle
+// **** of its own so a header written by the native writer is read back as is.
+int describe_file(char * name, int &Channels, int &FrameSize, int &MediaType, int64_t &dataOffset, int64_t &dataSize)
+{
+	DSPPTR handle;
+	char buf[1024];
+	if (dsp_sc_start(handle) != DSP_OK)
+	{
+		std::cout << "error. Couldn't start...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+
+	SF_BROADCAST_INFO bext;
+	int SampleSize, SampleRate, Float, ByteOrder, HasBWF;
+	int ret = dsp_sc_add_input_ex64(handle, name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+	if (ret != DSP_OK)
+	{
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << "Error.  Couldn't open \"" << name << "\"...\n" << buf << "\n";
+	}
+	dsp_sc_end(handle);
+	return ret;
+}
+
+// Split 'input' into one file per channel named by 'output'.  'segments' is passed to
+// dsp_sc_set_segments().
+int run_split(char * input, char * output, int outfmt, int segments, int &Channels)
+{
+	DSPPTR handle;
+	char buf[1024];
+	char outname[1024];
+	if (dsp_sc_start(handle) != DSP_OK)
+	{
+		std::cout << "error. Couldn't start...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+
+	int ret = dsp_sc_add_input(handle, input, Channels);
+	for (int i = 0; ret == DSP_OK && i < Channels; ++i)
+	{
+		sprintf_s(outname, sizeof(outname), output, i + 1);
+		ret = dsp_sc_add_output(handle, outname, outfmt, 0);
+	}
+	if (ret == DSP_OK)
+		ret = dsp_sc_set_segments(handle, segments);
+	if (ret == DSP_OK)
+		ret = dsp_sc_do_split(handle);
+	if (ret != DSP_OK)
+	{
+		dsp_sc_get_error(handle, buf, sizeof(buf));
+		std::cout << "Error.  Could not split \"" << input << "\"...\n" << buf << "\n";
+	}
+	dsp_sc_end(handle);
+	return ret;
+}
+
+// Compare 'frames' frames of 'bytes' bytes.  Frame f of 'a' starts 'a_stride' bytes after
+// frame f - 1 at 'a_offset', and the same for 'b'.
+bool compare_frames(char * a, int64_t a_offset, int64_t a_stride, char * b, int64_t b_offset, int64_t b_stride, int64_t bytes, int64_t frames)
+{
+	std::ifstream fa(a, std::ios::binary), fb(b, std::ios::binary);
+	fa.seekg(a_offset);
+	fb.seekg(b_offset);
+
+	const int64_t block = 65536;
+	std::vector<char> da, db;
+	for (int64_t f = 0; f < frames; f += block)
+	{
+		int64_t n = std::min(block, frames - f);
+		da.resize((size_t)(n * a_stride));
+		db.resize((size_t)(n * b_stride));
+		if (!fa.read(da.data(), da.size()) || !fb.read(db.data(), db.size()))
+			return false;
+		for (int64_t k = 0; k < n; ++k)
+		{
+			if (std::memcmp(&da[(size_t)(k * a_stride)], &db[(size_t)(k * b_stride)], (size_t)bytes) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+// ********************************
+// **** Test that splits are bit exact.  Outputs in the sample format of the input go
+// **** through the raw split and must hold exactly the bytes of their channel, both
+// **** as WAV and as RF64 written by the native writer.  libsndfile has to read back
+// **** the frame count of every one.  A converted split must come out the same with
+// **** and without segments.
+int test_split_exact(char * input, char * wav, char * rf64, char * serial, char * segmented)
+{
+	int Channels, FrameSize, MediaType;
+	int64_t dataOffset, dataSize;
+	char name[1024];
+	std::cout << "Test for bit exact splitting:\n";
+
+	if (describe_file(input, Channels, FrameSize, MediaType, dataOffset, dataSize) != DSP_OK)
+		return DSP_ERROR; // Return false on error.
+	int64_t bytes = FrameSize / Channels;
+	int64_t frames = dataSize / FrameSize;
+
+	// ********************************
+	// **** Raw split to WAV and RF64.
+	char * patterns[2] = { wav, rf64 };
+	for (int p = 0; p < 2; ++p)
+	{
+		int channels;
+		if (run_split(input, patterns[p], 0, 0, channels) != DSP_OK)
+			return DSP_ERROR; // Return false on error.
+
+		for (int i = 0; i < Channels; ++i)
+		{
+			int out_channels, out_frame_size, out_type;
+			int64_t out_offset, out_size;
+			sprintf_s(name, sizeof(name), patterns[p], i + 1);
+			if (describe_file(name, out_channels, out_frame_size, out_type, out_offset, out_size) != DSP_OK)
+				return DSP_ERROR; // Return false on error.
+
+			std::cout << "\"" << name << "\": " << std::dec << out_size / out_frame_size << " of " << frames << " frames";
+			if (out_channels != 1 || out_frame_size != bytes || out_size / out_frame_size != frames ||
+				(p == 1 && out_type != (SF_FORMAT_RF64 >> 16)))
+			{
+				std::cout << ".  Error.  libsndfile doesn't read back what was written.\n";
+				return DSP_ERROR; // Return false on error.
+			}
+			if (!compare_frames(input, dataOffset + i * bytes, FrameSize, name, out_offset, bytes, bytes, frames))
+			{
+				std::cout << ".  Error.  The samples differ from channel " << i + 1 << " of the input.\n";
+				return DSP_ERROR; // Return false on error.
+			}
+			std::cout << ", bit exact.\n";
+		}
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Converted split to floating-point WAV, serial and in segments.
+	int channels;
+	if (run_split(input, serial, 0x010000 + 0x0006, 1, channels) != DSP_OK ||
+		run_split(input, segmented, 0x010000 + 0x0006, 4, channels) != DSP_OK)
+		return DSP_ERROR; // Return false on error.
+
+	for (int i = 0; i < Channels; ++i)
+	{
+		char other[1024];
+		int a_channels, a_frame_size, a_type, b_channels, b_frame_size, b_type;
+		int64_t a_offset, a_size, b_offset, b_size;
+		sprintf_s(name, sizeof(name), serial, i + 1);
+		sprintf_s(other, sizeof(other), segmented, i + 1);
+		if (describe_file(name, a_channels, a_frame_size, a_type, a_offset, a_size) != DSP_OK ||
+			describe_file(other, b_channels, b_frame_size, b_type, b_offset, b_size) != DSP_OK)
+			return DSP_ERROR; // Return false on error.
+
+		if (a_size != b_size || a_frame_size != b_frame_size ||
+			!compare_frames(name, a_offset, a_frame_size, other, b_offset, b_frame_size, b_frame_size, a_size / a_frame_size))
+		{
+			std::cout << "Error.  \"" << other << "\" differs from \"" << name << "\".\n";
+			return DSP_ERROR; // Return false on error.
+		}
+	}
+	std::cout << "Segmented split matches the serial split.\n";
+	// ********************************
+
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** Benchmark the I/O engines.  Splits the same file with blocking writes and
+// **** with batched io_uring writes and prints the time for each.
+int bench_io_engine(char * input)
+{
+	stop_watch t;
+	const char *names[2] = { "blocking", "io_uring" };
+	std::cout << "Benchmark for I/O engines:\n";
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		DSPPTR handle;
+		int Channels;
+		char buf[1024];
+		if (dsp_sc_start(handle) != DSP_OK)
+		{
+			std::cout << "error. Couldn't start...\n";
+			return DSP_ERROR; // Return false on error.
+		}
+
+		if (dsp_sc_add_input(handle, input, Channels) != DSP_OK ||
+			dsp_sc_set_io_engine(handle, mode) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  " << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+
+		t.start();
+		if (dsp_sc_do_split(handle) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  Could not split...\n" << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+		t.end();
+		std::cout << names[mode] << ": " << std::dec << Channels << " outputs in " << t.elapsed_seconds<double>().count() << "s\n";
+
+		dsp_sc_end(handle);
+	}
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** Benchmark block sizes.  0 is the size picked from the cache sizes.
+int bench_block_size(char * input)
+{
+	stop_watch t;
+	const int sizes[7] = { 0, 256, 1024, 4096, 16384, 40320, 65536 };
+	std::cout << "Benchmark for block sizes:\n";
+
+	for (int i = 0; i < 7; ++i)
+	{
+		DSPPTR handle;
+		int Channels, Frames;
+		char buf[1024];
+		if (dsp_sc_start(handle) != DSP_OK)
+		{
+			std::cout << "error. Couldn't start...\n";
+			return DSP_ERROR; // Return false on error.
+		}
+
+		if (dsp_sc_add_input(handle, input, Channels) != DSP_OK ||
+			dsp_sc_set_block_frames(handle, sizes[i]) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  " << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+
+		t.start();
+		if (dsp_sc_do_split(handle) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  Could not split...\n" << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+		t.end();
+		dsp_sc_get_block_frames(handle, &Frames);
+		std::cout << ((sizes[i]) ? "fixed " : "auto ") << std::dec << Frames << " frames: " << t.elapsed_seconds<double>().count() << "s\n";
+
+		dsp_sc_end(handle);
+	}
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** Benchmark splitting to compressed files with one encoder thread per output
+// **** against encoding everything on the process thread.
+int bench_parallel_encode(char * input, char * output)
+{
+	stop_watch t;
+	const char *names[2] = { "serial", "parallel" };
+	std::cout << "Benchmark for parallel encoding:\n";
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		DSPPTR handle;
+		int Channels;
+		char buf[1024];
+		if (dsp_sc_start(handle) != DSP_OK)
+		{
+			std::cout << "error. Couldn't start...\n";
+			return DSP_ERROR; // Return false on error.
+		}
+
+		if (dsp_sc_add_input(handle, input, Channels) != DSP_OK ||
+			dsp_sc_set_parallel_encode(handle, mode) != DSP_OK ||
+			(mode == 0 && dsp_sc_set_writebehind(handle, 0) != DSP_OK))
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  " << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+
+		char outname[1024];
+		for (int i = 0; i < Channels; ++i)
+		{
+			sprintf_s(outname, sizeof(outname), output, i + 1);
+			if (dsp_sc_add_output(handle, outname, 0, 0) != DSP_OK)
+			{
+				dsp_sc_get_error(handle, buf, sizeof(buf));
+				std::cout << "Error.  " << buf << "\n";
+				dsp_sc_end(handle);
+				return DSP_ERROR; // Return false on error.
+			}
+		}
+
+		t.start();
+		if (dsp_sc_do_split(handle) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  Could not split...\n" << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+		t.end();
+		std::cout << names[mode] << ": " << std::dec << Channels << " outputs in " << t.elapsed_seconds<double>().count() << "s\n";
+
+		dsp_sc_end(handle);
+	}
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** Test for jobs.  Converts every file on its own handle through the job
+// **** scheduler, shows the progress while they run and cancels the last one.
+void VBCALL job_progress(DSPPTR user, int64_t done, int64_t total)
+{
+	// Called from the job threads.  Remember the most frames seen.
+	std::atomic<int64_t> &seen = *(std::atomic<int64_t> *)user;
+	int64_t last = seen;
+	while (done > last && !seen.compare_exchange_weak(last, done)) {}
+}
+
+int test_jobs(char * inputs[4], char * outputs[4])
+{
+	stop_watch t;
+	DSPPTR handles[4] = { 0 };
+	int jobs[4] = { 0 };
+	std::atomic<int64_t> seen[4];
+	int count = 0;
+	char buf[1024];
+	std::cout << "Test for jobs:\n";
+
+	// Small budget so the jobs have to share.
+	dsp_sc_set_memory_budget(16 * 1024 * 1024);
+
+	// One job at a time so the last one is still queued when it gets cancelled.
+	dsp_sc_set_job_workers(1);
+
+	t.start();
+	for (int i = 0; (i < 4) && (inputs[i] != nullptr); ++i, ++count)
+	{
+		int Channels;
+		seen[i] = 0;
+		if (dsp_sc_start(handles[i]) != DSP_OK)
+		{
+			std::cout << "error. Couldn't start...\n";
+			return DSP_ERROR; // Return false on error.
+		}
+		if (dsp_sc_add_input(handles[i], inputs[i], Channels) != DSP_OK ||
+			dsp_sc_add_output(handles[i], outputs[i], 0, 0) != DSP_OK ||
+			dsp_sc_set_progress(handles[i], job_progress, (DSPPTR)&seen[i]) != DSP_OK ||
+			dsp_sc_submit_convert(handles[i], jobs[i]) != DSP_OK)
+		{
+			dsp_sc_get_error(handles[i], buf, sizeof(buf));
+			std::cout << "Error.  " << buf << "\n";
+			for (int j = 0; j <= i; ++j)
+				dsp_sc_end(handles[j]);
+			return DSP_ERROR; // Return false on error.
+		}
+		std::cout << "Submitted job " << std::dec << jobs[i] << " for \"" << inputs[i] << "\"\n";
+	}
+
+	// A handle can only have one job at a time.
+	int extra = 0;
+	if (dsp_sc_submit_convert(handles[0], extra) == DSP_OK)
+		std::cout << "Error.  Second job on the same handle was accepted.\n";
+
+	// Only a job that is still queued is sure to end up cancelled.  One that got to
+	// run already may finish before it sees the cancel.
+	bool cancelled = false;
+	if (count > 1)
+	{
+		int status = DSP_JOB_UNKNOWN;
+		int64_t done = 0, total = 0;
+		dsp_sc_job_poll(jobs[count - 1], status, done, total);
+		cancelled = (status == DSP_JOB_QUEUED);
+		if (cancelled)
+			dsp_sc_job_cancel(jobs[count - 1]);
+	}
+
+	int ret = DSP_OK;
+	for (int i = 0; i < count; ++i)
+	{
+		int status = DSP_JOB_UNKNOWN;
+		int64_t done = 0, total = 0;
+		while (dsp_sc_job_wait(jobs[i], 100, status) == DSP_OK && (status == DSP_JOB_QUEUED || status == DSP_JOB_RUNNING))
+		{
+			dsp_sc_job_poll(jobs[i], status, done, total);
+			std::cout << "Job " << jobs[i] << ": " << done << " of " << total << " frames\n";
+		}
+
+		const char *names[6] = { "unknown", "queued", "running", "done", "failed", "cancelled" };
+		std::cout << "Job " << jobs[i] << " " << names[status] << ", callback saw " << seen[i] << " frames\n";
+		if (status == DSP_JOB_FAILED)
+		{
+			dsp_sc_get_error(handles[i], buf, sizeof(buf));
+			std::cout << buf << "\n";
+		}
+		if (status != ((i == count - 1 && cancelled) ? DSP_JOB_CANCELLED : DSP_JOB_DONE))
+			ret = DSP_ERROR;
+
+		dsp_sc_job_release(jobs[i]);
+		dsp_sc_end(handles[i]);
+	}
+	t.end();
+	std::cout << "Jobs took " << t.elapsed_seconds<double>().count() << "s\n";
+	dsp_sc_set_job_workers(0);
+
+	DSP_SC_MEMORY_STATS mem;
+	if (dsp_sc_get_memory_budget(mem) == DSP_OK)
+	{
+		std::cout << "Memory budget peak " << mem.peak / 1024 << "KB of " << mem.limit / 1024 << "KB, "
+			<< mem.waits << " waits (" << mem.wait_ns / 1e6 << " ms), " << mem.shrinks << " shrinks\n";
+		if (mem.in_use != 0)
+			ret = DSP_ERROR;
+	}
+	dsp_sc_set_memory_budget(0);
+	return ret;
+}
+// ********************************
+
+
+// ********************************
+// **** Test the job cache.  Converts the same files twice with a job cache.  The
+// **** second run should skip every file.
+int test_job_cache(char * inputs[4], char * outputs[4], char * cache)
+{
+	stop_watch t;
+	char buf[1024];
+	int64_t skipped[2] = { 0, 0 };
+	int count = 0;
+	std::cout << "Test for the job cache:\n";
+
+	for (int run = 0; run < 2; ++run)
+	{
+		DSPPTR handle;
+		if (dsp_sc_start(handle) != DSP_OK)
+		{
+			std::cout << "error. Couldn't start...\n";
+			return DSP_ERROR; // Return false on error.
+		}
+
+		count = 0;
+		bool ok = dsp_sc_set_job_cache(handle, cache, 0) == DSP_OK;
+		for (int i = 0; ok && (i < 4) && (inputs[i] != nullptr); ++i, ++count)
+		{
+			int Channels;
+			ok = dsp_sc_add_input(handle, inputs[i], Channels) == DSP_OK &&
+				dsp_sc_add_output(handle, outputs[i], 0, 0) == DSP_OK;
+		}
+
+		t.start();
+		if (!ok || dsp_sc_do_convert(handle) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  " << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+		t.end();
+
+		DSP_SC_STATS s;
+		if (dsp_sc_get_stats(handle, s) == DSP_OK)
+			skipped[run] = s.jobs_skipped;
+		std::cout << "Run " << std::dec << run + 1 << " took " << t.elapsed_seconds<double>().count()
+			<< "s, skipped " << skipped[run] << " of " << count << " files\n";
+
+		// Write the cache file now so a failure shows instead of passing silently at the end.
+		if (dsp_sc_save_job_cache(handle) != DSP_OK)
+		{
+			dsp_sc_get_error(handle, buf, sizeof(buf));
+			std::cout << "Error.  " << buf << "\n";
+			dsp_sc_end(handle);
+			return DSP_ERROR; // Return false on error.
+		}
+		dsp_sc_end(handle);
+	}
+	return (skipped[1] == count) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** Test a split on pool workers that are each kept on one core.  The pool is put
+// **** back to its default afterwards so the other tests don't depend on this one.
+int test_thread_pool(char * input, char * output)
+{
+	std::cout << "Test for pinned pool workers:\n";
+	if (dsp_sc_set_thread_pool(0, 1) != DSP_OK)
+	{
+		std::cout << "Error.  Couldn't pin the pool workers...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+
+	int ret = test_split(input, output);
+
+	if (dsp_sc_set_thread_pool(0, 0) != DSP_OK)
+	{
+		std::cout << "Error.  Couldn't put the pool back to its default...\n";
+		return DSP_ERROR; // Return false on error.
+	}
+	return ret;
+}
+// ********************************
+
+
 // ********************************
 // **** Main
 int _tmain(int argc, _TCHAR* argv[])
@@ -475,6 +1291,53 @@ int _tmain(int argc, _TCHAR* argv[])
 		"X:\\Projects\\test_data\\Media\\out\\26_489_T2_SR028009 (ch%d).aif"))
 		return 1;
 
+	// Routed split test.  Channels 3, 4 and 1 (zero based 2, 3 and 0) in that order.
+	{
+		int test_channels[3] = { 2, 3, 0 };
+		if (!test_split_routes(
+			"X:\\Projects\\test_data\\Media\\002143.wav",
+			test_channels, 3))
+			return 1;
+	}
+
+	// Grouped split test.  A stereo pair and two mono files.
+	{
+		int test_groups[3] = { 2, 1, 1 };
+		if (!test_split_layout(
+			"X:\\Projects\\test_data\\Media\\002143.wav",
+			test_groups, 3))
+			return 1;
+	}
+
+	// Fan-out test.  Split, FLAC copy and levels from one read.
+	if (!test_fanout(
+		"X:\\Projects\\test_data\\Media\\002143.wav",
+		"X:\\Projects\\test_data\\Media\\out\\002143 copy.flac"))
+		return 1;
+
+	// Bit exact split test.
+	if (!test_split_exact(
+		"X:\\Projects\\test_data\\Media\\26_489_T2_SR028009.WAV",
+		"X:\\Projects\\test_data\\Media\\out\\26_489_T2_SR028009 raw (ch%d).wav",
+		"X:\\Projects\\test_data\\Media\\out\\26_489_T2_SR028009 raw (ch%d).rf64",
+		"X:\\Projects\\test_data\\Media\\out\\26_489_T2_SR028009 serial (ch%d).wav",
+		"X:\\Projects\\test_data\\Media\\out\\26_489_T2_SR028009 segments (ch%d).wav"))
+		return 1;
+
+	// I/O engine benchmark.
+	if (!bench_io_engine("X:\\Projects\\test_data\\Media\\26_489_T2_SR028009.WAV"))
+		return 1;
+
+	// Block size benchmark.
+	if (!bench_block_size("X:\\Projects\\test_data\\Media\\26_489_T2_SR028009.WAV"))
+		return 1;
+
+	// Parallel encoding benchmark.
+	if (!bench_parallel_encode(
+		"X:\\Projects\\test_data\\Media\\26_489_T2_SR028009.WAV",
+		"X:\\Projects\\test_data\\Media\\out\\26_489_T2_SR028009 (ch%d).flac"))
+		return 1;
+
 	// Combine test 1
 	{
 		char * test_inputs[8] =
@@ -530,8 +1393,22 @@ int _tmain(int argc, _TCHAR* argv[])
 			"X:\\Projects\\test_data\\Media\\out\\mvi_1738x.aif",
 		};
 		test_convert(test_inputs, test_outputs);
+
+		// Same files as jobs.
+		if (!test_jobs(test_inputs, test_outputs))
+			return 1;
+
+		// Same files again through the job cache.
+		if (!test_job_cache(test_inputs, test_outputs, "X:\\Projects\\test_data\\Media\\out\\jobs.cache"))
+			return 1;
 	}
 
+	// Split test 1 again with pinned pool workers.
+	if (!test_thread_pool(
+		"X:\\Projects\\test_data\\Media\\002143.wav",
+		"X:\\Projects\\test_data\\Media\\out\\002143 pinned (ch%d).aif"))
+		return 1;
+
 	return 0;
 }
 // **** End Main
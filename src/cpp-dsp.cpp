@@ -5,6 +5,7 @@
 
 #include "cpp-dsp.h"
 #include "split-combine.h"
+#include "dsp_job_scheduler.h"
 
 // ******************************** ******************************** ********************************
 // ********************************
@@ -45,6 +46,98 @@ BOOL WINAPI DllMain(
 // ******************************** ******************************** ********************************
 
 
+// ********************************
+// **** Jobs submitted through the C interface.  One scheduler is shared by every
+// **** split/combine processor.  It is never destroyed since waiting for its jobs
+// **** while the DLL unloads would hang.
+static dsp::job_scheduler &get_jobs()
+{
+	static dsp::job_scheduler *jobs = new dsp::job_scheduler;
+	return *jobs;
+}
+
+// True while 'sc_this' has a job queued or running.  Everything but cancel, the job
+// calls and the statistics fails then, since the job uses the files, settings and
+// error string of 'sc_this' without a lock.
+static bool is_busy(dsp::dsp_split_combine *sc_this)
+{
+	return get_jobs().is_busy(sc_this);
+}
+
+// Queue 'process' to run on 'sc_this'.  Fails if it already has a job queued or running.
+static int submit_job(dsp::dsp_split_combine *sc_this, int &job, bool (dsp::dsp_split_combine::*process)())
+{
+	job = get_jobs().submit(
+		sc_this,
+		[sc_this, process]() { return (sc_this->*process)(); },
+		[sc_this](bool cancel) { sc_this->set_cancel(cancel); },
+		[sc_this](int64_t &done, int64_t &total) { sc_this->get_progress(done, total); });
+	return (job != 0) ? DSP_OK : DSP_ERROR;
+}
+
+// Copy the statistics of 'sc_this' into the plain struct of the C interface.
+static bool get_stats_c(dsp::dsp_split_combine *sc_this, DSP_SC_STATS &stats)
+{
+	dsp::process_stats s;
+	if (!sc_this->get_stats(s))
+		return false;
+	stats.frames_read = s.frames_read;
+	stats.bytes_read = s.bytes_read;
+	stats.frames_written = s.frames_written;
+	stats.bytes_written = s.bytes_written;
+	stats.blocks = s.blocks;
+	stats.read_wall_ns = s.read.wall_ns;
+	stats.read_cpu_ns = s.read.cpu_ns;
+	stats.convert_wall_ns = s.convert.wall_ns;
+	stats.convert_cpu_ns = s.convert.cpu_ns;
+	stats.transpose_wall_ns = s.transpose.wall_ns;
+	stats.transpose_cpu_ns = s.transpose.cpu_ns;
+	stats.write_wall_ns = s.write.wall_ns;
+	stats.write_cpu_ns = s.write.cpu_ns;
+	stats.metadata_wall_ns = s.metadata.wall_ns;
+	stats.metadata_cpu_ns = s.metadata.cpu_ns;
+	stats.wall_ns = s.wall_ns;
+	stats.cpu_ns = s.cpu_ns;
+	stats.peak_buffer_bytes = s.peak_buffer_bytes;
+	stats.mb_per_sec = s.mb_per_sec;
+	stats.budget_waits = s.budget_waits;
+	stats.budget_shrinks = s.budget_shrinks;
+	stats.jobs_skipped = s.jobs_skipped;
+	return true;
+}
+
+// Copy the counters of the memory budget shared by every process.
+static bool get_memory_budget_c(DSP_SC_MEMORY_STATS &stats)
+{
+	dsp::memory_budget_stats s = dsp::get_memory_budget().get_stats();
+	stats.limit = s.limit;
+	stats.in_use = s.in_use;
+	stats.peak = s.peak;
+	stats.leases = s.leases;
+	stats.waits = s.waits;
+	stats.wait_ns = s.wait_ns;
+	stats.shrinks = s.shrinks;
+	return true;
+}
+
+// Set or remove the progress callback of 'sc_this'.
+static bool set_progress_callback(dsp::dsp_split_combine *sc_this, dsp_progress_callback callback, DSPPTR user)
+{
+	if (callback == nullptr)
+		return sc_this->set_progress(nullptr);
+	return sc_this->set_progress([callback, user](int64_t done, int64_t total) { callback(user, done, total); });
+}
+
+// Add a tap of 'sc_this' that calls 'callback'.
+static bool add_tap_callback(dsp::dsp_split_combine *sc_this, dsp_tap_callback callback, DSPPTR user)
+{
+	if (callback == nullptr)
+		return sc_this->add_tap(nullptr);
+	return sc_this->add_tap([callback, user](const float *samples, int channels, int64_t frames) { callback(user, samples, channels, frames); });
+}
+// ********************************
+
+
 
 /*
 // ********************************
@@ -86,6 +179,7 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
 		if (_this)
 		{
+			get_jobs().remove_owner(sc_this);
 			delete sc_this;
 			_this = 0;
 			return DSP_OK;
@@ -102,6 +196,8 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 //		#pragma EXPORT_ALIASX(dsp_sc_clear)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
 		ret = sc_this->clear();
 		return (ret) ? DSP_OK : DSP_ERROR;
 	}
@@ -129,6 +225,8 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 //		#pragma EXPORT_ALIASX(dsp_sc_add_input_ex)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
 		ret = sc_this->add_input_ex(
 			name,		// Path to and name of file.
 			Channels,	// Total number of channels.
@@ -155,6 +253,8 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 //		#pragma EXPORT_ALIASX(dsp_sc_add_input)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
 		ret = sc_this->add_input(name, channels);
 		return (ret) ? DSP_OK : DSP_ERROR;
 	}
@@ -168,6 +268,8 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 //		#pragma EXPORT_ALIASX(dsp_sc_add_output)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
 		ret = sc_this->add_output(name, fmtcodec, rate);
 		return (ret) ? DSP_OK : DSP_ERROR;
 	}
@@ -181,6 +283,12 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 	{
 //		#pragma EXPORT_ALIASX(dsp_sc_get_error)
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+		{
+			if (size > 0)
+				buf[0] = 0;
+			return DSP_ERROR;
+		}
 
 		const char *tmp = sc_this->get_error_str();
 		int i;
@@ -194,202 +302,1407 @@ CPP_DSP_API_VB int VBCALL dsp_sc_(DSPPTR _this)
 
 
 	// ********************************
-	// **** dsp_sc_do_split
-	int VBCALL dsp_sc_interface::do_split(DSPPTR _this)
+	// **** dsp_sc_add_route - route an input file channel to an output file channel.
+	int VBCALL dsp_sc_interface::add_route(DSPPTR _this, int src_file, int src_ch, int dst_file, int dst_ch)
 	{
-//		#pragma EXPORT_ALIASX(dsp_sc_do_split)
+//		#pragma EXPORT_ALIASX(dsp_sc_add_route)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-		ret = sc_this->do_split();
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->add_route(src_file, src_ch, dst_file, dst_ch);
 		return (ret) ? DSP_OK : DSP_ERROR;
 	}
 	// ********************************
 
 
 	// ********************************
-	// **** dsp_sc_do_combine
-	int VBCALL dsp_sc_interface::do_combine(DSPPTR _this)
+	// **** dsp_sc_clear_routes - remove all channel routes.
+	int VBCALL dsp_sc_interface::clear_routes(DSPPTR _this)
 	{
-//		#pragma EXPORT_ALIASX(dsp_sc_do_combine)
+//		#pragma EXPORT_ALIASX(dsp_sc_clear_routes)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-		ret = sc_this->do_combine();
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->clear_routes();
 		return (ret) ? DSP_OK : DSP_ERROR;
 	}
 	// ********************************
 
 
 	// ********************************
-	// **** dsp_sc_do_convert
-	int VBCALL dsp_sc_interface::do_convert(DSPPTR _this)
+	// **** dsp_sc_set_split_layout - set the channel grouping for split.
+	int VBCALL dsp_sc_interface::set_split_layout(DSPPTR _this, const int *groups, int count)
 	{
-//		#pragma EXPORT_ALIASX(dsp_sc_do_convert)
+//		#pragma EXPORT_ALIASX(dsp_sc_set_split_layout)
 		bool ret = true;
 		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-		ret = sc_this->do_convert();
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_split_layout(groups, count);
 		return (ret) ? DSP_OK : DSP_ERROR;
 	}
 	// ********************************
-//};
 
-CPP_DSP_API dsp_sc_interface sc_interface;
 
-// **** dsp_sc_interface
-// ********************************
+	// ********************************
+	// **** dsp_sc_set_readahead - set how far ahead inputs are read.
+	int VBCALL dsp_sc_interface::set_readahead(DSPPTR _this, int depth, int block_frames)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_readahead)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_readahead(depth, block_frames);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
 
-#if 1
-// ********************************
-// **** dsp_sc_start - To allocate a special split/combine processor.
-CPP_DSP_API_VB int VBCALL dsp_sc_start(DSPPTR &_this)
-{
-#pragma EXPORT_ALIAS
-	dsp::dsp_split_combine *ret = new dsp::dsp_split_combine;
-	_this = ((DSPPTR)ret);
-	return (ret != nullptr) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
+	// ********************************
+	// **** dsp_sc_set_writebehind - set how many blocks are queued behind each output.
+	int VBCALL dsp_sc_interface::set_writebehind(DSPPTR _this, int depth)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_writebehind)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_writebehind(depth);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
 
-// ********************************
-// **** dsp_sc_end - Destroy the information assigned to the split/combine processor.
-CPP_DSP_API_VB int VBCALL dsp_sc_end(DSPPTR &_this)
-{
-#pragma EXPORT_ALIAS
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	if (_this)
+	// ********************************
+	// **** dsp_sc_set_io_engine - choose the I/O engine for uncompressed files.
+	int VBCALL dsp_sc_interface::set_io_engine(DSPPTR _this, int mode)
 	{
-		delete sc_this;
-		_this = 0;
-		return DSP_OK;
+//		#pragma EXPORT_ALIASX(dsp_sc_set_io_engine)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_io_engine(mode);
+		return (ret) ? DSP_OK : DSP_ERROR;
 	}
-	return DSP_ERROR;
-}
-// ********************************
+	// ********************************
 
 
-// ********************************
-// **** dsp_sc_clear - To allocate a special split/combine processor.
-CPP_DSP_API_VB int VBCALL dsp_sc_clear(DSPPTR &_this)
-{
-#pragma EXPORT_ALIAS
-	bool ret = true;
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	ret = sc_this->clear();
-	return (ret) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
+	// ********************************
+	// **** dsp_sc_add_input_stream - add an input read from a pipe or stream.
+	int VBCALL dsp_sc_interface::add_input_stream(DSPPTR _this, int fd, const char *name, int &channels)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_add_input_stream)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->add_input_stream(fd, name, channels);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
 
-// ********************************
-// **** dsp_sc_add_input - add an input file to the input list.
-CPP_DSP_API_VB int VBCALL dsp_sc_add_input_ex(
-	DSPPTR _this,
-	const char *name,			// Path to and name of file.
-	int &Channels,				// Total number of channels.
-	int &SampleSize,			// Bits per sample.
-	int &FrameSize,				// Size of a single frame of audio (Channels * BytesPerSample).
-	int &SampleRate,			// Sample rate.
-	int &Float,					// True or false. Changed to Float from mFormat.
-	int &ByteOrder,				// Endianness.
-	int &dataOffset,			// File offset of sample data
-	unsigned long &dataSize,	// Size of sample data in bytes
-	int &HasBWF,				// 0 for no BWF and 1 for has BWF
-	int &MediaType,				// 1 = wav, 2 = aif;
-	SF_BROADCAST_INFO &bext
-)
-{
-#pragma EXPORT_ALIAS
-	bool ret = true;
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	ret = sc_this->add_input_ex(
-		name,		// Path to and name of file.
-		Channels,	// Total number of channels.
-		SampleSize,	// Bits per sample.
-		FrameSize,	// Size of a single frame of audio (Channels * BytesPerSample).
-		SampleRate,	// Sample rate.
-		Float,		// Changed to Float from mFormat,// ???
-		ByteOrder,	// Endianness.
-		dataOffset,	// File offset of sample data
-		dataSize,	// Size of sample data in bytes
-		HasBWF,		// 0 for no BWF and 1 for has BWF
-		MediaType,	// 1 = wav, 2 = aif;
-		bext
-	);
-	return (ret) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
+	// ********************************
+	// **** dsp_sc_add_output_stream - add an output written to a pipe or stream.
+	int VBCALL dsp_sc_interface::add_output_stream(DSPPTR _this, int fd, const char *name, int fmtcodec, int rate)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_add_output_stream)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->add_output_stream(fd, name, fmtcodec, rate);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
 
-// ********************************
-// **** dsp_sc_add_input - add an input file to the input list.
-CPP_DSP_API_VB int VBCALL dsp_sc_add_input(DSPPTR _this, const char *name, int &channels)
-{
-#pragma EXPORT_ALIAS
-	bool ret = true;
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	ret = sc_this->add_input(name, channels);
-	return (ret) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
+	// ********************************
+	// **** dsp_sc_set_stream_window - set the ring buffer size in bytes for streams.
+	int VBCALL dsp_sc_interface::set_stream_window(DSPPTR _this, int window)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_stream_window)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_stream_window(window);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
 
-// ********************************
-// **** dsp_sc_add_output - add an output file to the output list.
-CPP_DSP_API_VB int VBCALL dsp_sc_add_output(DSPPTR _this, const char *name, int fmtcodec, int rate)
-{
-#pragma EXPORT_ALIAS
-	bool ret = true;
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	ret = sc_this->add_output(name, fmtcodec, rate);
-	return (ret) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
+	// ********************************
+	// **** dsp_sc_probe_input - same as dsp_sc_add_input_ex without adding the file.
+	int VBCALL dsp_sc_interface::probe_input(
+		DSPPTR _this,
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_probe_input)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->probe_input(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
 
-// ********************************
-// ****  dsp_sc_get_error - Fill the string buffer pointer to by 'buf' (of 'size')
-// **** with the contents of the error string.
-CPP_DSP_API_VB int VBCALL dsp_sc_get_error(DSPPTR _this, char *buf, int size)
-{
-#pragma EXPORT_ALIAS
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	
-	const char *tmp = sc_this->get_error_str();
-	int i;
-	for (i = 0; (i < (size - 1)) && tmp[i] != 0; ++i)
-		buf[i] = tmp[i];
-	buf[i++] = 0;
+	// ********************************
+	// **** dsp_sc_set_probe_cache - keep probe results in a file between runs.
+	int VBCALL dsp_sc_interface::set_probe_cache(DSPPTR _this, const char *name)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_probe_cache)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_probe_cache(name);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
-	return DSP_OK;
-}
-// ********************************
 
+	// ********************************
+	// **** dsp_sc_save_probe_cache - write the probe cache file now.
+	int VBCALL dsp_sc_interface::save_probe_cache(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_save_probe_cache)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->save_probe_cache();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
-// ********************************
-// **** dsp_sc_do_combine
-CPP_DSP_API_VB int VBCALL dsp_sc_do_combine(DSPPTR _this)
-{
-#pragma EXPORT_ALIAS
-	bool ret = true;
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	ret = sc_this->do_combine();
-	return (ret) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
 
+	// ********************************
+	// **** dsp_sc_add_input_ex64 - same as dsp_sc_add_input_ex with 64-bit offset and size.
+	int VBCALL dsp_sc_interface::add_input_ex64(
+		DSPPTR _this,
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_add_input_ex64)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->add_input_ex64(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
 
-// ********************************
-// **** dsp_sc_do_split
-CPP_DSP_API_VB int VBCALL dsp_sc_do_split(DSPPTR _this)
-{
-#pragma EXPORT_ALIAS
-	bool ret = true;
-	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
-	ret = sc_this->do_split();
-	return (ret) ? DSP_OK : DSP_ERROR;
-}
-// ********************************
+
+	// ********************************
+	// **** dsp_sc_set_direct_io - read and write sample data around the page cache.
+	int VBCALL dsp_sc_interface::set_direct_io(DSPPTR _this, int enable)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_direct_io)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_direct_io(enable != 0);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_block_frames - Frames per block, 0 picks it from the cache sizes.
+	int VBCALL dsp_sc_interface::set_block_frames(DSPPTR _this, int frames)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_block_frames)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_block_frames(frames);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_get_block_frames - Frames per block used by the last process.
+	int VBCALL dsp_sc_interface::get_block_frames(DSPPTR _this, int *frames)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_get_block_frames)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->get_block_frames(*frames);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_output_buffer - Bytes collected for each output before a write.
+	int VBCALL dsp_sc_interface::set_output_buffer(DSPPTR _this, int bytes)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_output_buffer)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_output_buffer(bytes);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_parallel_encode - Encode compressed outputs on their own threads.
+	int VBCALL dsp_sc_interface::set_parallel_encode(DSPPTR _this, int enable)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_parallel_encode)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_parallel_encode(enable != 0);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_segments - Segments of one input processed at once.
+	int VBCALL dsp_sc_interface::set_segments(DSPPTR _this, int workers)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_segments)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_segments(workers);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_input_range - Read only part of an input.
+	int VBCALL dsp_sc_interface::set_input_range(DSPPTR _this, int index, int64_t start, int64_t length, int timecode)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_input_range)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_input_range(index, start, length, timecode != 0);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_convert_workers - Files do_convert converts at once.
+	int VBCALL dsp_sc_interface::set_convert_workers(DSPPTR _this, int workers)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_convert_workers)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_convert_workers(workers);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_progress - Call back after every block with the frames done.
+	int VBCALL dsp_sc_interface::set_progress(DSPPTR _this, dsp_progress_callback callback, DSPPTR user)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_progress)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = set_progress_callback(sc_this, callback, user);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_cancel - Stop the running process.  Can be called from any thread.
+	int VBCALL dsp_sc_interface::cancel(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_cancel)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		ret = sc_this->set_cancel(true);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_get_stats - Frames, bytes, stage times and speed of the last process.
+	int VBCALL dsp_sc_interface::get_stats(DSPPTR _this, DSP_SC_STATS &stats)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_get_stats)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		ret = get_stats_c(sc_this, stats);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_memory_budget - Bytes every process together may use for buffers.
+	int VBCALL dsp_sc_interface::set_memory_budget(int64_t bytes)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_memory_budget)
+		dsp::get_memory_budget().set_limit(bytes);
+		return DSP_OK;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_get_memory_budget - Use of the memory budget and how often processes waited.
+	int VBCALL dsp_sc_interface::get_memory_budget(DSP_SC_MEMORY_STATS &stats)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_get_memory_budget)
+		return get_memory_budget_c(stats) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_add_copy_output - Add an output a split writes every channel of the input to.
+	int VBCALL dsp_sc_interface::add_copy_output(DSPPTR _this, const char *name, int fmtcodec, int rate)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_add_copy_output)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->add_copy_output(name, fmtcodec, rate);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_add_tap - Call back with every block a split reads.
+	int VBCALL dsp_sc_interface::add_tap(DSPPTR _this, dsp_tap_callback callback, DSPPTR user)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_add_tap)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = add_tap_callback(sc_this, callback, user);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_levels - Measure the peak and RMS level of every channel while splitting.
+	int VBCALL dsp_sc_interface::set_levels(DSPPTR _this, int enable)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_levels)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_levels(enable != 0);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_get_levels - Peak and RMS level of a channel measured by the last split.
+	int VBCALL dsp_sc_interface::get_levels(DSPPTR _this, int channel, double &peak, double &rms)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_get_levels)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->get_levels(channel, peak, rms);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_clear_fanout - Remove the copy outputs and taps.
+	int VBCALL dsp_sc_interface::clear_fanout(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_clear_fanout)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->clear_fanout();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_do_fanout - Read the input once and feed the split outputs, copies and taps.
+	int VBCALL dsp_sc_interface::do_fanout(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_do_fanout)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->do_fanout();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_job_cache - Skip jobs whose outputs are up to date.
+	int VBCALL dsp_sc_interface::set_job_cache(DSPPTR _this, const char *name, int hash)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_job_cache)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->set_job_cache(name, hash != 0);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_save_job_cache - write the job cache file now.
+	int VBCALL dsp_sc_interface::save_job_cache(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_save_job_cache)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->save_job_cache();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_do_split
+	int VBCALL dsp_sc_interface::do_split(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_do_split)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->do_split();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_do_combine
+	int VBCALL dsp_sc_interface::do_combine(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_do_combine)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->do_combine();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_do_convert
+	int VBCALL dsp_sc_interface::do_convert(DSPPTR _this)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_do_convert)
+		bool ret = true;
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		if (is_busy(sc_this))
+			return DSP_ERROR;
+		ret = sc_this->do_convert();
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_submit_split - Queue a split and return its job id.
+	int VBCALL dsp_sc_interface::submit_split(DSPPTR _this, int &job)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_submit_split)
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		return submit_job(sc_this, job, &dsp::dsp_split_combine::do_split);
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_submit_combine - Queue a combine and return its job id.
+	int VBCALL dsp_sc_interface::submit_combine(DSPPTR _this, int &job)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_submit_combine)
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		return submit_job(sc_this, job, &dsp::dsp_split_combine::do_combine);
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_submit_fanout - Queue a fan-out and return its job id.
+	int VBCALL dsp_sc_interface::submit_fanout(DSPPTR _this, int &job)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_submit_fanout)
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		return submit_job(sc_this, job, &dsp::dsp_split_combine::do_fanout);
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_submit_convert - Queue a convert and return its job id.
+	int VBCALL dsp_sc_interface::submit_convert(DSPPTR _this, int &job)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_submit_convert)
+		dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+		return submit_job(sc_this, job, &dsp::dsp_split_combine::do_convert);
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_job_poll - Status and progress of a job.
+	int VBCALL dsp_sc_interface::job_poll(int job, int &status, int64_t &done, int64_t &total)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_job_poll)
+		status = get_jobs().poll(job, &done, &total);
+		return (status != DSP_JOB_UNKNOWN) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_job_wait - Wait for a job to finish.  A negative timeout waits forever.
+	int VBCALL dsp_sc_interface::job_wait(int job, int timeout_ms, int &status)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_job_wait)
+		status = get_jobs().wait(job, timeout_ms);
+		return (status != DSP_JOB_UNKNOWN) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_job_cancel - Cancel a queued or running job.
+	int VBCALL dsp_sc_interface::job_cancel(int job)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_job_cancel)
+		return get_jobs().cancel(job) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_job_release - Forget a finished job.
+	int VBCALL dsp_sc_interface::job_release(int job)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_job_release)
+		return get_jobs().release(job) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_job_workers - Jobs that run at once.  0 is one per pool worker.
+	int VBCALL dsp_sc_interface::set_job_workers(int workers)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_job_workers)
+		get_jobs().set_workers(workers);
+		return DSP_OK;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp_sc_set_thread_pool - Worker threads every process shares.  0 is one per core.
+	// **** Fails while any work is running and when called from a task or a callback on a worker.
+	int VBCALL dsp_sc_interface::set_thread_pool(int workers, int pin)
+	{
+//		#pragma EXPORT_ALIASX(dsp_sc_set_thread_pool)
+		if (workers < 0 || workers > dsp::thread_pool::max_workers)
+			return DSP_ERROR;
+		bool ret = dsp::get_thread_pool().set_workers(workers, pin != 0);
+		return (ret) ? DSP_OK : DSP_ERROR;
+	}
+	// ********************************
+//};
+
+CPP_DSP_API dsp_sc_interface sc_interface;
+
+// **** dsp_sc_interface
+// ********************************
+
+
+#if 1
+// ********************************
+// **** dsp_sc_start - To allocate a special split/combine processor.
+CPP_DSP_API_VB int VBCALL dsp_sc_start(DSPPTR &_this)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *ret = new dsp::dsp_split_combine;
+	_this = ((DSPPTR)ret);
+	return (ret != nullptr) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_end - Destroy the information assigned to the split/combine processor.
+CPP_DSP_API_VB int VBCALL dsp_sc_end(DSPPTR &_this)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (_this)
+	{
+		get_jobs().remove_owner(sc_this);
+		delete sc_this;
+		_this = 0;
+		return DSP_OK;
+	}
+	return DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_clear - To allocate a special split/combine processor.
+CPP_DSP_API_VB int VBCALL dsp_sc_clear(DSPPTR &_this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->clear();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_input - add an input file to the input list.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_input_ex(
+	DSPPTR _this,
+	const char *name,			// Path to and name of file.
+	int &Channels,				// Total number of channels.
+	int &SampleSize,			// Bits per sample.
+	int &FrameSize,				// Size of a single frame of audio (Channels * BytesPerSample).
+	int &SampleRate,			// Sample rate.
+	int &Float,					// True or false. Changed to Float from mFormat.
+	int &ByteOrder,				// Endianness.
+	int &dataOffset,			// File offset of sample data
+	unsigned long &dataSize,	// Size of sample data in bytes
+	int &HasBWF,				// 0 for no BWF and 1 for has BWF
+	int &MediaType,				// 1 = wav, 2 = aif;
+	SF_BROADCAST_INFO &bext
+)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_input_ex(
+		name,		// Path to and name of file.
+		Channels,	// Total number of channels.
+		SampleSize,	// Bits per sample.
+		FrameSize,	// Size of a single frame of audio (Channels * BytesPerSample).
+		SampleRate,	// Sample rate.
+		Float,		// Changed to Float from mFormat,// ???
+		ByteOrder,	// Endianness.
+		dataOffset,	// File offset of sample data
+		dataSize,	// Size of sample data in bytes
+		HasBWF,		// 0 for no BWF and 1 for has BWF
+		MediaType,	// 1 = wav, 2 = aif;
+		bext
+	);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_input - add an input file to the input list.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_input(DSPPTR _this, const char *name, int &channels)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_input(name, channels);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_output - add an output file to the output list.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_output(DSPPTR _this, const char *name, int fmtcodec, int rate)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_output(name, fmtcodec, rate);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// ****  dsp_sc_get_error - Fill the string buffer pointer to by 'buf' (of 'size')
+// **** with the contents of the error string.
+CPP_DSP_API_VB int VBCALL dsp_sc_get_error(DSPPTR _this, char *buf, int size)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+	{
+		if (size > 0)
+			buf[0] = 0;
+		return DSP_ERROR;
+	}
+	
+	const char *tmp = sc_this->get_error_str();
+	int i;
+	for (i = 0; (i < (size - 1)) && tmp[i] != 0; ++i)
+		buf[i] = tmp[i];
+	buf[i++] = 0;
+
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_route - route an input file channel to an output file channel.
+// **** All indexes are zero based.  If no routes are added every channel is used.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_route(DSPPTR _this, int src_file, int src_ch, int dst_file, int dst_ch)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_route(src_file, src_ch, dst_file, dst_ch);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_clear_routes - remove all channel routes.
+CPP_DSP_API_VB int VBCALL dsp_sc_clear_routes(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->clear_routes();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_split_layout - set the channel grouping for split.
+// **** 'groups' holds 'count' channel counts, e.g. { 2, 2, 6, 1, 1 } for stereo pairs
+// **** and a 5.1 group.  Each group is written as one interleaved file in a single pass.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_split_layout(DSPPTR _this, const int *groups, int count)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_split_layout(groups, count);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_readahead - set how far ahead inputs are read.
+// **** 'depth' is the number of blocks read ahead of the process on a background thread
+// **** and 0 turns read-ahead off.  'block_frames' of 0 uses the process block size.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_readahead(DSPPTR _this, int depth, int block_frames)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_readahead(depth, block_frames);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_writebehind - set how many blocks are queued behind each output.
+// **** Output blocks are written on a background thread.  A depth of 0 writes in line.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_writebehind(DSPPTR _this, int depth)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_writebehind(depth);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_io_engine - choose the I/O engine for uncompressed files.
+// **** 0 uses blocking writes.  1 batches the writes for each block through io_uring on
+// **** Linux and falls back to blocking writes anywhere else.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_io_engine(DSPPTR _this, int mode)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_io_engine(mode);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_input_stream - add an input read from a pipe or stream.
+// **** 'name' only picks the file type from its extension.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_input_stream(DSPPTR _this, int fd, const char *name, int &channels)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_input_stream(fd, name, channels);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_output_stream - add an output written to a pipe or stream.
+// **** Use a file type that doesn't need its header patched (raw, au, caf).
+CPP_DSP_API_VB int VBCALL dsp_sc_add_output_stream(DSPPTR _this, int fd, const char *name, int fmtcodec, int rate)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_output_stream(fd, name, fmtcodec, rate);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_stream_window - set the ring buffer size in bytes for streams.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_stream_window(DSPPTR _this, int window)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_stream_window(window);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_probe_input - same as dsp_sc_add_input_ex without adding the file.
+// **** Only the header of uncompressed files is read and the result is cached.
+CPP_DSP_API_VB int VBCALL dsp_sc_probe_input(
+	DSPPTR _this,
+	const char *name,
+	int &Channels,
+	int &SampleSize,
+	int &FrameSize,
+	int &SampleRate,
+	int &Float,
+	int &ByteOrder,
+	int64_t &dataOffset,
+	int64_t &dataSize,
+	int &HasBWF,
+	int &MediaType,
+	SF_BROADCAST_INFO &bext
+)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->probe_input(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_probe_cache - keep probe results in a file between runs.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_probe_cache(DSPPTR _this, const char *name)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_probe_cache(name);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_save_probe_cache - write the probe cache file now.
+CPP_DSP_API_VB int VBCALL dsp_sc_save_probe_cache(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->save_probe_cache();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_input_ex64 - same as dsp_sc_add_input_ex with 64-bit offset and size.
+// **** Use this for files with more than 4GB of sample data.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_input_ex64(
+	DSPPTR _this,
+	const char *name,
+	int &Channels,
+	int &SampleSize,
+	int &FrameSize,
+	int &SampleRate,
+	int &Float,
+	int &ByteOrder,
+	int64_t &dataOffset,
+	int64_t &dataSize,
+	int &HasBWF,
+	int &MediaType,
+	SF_BROADCAST_INFO &bext
+)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_input_ex64(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_direct_io - read and write sample data around the page cache.
+// **** Applies to files added after the call.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_direct_io(DSPPTR _this, int enable)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_direct_io(enable != 0);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_block_frames - Frames per block, 0 picks it from the cache sizes.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_block_frames(DSPPTR _this, int frames)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_block_frames(frames);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_get_block_frames - Frames per block used by the last process.
+CPP_DSP_API_VB int VBCALL dsp_sc_get_block_frames(DSPPTR _this, int *frames)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->get_block_frames(*frames);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_output_buffer - Bytes collected for each output before a write.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_output_buffer(DSPPTR _this, int bytes)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_output_buffer(bytes);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_parallel_encode - Encode compressed outputs on their own threads.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_parallel_encode(DSPPTR _this, int enable)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_parallel_encode(enable != 0);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_segments - Segments of one input processed at once.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_segments(DSPPTR _this, int workers)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_segments(workers);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_input_range - Read only part of an input.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_input_range(DSPPTR _this, int index, int64_t start, int64_t length, int timecode)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_input_range(index, start, length, timecode != 0);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_convert_workers - Files do_convert converts at once.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_convert_workers(DSPPTR _this, int workers)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_convert_workers(workers);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_progress - Call back after every block with the frames done.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_progress(DSPPTR _this, dsp_progress_callback callback, DSPPTR user)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = set_progress_callback(sc_this, callback, user);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_cancel - Stop the running process.  Can be called from any thread.
+CPP_DSP_API_VB int VBCALL dsp_sc_cancel(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	ret = sc_this->set_cancel(true);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_get_stats - Frames, bytes, stage times and speed of the last process.
+CPP_DSP_API_VB int VBCALL dsp_sc_get_stats(DSPPTR _this, DSP_SC_STATS &stats)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	ret = get_stats_c(sc_this, stats);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_memory_budget - Bytes every process together may use for buffers.
+// **** 0 is no limit.  Processes wait or use smaller blocks to stay within it.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_memory_budget(int64_t bytes)
+{
+#pragma EXPORT_ALIAS
+	dsp::get_memory_budget().set_limit(bytes);
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_get_memory_budget - Use of the memory budget and how often processes waited.
+CPP_DSP_API_VB int VBCALL dsp_sc_get_memory_budget(DSP_SC_MEMORY_STATS &stats)
+{
+#pragma EXPORT_ALIAS
+	return get_memory_budget_c(stats) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_copy_output - Add an output a split writes every channel of the input to.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_copy_output(DSPPTR _this, const char *name, int fmtcodec, int rate)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->add_copy_output(name, fmtcodec, rate);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_add_tap - Call back with every block a split reads.
+// **** The callback runs on the process thread and should be quick.
+CPP_DSP_API_VB int VBCALL dsp_sc_add_tap(DSPPTR _this, dsp_tap_callback callback, DSPPTR user)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = add_tap_callback(sc_this, callback, user);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_levels - Measure the peak and RMS level of every channel while splitting.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_levels(DSPPTR _this, int enable)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_levels(enable != 0);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_get_levels - Peak and RMS level of a channel measured by the last split.
+// **** Levels are in full scale, 1.0 is the loudest a sample can be.
+CPP_DSP_API_VB int VBCALL dsp_sc_get_levels(DSPPTR _this, int channel, double &peak, double &rms)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->get_levels(channel, peak, rms);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_clear_fanout - Remove the copy outputs and taps.
+CPP_DSP_API_VB int VBCALL dsp_sc_clear_fanout(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->clear_fanout();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_do_fanout - Read the input once and feed the split outputs, copies and taps.
+// **** Only writes split outputs when outputs, routes or a layout were set.
+CPP_DSP_API_VB int VBCALL dsp_sc_do_fanout(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->do_fanout();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_job_cache - Skip jobs whose outputs are up to date.
+// **** Keeps finished jobs in the file 'name'.  An empty name turns it off.
+// **** With 'hash' inputs are also compared by a hash of their content.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_job_cache(DSPPTR _this, const char *name, int hash)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->set_job_cache(name, hash != 0);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_save_job_cache - write the job cache file now.
+CPP_DSP_API_VB int VBCALL dsp_sc_save_job_cache(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->save_job_cache();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_do_combine
+CPP_DSP_API_VB int VBCALL dsp_sc_do_combine(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->do_combine();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_do_split
+CPP_DSP_API_VB int VBCALL dsp_sc_do_split(DSPPTR _this)
+{
+#pragma EXPORT_ALIAS
+	bool ret = true;
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
+	ret = sc_this->do_split();
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
 
 
 // ********************************
@@ -399,10 +1712,123 @@ CPP_DSP_API_VB int VBCALL dsp_sc_do_convert(DSPPTR _this)
 #pragma EXPORT_ALIAS
 	bool ret = true;
 	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	if (is_busy(sc_this))
+		return DSP_ERROR;
 	ret = sc_this->do_convert();
 	return (ret) ? DSP_OK : DSP_ERROR;
 }
 // ********************************
+
+
+// ********************************
+// **** dsp_sc_submit_split - Queue a split and return its job id.
+CPP_DSP_API_VB int VBCALL dsp_sc_submit_split(DSPPTR _this, int &job)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	return submit_job(sc_this, job, &dsp::dsp_split_combine::do_split);
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_submit_combine - Queue a combine and return its job id.
+CPP_DSP_API_VB int VBCALL dsp_sc_submit_combine(DSPPTR _this, int &job)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	return submit_job(sc_this, job, &dsp::dsp_split_combine::do_combine);
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_submit_fanout - Queue a fan-out and return its job id.
+CPP_DSP_API_VB int VBCALL dsp_sc_submit_fanout(DSPPTR _this, int &job)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	return submit_job(sc_this, job, &dsp::dsp_split_combine::do_fanout);
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_submit_convert - Queue a convert and return its job id.
+CPP_DSP_API_VB int VBCALL dsp_sc_submit_convert(DSPPTR _this, int &job)
+{
+#pragma EXPORT_ALIAS
+	dsp::dsp_split_combine *sc_this = (dsp::dsp_split_combine *)_this;
+	return submit_job(sc_this, job, &dsp::dsp_split_combine::do_convert);
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_job_poll - Status and progress of a job.
+CPP_DSP_API_VB int VBCALL dsp_sc_job_poll(int job, int &status, int64_t &done, int64_t &total)
+{
+#pragma EXPORT_ALIAS
+	status = get_jobs().poll(job, &done, &total);
+	return (status != DSP_JOB_UNKNOWN) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_job_wait - Wait for a job to finish.  A negative timeout waits forever.
+CPP_DSP_API_VB int VBCALL dsp_sc_job_wait(int job, int timeout_ms, int &status)
+{
+#pragma EXPORT_ALIAS
+	status = get_jobs().wait(job, timeout_ms);
+	return (status != DSP_JOB_UNKNOWN) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_job_cancel - Cancel a queued or running job.
+CPP_DSP_API_VB int VBCALL dsp_sc_job_cancel(int job)
+{
+#pragma EXPORT_ALIAS
+	return get_jobs().cancel(job) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_job_release - Forget a finished job.
+CPP_DSP_API_VB int VBCALL dsp_sc_job_release(int job)
+{
+#pragma EXPORT_ALIAS
+	return get_jobs().release(job) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_job_workers - Jobs that run at once.  0 is one per pool worker.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_job_workers(int workers)
+{
+#pragma EXPORT_ALIAS
+	get_jobs().set_workers(workers);
+	return DSP_OK;
+}
+// ********************************
+
+
+// ********************************
+// **** dsp_sc_set_thread_pool - Worker threads every process shares.  0 is one per core.
+// **** Fails while any work is running and when called from a task or a callback on a worker.
+CPP_DSP_API_VB int VBCALL dsp_sc_set_thread_pool(int workers, int pin)
+{
+#pragma EXPORT_ALIAS
+	if (workers < 0 || workers > dsp::thread_pool::max_workers)
+		return DSP_ERROR;
+	bool ret = dsp::get_thread_pool().set_workers(workers, pin != 0);
+	return (ret) ? DSP_OK : DSP_ERROR;
+}
+// ********************************
 #endif // if 0
 
 /*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
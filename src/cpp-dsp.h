@@ -11,6 +11,8 @@
 #define VBEXTERN extern "C"
 #define VBCALL __stdcall
 
+#include <cstdint>
+
 #ifdef CDSP_EXPORTS
 	#include "dsp_file.h"
 
@@ -94,6 +96,74 @@
 // ********************************
 
 
+// ********************************
+// **** Job status returned by dsp_sc_job_poll() and dsp_sc_job_wait().  While a handle
+// **** has a job queued or running every call on it fails except dsp_sc_cancel(),
+// **** dsp_sc_get_stats() and the dsp_sc_job_*() calls.
+#define DSP_JOB_UNKNOWN		0	// Never submitted or released.
+#define DSP_JOB_QUEUED		1
+#define DSP_JOB_RUNNING		2
+#define DSP_JOB_DONE		3
+#define DSP_JOB_FAILED		4	// dsp_sc_get_error() tells why.
+#define DSP_JOB_CANCELLED	5
+
+// Called after every block of a process with the frames done and the total (0 if unknown).
+// May be called from several threads at once.
+typedef void (VBCALL *dsp_progress_callback)(DSPPTR user, int64_t done, int64_t total);
+
+// Called by a split with every block of the input as 'frames' frames of 'channels'
+// interleaved floats.  Runs on the process thread.
+typedef void (VBCALL *dsp_tap_callback)(DSPPTR user, const float *samples, int channels, int64_t frames);
+// ********************************
+
+
+// ********************************
+// **** Statistics of the last (or running) process, filled by dsp_sc_get_stats().
+// **** Times are in nanoseconds.  Stage times add up over the threads that run the
+// **** process.  Reading and writing include waiting on the background threads.
+typedef struct
+{
+	int64_t		frames_read;
+	int64_t		bytes_read;
+	int64_t		frames_written;
+	int64_t		bytes_written;
+	int64_t		blocks;
+	int64_t		read_wall_ns;		// Getting frames from the inputs.
+	int64_t		read_cpu_ns;
+	int64_t		convert_wall_ns;	// Converting samples.
+	int64_t		convert_cpu_ns;
+	int64_t		transpose_wall_ns;	// Routing channels between interleaved buffers.
+	int64_t		transpose_cpu_ns;
+	int64_t		write_wall_ns;		// Handing frames to the outputs and finishing them.
+	int64_t		write_cpu_ns;
+	int64_t		metadata_wall_ns;	// Opening outputs and copying bext and text information.
+	int64_t		metadata_cpu_ns;
+	int64_t		wall_ns;			// Whole process.
+	int64_t		cpu_ns;				// Whole program while the process ran.
+	int64_t		peak_buffer_bytes;	// Most memory held by sample buffers and queues at once.
+	double		mb_per_sec;			// MB read and written per second.
+	int64_t		budget_waits;		// Times the process waited for the memory budget.
+	int64_t		budget_shrinks;		// Times it used smaller blocks to fit the memory budget.
+	int64_t		jobs_skipped;		// Files converted or splits skipped by the job cache.
+} DSP_SC_STATS;
+// ********************************
+
+
+// ********************************
+// **** Memory budget shared by every process, filled by dsp_sc_get_memory_budget().
+typedef struct
+{
+	int64_t		limit;				// Bytes in the budget.  0 is no limit.
+	int64_t		in_use;				// Bytes held by running processes.
+	int64_t		peak;				// Most bytes held at once.
+	int64_t		leases;				// Processes and files that took memory.
+	int64_t		waits;				// How many of them had to wait.
+	int64_t		wait_ns;			// Nanoseconds spent waiting.
+	int64_t		shrinks;			// How many of them used smaller blocks.
+} DSP_SC_MEMORY_STATS;
+// ********************************
+
+
 // ********************************
 // **** Exports
 class CPP_DSP_API dsp_sc_interface
@@ -124,6 +194,79 @@ public:
 	virtual int VBCALL do_split(DSPPTR _this);
 	virtual int VBCALL do_combine(DSPPTR _this);
 	virtual int VBCALL do_convert(DSPPTR _this);
+	// Methods added later go below so the older ones keep their slots in the vtable.
+	virtual int VBCALL add_route(DSPPTR _this, int src_file, int src_ch, int dst_file, int dst_ch);
+	virtual int VBCALL clear_routes(DSPPTR _this);
+	virtual int VBCALL set_split_layout(DSPPTR _this, const int *groups, int count);
+	virtual int VBCALL set_readahead(DSPPTR _this, int depth, int block_frames);
+	virtual int VBCALL set_writebehind(DSPPTR _this, int depth);
+	virtual int VBCALL set_io_engine(DSPPTR _this, int mode);
+	virtual int VBCALL add_input_stream(DSPPTR _this, int fd, const char *name, int &channels);
+	virtual int VBCALL add_output_stream(DSPPTR _this, int fd, const char *name, int fmtcodec, int rate);
+	virtual int VBCALL set_stream_window(DSPPTR _this, int window);
+	virtual int VBCALL probe_input(
+		DSPPTR _this,
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	);
+	virtual int VBCALL set_probe_cache(DSPPTR _this, const char *name);
+	virtual int VBCALL save_probe_cache(DSPPTR _this);
+	virtual int VBCALL add_input_ex64(
+		DSPPTR _this,
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	);
+	virtual int VBCALL set_direct_io(DSPPTR _this, int enable);
+	virtual int VBCALL set_block_frames(DSPPTR _this, int frames);
+	virtual int VBCALL get_block_frames(DSPPTR _this, int *frames);
+	virtual int VBCALL set_output_buffer(DSPPTR _this, int bytes);
+	virtual int VBCALL set_parallel_encode(DSPPTR _this, int enable);
+	virtual int VBCALL set_segments(DSPPTR _this, int workers);
+	virtual int VBCALL set_input_range(DSPPTR _this, int index, int64_t start, int64_t length, int timecode);
+	virtual int VBCALL set_convert_workers(DSPPTR _this, int workers);
+	virtual int VBCALL set_progress(DSPPTR _this, dsp_progress_callback callback, DSPPTR user);
+	virtual int VBCALL cancel(DSPPTR _this);
+	virtual int VBCALL get_stats(DSPPTR _this, DSP_SC_STATS &stats);
+	virtual int VBCALL set_memory_budget(int64_t bytes);
+	virtual int VBCALL get_memory_budget(DSP_SC_MEMORY_STATS &stats);
+	virtual int VBCALL add_copy_output(DSPPTR _this, const char *name, int fmtcodec, int rate);
+	virtual int VBCALL add_tap(DSPPTR _this, dsp_tap_callback callback, DSPPTR user);
+	virtual int VBCALL set_levels(DSPPTR _this, int enable);
+	virtual int VBCALL get_levels(DSPPTR _this, int channel, double &peak, double &rms);
+	virtual int VBCALL clear_fanout(DSPPTR _this);
+	virtual int VBCALL do_fanout(DSPPTR _this);
+	virtual int VBCALL set_job_cache(DSPPTR _this, const char *name, int hash);
+	virtual int VBCALL save_job_cache(DSPPTR _this);
+	virtual int VBCALL submit_split(DSPPTR _this, int &job);
+	virtual int VBCALL submit_combine(DSPPTR _this, int &job);
+	virtual int VBCALL submit_fanout(DSPPTR _this, int &job);
+	virtual int VBCALL submit_convert(DSPPTR _this, int &job);
+	virtual int VBCALL job_poll(int job, int &status, int64_t &done, int64_t &total);
+	virtual int VBCALL job_wait(int job, int timeout_ms, int &status);
+	virtual int VBCALL job_cancel(int job);
+	virtual int VBCALL job_release(int job);
+	virtual int VBCALL set_job_workers(int workers);
+	virtual int VBCALL set_thread_pool(int workers, int pin);
 };
 // **** End exports
 // ********************************
@@ -151,9 +294,81 @@ public:
 	CPP_DSP_API_VB int VBCALL dsp_sc_add_input(DSPPTR _this, const char *name, int &channels);
 	CPP_DSP_API_VB int VBCALL dsp_sc_add_output(DSPPTR _this, const char *name, int fmtcodec, int rate);
 	CPP_DSP_API_VB int VBCALL dsp_sc_get_error(DSPPTR _this, char *buf, int size);
+	CPP_DSP_API_VB int VBCALL dsp_sc_add_route(DSPPTR _this, int src_file, int src_ch, int dst_file, int dst_ch);
+	CPP_DSP_API_VB int VBCALL dsp_sc_clear_routes(DSPPTR _this);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_split_layout(DSPPTR _this, const int *groups, int count);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_readahead(DSPPTR _this, int depth, int block_frames);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_writebehind(DSPPTR _this, int depth);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_io_engine(DSPPTR _this, int mode);
+	CPP_DSP_API_VB int VBCALL dsp_sc_add_input_stream(DSPPTR _this, int fd, const char *name, int &channels);
+	CPP_DSP_API_VB int VBCALL dsp_sc_add_output_stream(DSPPTR _this, int fd, const char *name, int fmtcodec, int rate);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_stream_window(DSPPTR _this, int window);
+	CPP_DSP_API_VB int VBCALL dsp_sc_probe_input(
+		DSPPTR _this,
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_probe_cache(DSPPTR _this, const char *name);
+	CPP_DSP_API_VB int VBCALL dsp_sc_save_probe_cache(DSPPTR _this);
+	CPP_DSP_API_VB int VBCALL dsp_sc_add_input_ex64(
+		DSPPTR _this,
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_direct_io(DSPPTR _this, int enable);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_block_frames(DSPPTR _this, int frames);
+	CPP_DSP_API_VB int VBCALL dsp_sc_get_block_frames(DSPPTR _this, int *frames);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_output_buffer(DSPPTR _this, int bytes);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_parallel_encode(DSPPTR _this, int enable);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_segments(DSPPTR _this, int workers);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_input_range(DSPPTR _this, int index, int64_t start, int64_t length, int timecode);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_convert_workers(DSPPTR _this, int workers);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_progress(DSPPTR _this, dsp_progress_callback callback, DSPPTR user);
+	CPP_DSP_API_VB int VBCALL dsp_sc_cancel(DSPPTR _this);
+	CPP_DSP_API_VB int VBCALL dsp_sc_get_stats(DSPPTR _this, DSP_SC_STATS &stats);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_memory_budget(int64_t bytes);
+	CPP_DSP_API_VB int VBCALL dsp_sc_get_memory_budget(DSP_SC_MEMORY_STATS &stats);
+	CPP_DSP_API_VB int VBCALL dsp_sc_add_copy_output(DSPPTR _this, const char *name, int fmtcodec, int rate);
+	CPP_DSP_API_VB int VBCALL dsp_sc_add_tap(DSPPTR _this, dsp_tap_callback callback, DSPPTR user);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_levels(DSPPTR _this, int enable);
+	CPP_DSP_API_VB int VBCALL dsp_sc_get_levels(DSPPTR _this, int channel, double &peak, double &rms);
+	CPP_DSP_API_VB int VBCALL dsp_sc_clear_fanout(DSPPTR _this);
+	CPP_DSP_API_VB int VBCALL dsp_sc_do_fanout(DSPPTR _this);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_job_cache(DSPPTR _this, const char *name, int hash);
+	CPP_DSP_API_VB int VBCALL dsp_sc_save_job_cache(DSPPTR _this);
 	CPP_DSP_API_VB int VBCALL dsp_sc_do_split(DSPPTR _this);
 	CPP_DSP_API_VB int VBCALL dsp_sc_do_combine(DSPPTR _this);
 	CPP_DSP_API_VB int VBCALL dsp_sc_do_convert(DSPPTR _this);
+	CPP_DSP_API_VB int VBCALL dsp_sc_submit_split(DSPPTR _this, int &job);
+	CPP_DSP_API_VB int VBCALL dsp_sc_submit_combine(DSPPTR _this, int &job);
+	CPP_DSP_API_VB int VBCALL dsp_sc_submit_fanout(DSPPTR _this, int &job);
+	CPP_DSP_API_VB int VBCALL dsp_sc_submit_convert(DSPPTR _this, int &job);
+	CPP_DSP_API_VB int VBCALL dsp_sc_job_poll(int job, int &status, int64_t &done, int64_t &total);
+	CPP_DSP_API_VB int VBCALL dsp_sc_job_wait(int job, int timeout_ms, int &status);
+	CPP_DSP_API_VB int VBCALL dsp_sc_job_cancel(int job);
+	CPP_DSP_API_VB int VBCALL dsp_sc_job_release(int job);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_job_workers(int workers);
+	CPP_DSP_API_VB int VBCALL dsp_sc_set_thread_pool(int workers, int pin);
 
 //#endif // if 0
 #if 0//ndef CDSP_EXPORTS
@@ -164,9 +379,53 @@ public:
 	#define dsp_sc_add_input	sc_interface.add_input
 	#define dsp_sc_add_output	sc_interface.add_output
 	#define dsp_sc_get_error	sc_interface.get_error
+	#define dsp_sc_add_route	sc_interface.add_route
+	#define dsp_sc_clear_routes	sc_interface.clear_routes
+	#define dsp_sc_set_split_layout	sc_interface.set_split_layout
+	#define dsp_sc_set_readahead	sc_interface.set_readahead
+	#define dsp_sc_set_writebehind	sc_interface.set_writebehind
+	#define dsp_sc_set_io_engine	sc_interface.set_io_engine
+	#define dsp_sc_add_input_stream	sc_interface.add_input_stream
+	#define dsp_sc_add_output_stream	sc_interface.add_output_stream
+	#define dsp_sc_set_stream_window	sc_interface.set_stream_window
+	#define dsp_sc_probe_input		sc_interface.probe_input
+	#define dsp_sc_set_probe_cache	sc_interface.set_probe_cache
+	#define dsp_sc_save_probe_cache	sc_interface.save_probe_cache
+	#define dsp_sc_add_input_ex64	sc_interface.add_input_ex64
+	#define dsp_sc_set_direct_io	sc_interface.set_direct_io
+	#define dsp_sc_set_block_frames	sc_interface.set_block_frames
+	#define dsp_sc_get_block_frames	sc_interface.get_block_frames
+	#define dsp_sc_set_output_buffer	sc_interface.set_output_buffer
+	#define dsp_sc_set_parallel_encode	sc_interface.set_parallel_encode
+	#define dsp_sc_set_segments		sc_interface.set_segments
+	#define dsp_sc_set_input_range	sc_interface.set_input_range
+	#define dsp_sc_set_convert_workers	sc_interface.set_convert_workers
+	#define dsp_sc_set_progress		sc_interface.set_progress
+	#define dsp_sc_cancel		sc_interface.cancel
+	#define dsp_sc_get_stats	sc_interface.get_stats
+	#define dsp_sc_set_memory_budget	sc_interface.set_memory_budget
+	#define dsp_sc_get_memory_budget	sc_interface.get_memory_budget
+	#define dsp_sc_add_copy_output	sc_interface.add_copy_output
+	#define dsp_sc_add_tap			sc_interface.add_tap
+	#define dsp_sc_set_levels		sc_interface.set_levels
+	#define dsp_sc_get_levels		sc_interface.get_levels
+	#define dsp_sc_clear_fanout		sc_interface.clear_fanout
+	#define dsp_sc_do_fanout		sc_interface.do_fanout
+	#define dsp_sc_set_job_cache	sc_interface.set_job_cache
+	#define dsp_sc_save_job_cache	sc_interface.save_job_cache
 	#define dsp_sc_do_split		sc_interface.do_split
 	#define dsp_sc_do_combine	sc_interface.do_combine
 	#define dsp_sc_do_convert	sc_interface.do_convert
+	#define dsp_sc_submit_split		sc_interface.submit_split
+	#define dsp_sc_submit_combine	sc_interface.submit_combine
+	#define dsp_sc_submit_fanout	sc_interface.submit_fanout
+	#define dsp_sc_submit_convert	sc_interface.submit_convert
+	#define dsp_sc_job_poll		sc_interface.job_poll
+	#define dsp_sc_job_wait		sc_interface.job_wait
+	#define dsp_sc_job_cancel	sc_interface.job_cancel
+	#define dsp_sc_job_release	sc_interface.job_release
+	#define dsp_sc_set_job_workers	sc_interface.set_job_workers
+	#define dsp_sc_set_thread_pool	sc_interface.set_thread_pool
 #endif
 
 #endif // _CPPDSP_DLL_H_
\ No newline at end of file
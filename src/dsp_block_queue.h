@@ -0,0 +1,251 @@
+﻿/* Lock-free queue of pooled blocks between two threads.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   One thread fills blocks and the other empties them.  The blocks are
+ * allocated once when the queue is set up and go round the ring for the rest
+ * of the run, so nothing is allocated or copied to pass a block along.  The
+ * two sides only share the head and tail counters, which are atomic, so
+ * neither side takes a lock while the other keeps up.
+ *
+ *   A side that finds the queue full (producer) or empty (consumer) spins for
+ * a moment, then yields, then sleeps on a condition variable until the other
+ * side moves.  A side only takes the lock to wake the other one when that one
+ * is sleeping.  Timed sleeps are avoided since they round up to the timer tick
+ * on Windows, which is much longer than a block takes.  The time spent waiting
+ * is counted for each side together with how full the queue was at every push.
+ * A producer that waits a lot feeds a slower consumer and the other way round,
+ * which tells which stage of a pipeline is the bottleneck.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** Counters for a block_queue.  A snapshot, so it can be copied around freely.
+	class block_queue_stats
+	{
+	public:
+		uint64_t pushes;			// Blocks that went through the queue.
+		uint64_t occupancy;			// Sum of the blocks queued at each push.  Divide by 'pushes' for the average.
+		uint64_t producer_waits;	// Times the producer found the queue full.
+		uint64_t producer_wait_ns;	// Nanoseconds the producer waited for room.
+		uint64_t consumer_waits;	// Times the consumer found the queue empty.
+		uint64_t consumer_wait_ns;	// Nanoseconds the consumer waited for a block.
+		block_queue_stats() :
+			pushes(0), occupancy(0), producer_waits(0), producer_wait_ns(0), consumer_waits(0), consumer_wait_ns(0) {}
+
+		double get_average_fill() const { return (pushes > 0) ? (double)occupancy / pushes : 0.0; }
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::block_queue - Bounded single producer, single consumer queue of blocks.
+	class block_queue
+	{
+	public:
+		class block
+		{
+		public:
+			std::vector<uint8_t> data;
+			int64_t frames;
+			block() : frames(0) {}
+		};
+
+	private:
+		std::vector<block>		ring;
+		std::atomic<uint64_t>	head;		// Blocks taken by the consumer.  Only the consumer writes it.
+		std::atomic<uint64_t>	tail;		// Blocks given by the producer.  Only the producer writes it.
+		std::atomic<bool>		closed;
+
+		std::mutex				lock;		// Only taken to sleep and to wake a sleeper.
+		std::condition_variable	moved;		// The head or tail moved or the queue was closed.
+		std::atomic<int>		sleepers;	// Threads sleeping on 'moved' or about to.
+
+		std::atomic<uint64_t>	pushes, occupancy;
+		std::atomic<uint64_t>	producer_waits, producer_wait_ns;
+		std::atomic<uint64_t>	consumer_waits, consumer_wait_ns;
+
+		// ********************************
+		// **** Wait until 'ready' returns true or the queue is closed.  Spins, yields and
+		// **** then sleeps until notify() is called.
+		template <typename _Pred>
+		void park(_Pred ready)
+		{
+			for (int i = 0; i < 128; ++i)
+			{
+				if (ready() || closed.load(std::memory_order_acquire))
+					return;
+				if (i >= 64)
+					std::this_thread::yield();
+			}
+
+			std::unique_lock<std::mutex> l(lock);
+			sleepers.fetch_add(1, std::memory_order_acq_rel);
+			moved.wait(l, [&] { return ready() || closed.load(std::memory_order_acquire); });
+			sleepers.fetch_sub(1);
+		}
+
+		// ********************************
+		// **** Wake the other side if it sleeps.  Called after the head or tail moved.
+		void notify()
+		{
+			// A read-modify-write so either it sees the sleeper or the sleeper's own
+			// read-modify-write sees the move.
+			if (sleepers.fetch_add(0, std::memory_order_acq_rel) > 0)
+			{
+				{ std::unique_lock<std::mutex> l(lock); }
+				moved.notify_all();
+			}
+		}
+
+		// ********************************
+		// **** Wait until 'ready' returns true or the queue is closed.  Adds the time
+		// **** waited to 'ns'.  Returns what 'ready' returned last.
+		template <typename _Pred>
+		bool wait(_Pred ready, std::atomic<uint64_t> &count, std::atomic<uint64_t> &ns)
+		{
+			if (ready())
+				return true;
+
+			count.fetch_add(1, std::memory_order_relaxed);
+			auto start = std::chrono::steady_clock::now();
+			park(ready);
+			ns.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+			return ready();
+		}
+		// ********************************
+
+	public:
+		// ********************************
+		block_queue() :
+			head(0), tail(0), closed(false), sleepers(0), pushes(0), occupancy(0),
+			producer_waits(0), producer_wait_ns(0), consumer_waits(0), consumer_wait_ns(0) {}
+		~block_queue() {}
+		// ********************************
+
+		// ********************************
+		// **** Set up 'depth' blocks of 'bytes' bytes each.  Only while no thread uses the queue.
+		void init(size_t depth, size_t bytes)
+		{
+			ring.resize(depth);
+			for (auto &b : ring)
+				b.data.resize(bytes);
+			head = tail = 0;
+			closed = false;
+			pushes = occupancy = 0;
+			producer_waits = producer_wait_ns = 0;
+			consumer_waits = consumer_wait_ns = 0;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Producer side.  begin_push() waits for a free block and returns nullptr
+		// **** once the queue is closed.  end_push() hands the block to the consumer.
+		block *begin_push()
+		{
+			if (ring.empty() || closed.load(std::memory_order_acquire))
+				return nullptr;
+			uint64_t t = tail.load(std::memory_order_relaxed);
+			if (!wait([&] { return t - head.load(std::memory_order_acquire) < ring.size(); }, producer_waits, producer_wait_ns))
+				return nullptr;
+			return &ring[(size_t)(t % ring.size())];
+		}
+
+		void end_push()
+		{
+			uint64_t t = tail.load(std::memory_order_relaxed);
+			occupancy.fetch_add(t - head.load(std::memory_order_acquire), std::memory_order_relaxed);
+			pushes.fetch_add(1, std::memory_order_relaxed);
+			tail.store(t + 1, std::memory_order_release);
+			notify();
+		}
+		// ********************************
+
+		// ********************************
+		// **** Consumer side.  begin_pop() waits for a filled block and returns nullptr
+		// **** once the queue is closed and empty.  end_pop() gives the block back.
+		block *begin_pop()
+		{
+			if (ring.empty())
+				return nullptr;
+			uint64_t h = head.load(std::memory_order_relaxed);
+			if (!wait([&] { return tail.load(std::memory_order_acquire) != h; }, consumer_waits, consumer_wait_ns))
+				return nullptr;
+			return &ring[(size_t)(h % ring.size())];
+		}
+
+		void end_pop()
+		{
+			head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			notify();
+		}
+		// ********************************
+
+		// ********************************
+		// **** Wake both sides.  The consumer still gets the blocks already queued.
+		void close()
+		{
+			closed.store(true, std::memory_order_release);
+			notify();
+		}
+		bool is_closed() const { return closed.load(std::memory_order_acquire); }
+
+		// **** Wait until the consumer took every block or the queue is closed.  Producer side.
+		void drain() { park([&] { return size() == 0; }); }
+
+		size_t size() const { return (size_t)(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)); }
+		size_t capacity() const { return ring.size(); }
+
+		block_queue_stats get_stats() const
+		{
+			block_queue_stats s;
+			s.pushes = pushes.load(std::memory_order_relaxed);
+			s.occupancy = occupancy.load(std::memory_order_relaxed);
+			s.producer_waits = producer_waits.load(std::memory_order_relaxed);
+			s.producer_wait_ns = producer_wait_ns.load(std::memory_order_relaxed);
+			s.consumer_waits = consumer_waits.load(std::memory_order_relaxed);
+			s.consumer_wait_ns = consumer_wait_ns.load(std::memory_order_relaxed);
+			return s;
+		}
+		// ********************************
+	};
+	// **** End block_queue
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
@@ -20,9 +20,15 @@
 #include "configure.h"
 
 #include <cstdint>
+#include <cstdlib>
+#include <new>
 #include <vector>
 #include <array>
 
+#if defined(_WIN32) || defined(_WIN64)
+	#include <malloc.h>
+#endif
+
 #include "sample_traits.h"
 #include "sample.h"
 
@@ -1079,6 +1085,51 @@ namespace dsp
 	// ********************************
 
 
+	// ********************************
+	// **** dsp::aligned_allocator - Starts every block on an '_Align' byte boundary and
+	// **** rounds its size up to a multiple of '_Align'.  Buffers handed to unbuffered
+	// **** (O_DIRECT) file I/O have to be allocated this way.
+	template <typename _Type, size_t _Align = 4096>
+	class aligned_allocator
+	{
+	public:
+		typedef _Type value_type;
+		template <typename _Other> struct rebind { typedef aligned_allocator<_Other, _Align> other; };
+
+		aligned_allocator() {}
+		template <typename _Other> aligned_allocator(const aligned_allocator<_Other, _Align> &) {}
+
+		_Type *allocate(size_t n)
+		{
+			size_t size = ((n * sizeof(_Type) + _Align - 1) / _Align) * _Align;
+		#if defined(_WIN32) || defined(_WIN64)
+			void *ptr = _aligned_malloc(size, _Align);
+		#else
+			void *ptr = nullptr;
+			if (posix_memalign(&ptr, _Align, size) != 0)
+				ptr = nullptr;
+		#endif
+			if (ptr == nullptr)
+				throw std::bad_alloc();
+			return (_Type *)ptr;
+		}
+
+		void deallocate(_Type *ptr, size_t)
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			_aligned_free(ptr);
+		#else
+			free(ptr);
+		#endif
+		}
+
+		template <typename _Other> bool operator==(const aligned_allocator<_Other, _Align> &) const { return true; }
+		template <typename _Other> bool operator!=(const aligned_allocator<_Other, _Align> &) const { return false; }
+	};
+	// **** End dsp::aligned_allocator
+	// ********************************
+
+
 	// ********************************
 	// **** dsp::dspvector - A vector of 'sample<type, endianness>' samples ready for manipulation
 	template <typename _Type = float, bool _Native = true, class _Alloc = std::allocator< sample<_Type, _Native>> >
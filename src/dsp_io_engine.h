@@ -0,0 +1,584 @@
+﻿/* Batched file I/O engine.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Split writes to many files and combine reads from many files, which comes
+ * out to a lot of small blocking system calls for every block of audio.  This
+ * engine lets the caller queue all of the reads and writes for a block, send
+ * them to the kernel with a single system call and pick up the completions
+ * later while it works on the next block.
+ *
+ *   open_direct() gives a second descriptor on a file that bypasses the page
+ * cache (O_DIRECT, F_NOCACHE or FILE_FLAG_NO_BUFFERING) for bulk transfers
+ * that are read or written once.
+ *
+ *   On Linux this uses io_uring through the raw system calls so there is no
+ * dependency on liburing.  When io_uring is not available (old kernel, seccomp,
+ * other platforms) every request is done right away with a blocking
+ * pread()/pwrite() so callers never need a second code path.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <io.h>
+	#include <Windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+	#include <linux/io_uring.h>
+	#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+		#define DSP_HAVE_IO_URING 1
+	#endif
+#endif
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** A single read or write.  Must stay alive and in place until it is done.
+	class io_request
+	{
+	public:
+		int			fd;
+		int64_t		offset;
+		void		*buffer;
+		size_t		size;
+		bool		write;
+		bool		pending;	// Queued and not done yet.
+		int64_t		result;		// Bytes transferred or -errno.
+
+		io_request() : fd(-1), offset(0), buffer(nullptr), size(0), write(false), pending(false), result(0) {}
+
+		void set(int _fd, int64_t _offset, void *_buffer, size_t _size, bool _write)
+		{
+			fd = _fd;
+			offset = _offset;
+			buffer = _buffer;
+			size = _size;
+			write = _write;
+			pending = false;
+			result = 0;
+		}
+
+		bool succeeded() const { return !pending && result == (int64_t)size; }
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::io_engine - Queues reads and writes and sends them to the kernel in batches.
+	class io_engine
+	{
+	public:
+		enum {
+			blocking = 0,	// Every request is done when it is queued.
+			uring = 1		// io_uring on Linux.  Falls back to blocking.
+		};
+
+	private:
+		// ********************************
+		// **** Blocking transfer of a whole request.  Also used to finish short transfers.
+		static int64_t transfer(int fd, int64_t offset, uint8_t *buffer, size_t size, bool write)
+		{
+			size_t done = 0;
+			while (done < size)
+			{
+			#if defined(_WIN32) || defined(_WIN64)
+				if (_lseeki64(fd, offset + done, SEEK_SET) < 0)
+					return -EIO;
+				unsigned int n = (unsigned int)((size - done > 0x40000000) ? 0x40000000 : (size - done));
+				int ret = write ? _write(fd, buffer + done, n) : _read(fd, buffer + done, n);
+			#else
+				ssize_t ret = write ?
+					pwrite(fd, buffer + done, size - done, (off_t)(offset + done)) :
+					pread(fd, buffer + done, size - done, (off_t)(offset + done));
+				if (ret < 0 && errno == EINTR)
+					continue;
+			#endif
+				if (ret < 0)
+					return -errno;
+				if (ret == 0)
+					break;	// End of file on a read.
+				done += ret;
+			}
+			return (int64_t)done;
+		}
+		// ********************************
+
+		// ********************************
+		// **** engine_ref class.  Holds the ring.
+		class engine_ref
+		{
+		public:
+			int			mode;
+			std::mutex	lock;
+			size_t		in_flight;		// Requests queued and not reaped.
+
+		#ifdef DSP_HAVE_IO_URING
+			int			ring_fd;
+			unsigned	entries;
+			unsigned	to_submit;		// Entries in the SQ the kernel hasn't seen yet.
+			void		*sq_ptr, *cq_ptr;
+			size_t		sq_size, cq_size, sqes_size;
+			unsigned	*sq_head, *sq_tail, *sq_mask, *sq_array;
+			unsigned	*cq_head, *cq_tail, *cq_mask;
+			io_uring_sqe *sqes;
+			io_uring_cqe *cqes;
+		#endif
+
+			engine_ref() : mode(blocking), in_flight(0)
+			{
+			#ifdef DSP_HAVE_IO_URING
+				ring_fd = -1;
+				entries = to_submit = 0;
+				sq_ptr = cq_ptr = nullptr;
+				sqes = nullptr;
+			#endif
+			}
+
+			~engine_ref()
+			{
+			#ifdef DSP_HAVE_IO_URING
+				if (ring_fd >= 0)
+				{
+					// Nothing can be in flight when the buffers go away.
+					while (in_flight && reap(1))
+						;
+					munmap(sqes, sqes_size);
+					if (cq_ptr != sq_ptr)
+						munmap(cq_ptr, cq_size);
+					munmap(sq_ptr, sq_size);
+					::close(ring_fd);
+				}
+			#endif
+			}
+
+		#ifdef DSP_HAVE_IO_URING
+			// ********************************
+			// **** Create the ring.  Returns false if the kernel says no.
+			bool setup(unsigned count)
+			{
+				io_uring_params params;
+				std::memset(&params, 0, sizeof(params));
+				ring_fd = (int)syscall(__NR_io_uring_setup, count, &params);
+				if (ring_fd < 0)
+					return false;
+
+				entries = params.sq_entries;
+				sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if (single)
+					sq_size = cq_size = (sq_size > cq_size) ? sq_size : cq_size;
+
+				sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+				if (sq_ptr == MAP_FAILED)
+				{
+					::close(ring_fd);
+					ring_fd = -1;
+					return false;
+				}
+				cq_ptr = single ? sq_ptr :
+					mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+				sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+				sqes = (io_uring_sqe *)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+				if (cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+				{
+					if (sqes != MAP_FAILED)
+						munmap(sqes, sqes_size);
+					if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+						munmap(cq_ptr, cq_size);
+					munmap(sq_ptr, sq_size);
+					::close(ring_fd);
+					ring_fd = -1;
+					return false;
+				}
+
+				uint8_t *sq = (uint8_t *)sq_ptr, *cq = (uint8_t *)cq_ptr;
+				sq_head = (unsigned *)(sq + params.sq_off.head);
+				sq_tail = (unsigned *)(sq + params.sq_off.tail);
+				sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+				sq_array = (unsigned *)(sq + params.sq_off.array);
+				cq_head = (unsigned *)(cq + params.cq_off.head);
+				cq_tail = (unsigned *)(cq + params.cq_off.tail);
+				cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+				cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+				return true;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Hand everything in the SQ to the kernel and optionally wait for
+			// **** 'min_complete' completions.  EBUSY means the CQ is full, so completions
+			// **** are collected to make room before trying again.  Returns false when the
+			// **** kernel keeps saying no and the caller should fall_back().
+			bool enter(unsigned min_complete)
+			{
+				int tries = 0;
+				for (;;)
+				{
+					int ret = (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+						min_complete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+					if (ret >= 0)
+					{
+						to_submit -= ((unsigned)ret < to_submit) ? ret : to_submit;
+						return true;
+					}
+					int err = errno;
+					if (err == EINTR)
+						continue;
+					if (err == EBUSY && collect() > 0)
+					{
+						// What the caller waited for may be among them.  Only submit now.
+						min_complete = 0;
+						tries = 0;
+						continue;
+					}
+					if ((err != EBUSY && err != EAGAIN) || ++tries > 1000)
+						return false;
+					std::this_thread::yield();
+				}
+			}
+			// ********************************
+
+			// ********************************
+			// **** Give up on the ring.  Requests the kernel hasn't seen are taken back out
+			// **** of the SQ and done right here.  The ones it has are collected as they
+			// **** complete.  Everything queued later is done the slow way.
+			void fall_back()
+			{
+				mode = blocking;
+				unsigned tail = *sq_tail;
+				for (; to_submit > 0; --to_submit)
+				{
+					--tail;
+					io_uring_sqe &sqe = sqes[sq_array[tail & *sq_mask]];
+					io_request *req = (io_request *)sqe.user_data;
+					int64_t done = (int64_t)sqe.off - req->offset;
+					int64_t res = transfer(req->fd, (int64_t)sqe.off, (uint8_t *)sqe.addr, sqe.len, req->write);
+					complete(req, (res < 0) ? res : res + done);
+				}
+				__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+				for (int idle = 0; in_flight > 0 && idle < 1000; )
+				{
+					if (collect() > 0)
+						idle = 0;
+					else
+					{
+						++idle;
+						std::this_thread::yield();
+					}
+				}
+			}
+			// ********************************
+
+			// ********************************
+			void complete(io_request *req, int64_t result)
+			{
+				req->result = result;
+				req->pending = false;
+				--in_flight;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Add a request to the SQ.  Submits first if the SQ is full.  Does the
+			// **** request right here if the ring had to be given up.
+			void push(io_request *req, int64_t done)
+			{
+				unsigned tail = *sq_tail;
+				if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= entries)
+				{
+					if (!enter(0))
+						fall_back();
+					while (mode == uring && tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= entries && reap(1))
+						;
+					if (mode != uring)
+					{
+						req->result = transfer(req->fd, req->offset + done, (uint8_t *)req->buffer + done, req->size - done, req->write);
+						if (req->result >= 0)
+							req->result += done;
+						req->pending = false;
+						return;
+					}
+				}
+
+				unsigned index = tail & *sq_mask;
+				io_uring_sqe *sqe = &sqes[index];
+				std::memset(sqe, 0, sizeof(*sqe));
+				sqe->opcode = req->write ? IORING_OP_WRITE : IORING_OP_READ;
+				sqe->fd = req->fd;
+				sqe->off = (uint64_t)(req->offset + done);
+				sqe->addr = (uint64_t)((uint8_t *)req->buffer + done);
+				sqe->len = (uint32_t)(req->size - done);
+				sqe->user_data = (uint64_t)req;
+				sq_array[index] = index;
+				__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+				++to_submit;
+				++in_flight;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Collect completions.  Waits for at least 'min_complete' of them.
+			// **** Returns false if the kernel won't let us wait.
+			bool reap(unsigned min_complete)
+			{
+				if (min_complete && !enter(min_complete))
+				{
+					// The ring is broken.  New requests are done the slow way.
+					fall_back();
+					return false;
+				}
+				collect();
+				return true;
+			}
+
+			// ********************************
+			// **** Collect the completions that are in the CQ.  Returns how many.
+			unsigned collect()
+			{
+				unsigned count = 0;
+				unsigned head = *cq_head;
+				while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+				{
+					io_uring_cqe *cqe = &cqes[head & *cq_mask];
+					io_request *req = (io_request *)cqe->user_data;
+					int res = cqe->res;
+					++head;
+					__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+					if (res == -EINVAL || res == -EOPNOTSUPP)
+					{
+						// Kernel is too old for IORING_OP_READ/WRITE.  Stop using the ring.
+						mode = blocking;
+						res = (int)transfer(req->fd, req->offset, (uint8_t *)req->buffer, req->size, req->write);
+					}
+					else if (res > 0 && (size_t)res < req->size)
+					{
+						// Short transfer.  Finish the rest right here.
+						int64_t rest = transfer(req->fd, req->offset + res, (uint8_t *)req->buffer + res, req->size - res, req->write);
+						res = (rest < 0) ? (int)rest : (int)(res + rest);
+					}
+					complete(req, res);
+					++count;
+				}
+				return count;
+			}
+			// ********************************
+		#endif
+		};
+		// **** End engine_ref class.
+		// ********************************
+
+		std::shared_ptr<engine_ref> p;
+
+	public:
+		// ********************************
+		io_engine() : p(nullptr) {}
+		~io_engine() {}
+		// ********************************
+
+		// ********************************
+		// **** Start the engine.  Asking for 'uring' where it isn't available gives a
+		// **** blocking engine, check get_mode() to see what you got.
+		bool open(int mode, unsigned entries = 256)
+		{
+			p = std::make_shared<engine_ref>();
+		#ifdef DSP_HAVE_IO_URING
+			if (mode == uring && p->setup(entries))
+				p->mode = uring;
+		#else
+			(void)mode;
+			(void)entries;
+		#endif
+			return true;
+		}
+
+		void close() { p = nullptr; }
+		// ********************************
+
+		// ********************************
+		bool is_open() const { return p != nullptr; }
+		int get_mode() const { return (p != nullptr) ? p->mode : blocking; }
+		bool is_async() const { return get_mode() != blocking; }
+		// ********************************
+
+		// ********************************
+		// **** Queue a request.  A blocking engine does it right away.  Nothing is sent
+		// **** to the kernel until submit() or wait().
+		void queue(io_request *req)
+		{
+			req->pending = true;
+			if (!is_async())
+			{
+				req->result = transfer(req->fd, req->offset, (uint8_t *)req->buffer, req->size, req->write);
+				req->pending = false;
+				return;
+			}
+
+		#ifdef DSP_HAVE_IO_URING
+			std::lock_guard<std::mutex> l(p->lock);
+			p->push(req, 0);
+		#endif
+		}
+		// ********************************
+
+		// ********************************
+		// **** Send everything queued since the last call to the kernel in one system
+		// **** call and pick up any completions that are already there.
+		void submit()
+		{
+		#ifdef DSP_HAVE_IO_URING
+			if (!is_async())
+				return;
+			std::lock_guard<std::mutex> l(p->lock);
+			if (p->to_submit && !p->enter(0))
+				p->fall_back();
+			p->reap(0);
+		#endif
+		}
+		// ********************************
+
+		// ********************************
+		// **** Wait until 'req' is done.  Returns true if it transferred every byte.
+		bool wait(io_request *req)
+		{
+		#ifdef DSP_HAVE_IO_URING
+			if (p != nullptr && req->pending)
+			{
+				std::lock_guard<std::mutex> l(p->lock);
+				while (req->pending)
+				{
+					if (!p->reap(1) && req->pending)
+					{
+						req->result = -EIO;
+						req->pending = false;
+					}
+				}
+			}
+		#endif
+			return req->succeeded();
+		}
+
+		// **** Wait until every request is done.
+		void wait_all()
+		{
+		#ifdef DSP_HAVE_IO_URING
+			if (p == nullptr)
+				return;
+			std::lock_guard<std::mutex> l(p->lock);
+			while (p->in_flight && p->reap(1))
+				;
+		#endif
+		}
+		// ********************************
+
+		// ********************************
+		// **** Open an existing file for unbuffered transfers.  Returns -1 if the platform
+		// **** or the file system can't do it (tmpfs, network shares...) and the caller
+		// **** should stay with its normal descriptor.  Offsets, sizes and buffers used
+		// **** with the descriptor must be multiples of get_direct_alignment().
+		static int open_direct(const std::string &path, bool write)
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			HANDLE h = CreateFileA(path.c_str(), write ? GENERIC_WRITE : GENERIC_READ,
+				FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+			if (h == INVALID_HANDLE_VALUE)
+				return -1;
+			int fd = _open_osfhandle((intptr_t)h, (write ? _O_WRONLY : _O_RDONLY) | _O_BINARY);
+			if (fd < 0)
+				CloseHandle(h);
+			return fd;
+		#elif defined(O_DIRECT)
+			return ::open(path.c_str(), (write ? O_WRONLY : O_RDONLY) | O_DIRECT);
+		#elif defined(F_NOCACHE)
+			int fd = ::open(path.c_str(), write ? O_WRONLY : O_RDONLY);
+			if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) != 0)
+			{
+				::close(fd);
+				fd = -1;
+			}
+			return fd;
+		#else
+			(void)path;
+			(void)write;
+			return -1;
+		#endif
+		}
+
+		static void close_direct(int fd)
+		{
+			if (fd < 0)
+				return;
+		#if defined(_WIN32) || defined(_WIN64)
+			_close(fd);
+		#else
+			::close(fd);
+		#endif
+		}
+
+		// **** Alignment needed by unbuffered transfers on 'fd'.  Never less than 4096 so
+		// **** it covers both 512 byte and 4K sector drives.
+		static int64_t get_direct_alignment(int fd)
+		{
+			int64_t align = 4096;
+		#if defined(__linux__) && defined(STATX_DIOALIGN)
+			struct statx stx;
+			if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN))
+			{
+				if (stx.stx_dio_offset_align > align)
+					align = stx.stx_dio_offset_align;
+				if (stx.stx_dio_mem_align > align)
+					align = stx.stx_dio_mem_align;
+			}
+		#else
+			(void)fd;
+		#endif
+			return align;
+		}
+		// ********************************
+	};
+	// **** End io_engine
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
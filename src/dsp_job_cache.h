@@ -0,0 +1,319 @@
+﻿/* Cache of finished jobs for incremental processing.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   A job is known by the outputs it writes.  For every job that finished the
+ * cache keeps a signature of what went into it, that is the operation and its
+ * parameters plus the path, size and modification time of every input, and the
+ * size and modification time of every output it wrote.  When the same job comes
+ * round again with the same signature and its outputs are still as they were
+ * left, the job can be skipped.
+ *
+ *   Size and time miss a file that was changed within the same second without
+ * changing its size.  set_hash(true) adds a hash of the whole content of every
+ * input to the signature, which costs a read of the input but no decoding.
+ *
+ *   Like probe_cache the entries can be kept in a file between runs.  The cache
+ * can be used from several threads at once.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "dsp_probe.h"
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::job_cache - Signatures and outputs of finished jobs keyed by job.
+	class job_cache
+	{
+	private:
+		class output_stamp
+		{
+		public:
+			std::string	path;
+			int64_t		size;
+			int64_t		mtime;
+			output_stamp() : size(0), mtime(0) {}
+		};
+
+		class entry
+		{
+		public:
+			std::string signature;
+			std::vector<output_stamp> outputs;
+		};
+
+		// ********************************
+		// **** cache_ref class.  The cache file is written when the last copy goes away.
+		class cache_ref
+		{
+		public:
+			std::mutex	lock;
+			std::string path;		// Cache file.  Empty keeps the cache in memory only.
+			std::unordered_map<std::string, entry> entries;
+			bool		dirty;
+
+			cache_ref() : dirty(false) {}
+			~cache_ref() { save(); }
+
+			static uint32_t get_magic() { return 0x44534A01; }
+
+			static bool put_string(std::FILE *f, const std::string &s)
+			{
+				uint32_t length = (uint32_t)s.size();
+				return std::fwrite(&length, sizeof(length), 1, f) == 1 && std::fwrite(s.data(), 1, length, f) == length;
+			}
+
+			static bool get_string(std::FILE *f, std::string &s)
+			{
+				uint32_t length;
+				if (std::fread(&length, sizeof(length), 1, f) != 1 || length > 0x100000)
+					return false;
+				s.assign(length, '\0');
+				return std::fread(&s[0], 1, length, f) == length;
+			}
+
+			bool save()
+			{
+				std::unique_lock<std::mutex> l(lock);
+				if (!dirty || path.empty())
+					return true;
+
+				std::FILE *f = std::fopen(path.c_str(), "wb");
+				if (f == nullptr)
+					return false;
+
+				uint32_t magic = get_magic();
+				bool ok = std::fwrite(&magic, sizeof(magic), 1, f) == 1;
+				for (auto &e : entries)
+				{
+					uint32_t count = (uint32_t)e.second.outputs.size();
+					ok = ok &&
+						put_string(f, e.first) &&
+						put_string(f, e.second.signature) &&
+						std::fwrite(&count, sizeof(count), 1, f) == 1;
+					for (auto &o : e.second.outputs)
+					{
+						ok = ok &&
+							put_string(f, o.path) &&
+							std::fwrite(&o.size, sizeof(o.size), 1, f) == 1 &&
+							std::fwrite(&o.mtime, sizeof(o.mtime), 1, f) == 1;
+					}
+				}
+				ok = (std::fclose(f) == 0) && ok;
+				dirty = !ok;
+				return ok;
+			}
+
+			bool load()
+			{
+				std::FILE *f = std::fopen(path.c_str(), "rb");
+				if (f == nullptr)
+					return false;
+
+				uint32_t magic;
+				bool ok = std::fread(&magic, sizeof(magic), 1, f) == 1 && magic == get_magic();
+				std::string job;
+				while (ok && get_string(f, job))
+				{
+					entry e;
+					uint32_t count;
+					if (!get_string(f, e.signature) || std::fread(&count, sizeof(count), 1, f) != 1 || count > 0x10000)
+						break;
+					e.outputs.resize(count);
+					bool good = true;
+					for (auto &o : e.outputs)
+					{
+						good = good &&
+							get_string(f, o.path) &&
+							std::fread(&o.size, sizeof(o.size), 1, f) == 1 &&
+							std::fread(&o.mtime, sizeof(o.mtime), 1, f) == 1;
+					}
+					if (!good)
+						break;
+					entries[job] = e;
+				}
+				std::fclose(f);
+				return ok;
+			}
+		};
+		// **** End cache_ref class.
+		// ********************************
+
+		std::shared_ptr<cache_ref> p;
+		bool hash;
+
+		// ********************************
+		// **** 64-bit hash of the whole file.  Mixes eight bytes at a time.
+		static bool hash_file(const std::string &path, uint64_t &h)
+		{
+			std::FILE *f = std::fopen(path.c_str(), "rb");
+			if (f == nullptr)
+				return false;
+
+			std::vector<uint64_t> buffer(128 * 1024);
+			h = 0x9E3779B97F4A7C15ull;
+			size_t n;
+			while ((n = std::fread(buffer.data(), 1, buffer.size() * sizeof(uint64_t), f)) > 0)
+			{
+				// Zero the tail of a short read so it hashes the same every time.
+				size_t words = (n + 7) / 8;
+				if (n % 8)
+					std::memset((uint8_t *)buffer.data() + n, 0, words * 8 - n);
+				for (size_t i = 0; i < words; ++i)
+				{
+					h ^= buffer[i];
+					h *= 0xFF51AFD7ED558CCDull;
+					h ^= h >> 32;
+				}
+				h ^= n;
+			}
+			bool ok = !std::ferror(f);
+			std::fclose(f);
+			return ok;
+		}
+
+	public:
+		// ********************************
+		job_cache() : p(std::make_shared<cache_ref>()), hash(false) {}
+		~job_cache() {}
+		// ********************************
+
+		// ********************************
+		// **** Use 'path' to keep the cache between runs.  Entries already in the file are
+		// **** loaded.  A missing or stale file starts an empty cache.  Returns false and
+		// **** leaves the cache closed if 'path' can't be read or created.
+		bool open(const std::string &path)
+		{
+			p = std::make_shared<cache_ref>();
+			if (!probe_cache::can_use_file(path))
+				return false;
+			p->path = path;
+			p->load();
+			return true;
+		}
+
+		// **** Write the cache file now instead of when the cache goes away.
+		bool save() { return p->save(); }
+
+		// **** Drop the cache file.  Nothing is skipped until open() is called again.
+		// **** Returns false if the cache file could not be written first.
+		bool close()
+		{
+			bool ret = p->save();
+			p = std::make_shared<cache_ref>();
+			return ret;
+		}
+
+		bool is_open() const { return !p->path.empty(); }
+
+		// **** Add a hash of the content of the inputs to their signature.
+		void set_hash(bool enable) { hash = enable; }
+		// ********************************
+
+		// ********************************
+		// **** Add the identity of input 'path' to a signature.  Returns false if the file
+		// **** can't be looked at, in which case the job should just run.
+		bool add_input(std::string &signature, const std::string &path)
+		{
+			int64_t size, mtime;
+			if (!probe_cache::get_file_stamp(path, size, mtime))
+				return false;
+			signature += "|" + path + ":" + std::to_string(size) + ":" + std::to_string(mtime);
+			if (hash)
+			{
+				uint64_t h;
+				if (!hash_file(path, h))
+					return false;
+				signature += ":" + std::to_string(h);
+			}
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** True when 'job' finished before with the same signature and every output
+		// **** it wrote is still there with the size and time it was left with.
+		bool is_done(const std::string &job, const std::string &signature)
+		{
+			std::unique_lock<std::mutex> l(p->lock);
+			auto it = p->entries.find(job);
+			if (it == p->entries.end() || it->second.signature != signature || it->second.outputs.empty())
+				return false;
+
+			for (auto &o : it->second.outputs)
+			{
+				int64_t size, mtime;
+				if (!probe_cache::get_file_stamp(o.path, size, mtime) || size != o.size || mtime != o.mtime)
+					return false;
+			}
+			return true;
+		}
+
+		// ********************************
+		// **** Remember that 'job' finished and wrote 'outputs'.
+		void set_done(const std::string &job, const std::string &signature, const std::vector<std::string> &outputs)
+		{
+			entry e;
+			e.signature = signature;
+			for (auto &path : outputs)
+			{
+				output_stamp o;
+				o.path = path;
+				if (!probe_cache::get_file_stamp(path, o.size, o.mtime))
+					return;
+				e.outputs.push_back(o);
+			}
+
+			std::unique_lock<std::mutex> l(p->lock);
+			p->entries[job] = e;
+			p->dirty = true;
+		}
+
+		// **** Forget 'job', e.g. when it failed half way.
+		void forget(const std::string &job)
+		{
+			std::unique_lock<std::mutex> l(p->lock);
+			if (p->entries.erase(job))
+				p->dirty = true;
+		}
+		// ********************************
+	};
+	// **** End job_cache
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
@@ -0,0 +1,321 @@
+﻿/* Scheduler for jobs that run in the background.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   A job is handed over as a function that does the work and returns true on
+ * success, plus optional functions to ask it to stop and to tell how far it
+ * got.  submit() queues the job and returns its id straight away.  The jobs
+ * run on the shared thread_pool in the order they were submitted, no more of
+ * them at once than set_workers() allows, so hundreds of jobs can be queued
+ * without starting hundreds of threads.  The work a job splits into segments
+ * or files runs on the same pool.
+ *
+ *   Every job has an owner, usually the object the job works on.  Only one job
+ * of an owner can be queued or running at a time since two jobs on the same
+ * object would trip over each other.
+ *
+ *   A finished job keeps its status until release() so it can still be polled.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "dsp_thread_pool.h"
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::job_scheduler - Runs queued jobs on the thread pool.
+	class job_scheduler
+	{
+	public:
+		enum { unknown = 0, queued, running, done, failed, cancelled };
+
+		typedef std::function<bool()> work_t;							// Does the job.  Returns false if it failed.
+		typedef std::function<void(bool)> cancel_t;						// Asks a running job to stop, or takes that back with false.
+		typedef std::function<void(int64_t &done, int64_t &total)> progress_t;	// Tells how far a running job got.
+
+	private:
+		class job
+		{
+		public:
+			const void	*owner;
+			work_t		work;
+			cancel_t	cancel;
+			progress_t	progress;
+			int			status;
+			bool		cancel_requested;
+			job() : owner(nullptr), status(queued), cancel_requested(false) {}
+		};
+
+		std::mutex					lock;
+		std::condition_variable		finished;	// A job finished.
+		std::map<int, std::shared_ptr<job>> jobs;
+		std::deque<int>				pending;
+		thread_pool					&pool;
+		task_group					group;		// The jobs that were started.
+		int							max_workers;	// 0 is one per worker of the pool.
+		int							next_id;
+		int							active;		// Jobs started on the pool.
+		bool						stopping;
+
+		// ********************************
+		// **** Start queued jobs on the pool while fewer than the limit run.  Call with
+		// **** the lock held.
+		void start_jobs()
+		{
+			int limit = (max_workers > 0) ? max_workers : pool.get_workers();
+			while (!stopping && !pending.empty() && active < limit)
+			{
+				int id = pending.front();
+				pending.pop_front();
+				std::shared_ptr<job> j = jobs[id];
+				j->status = running;
+				++active;
+				group.run([this, j] { run_job(j); });
+			}
+		}
+
+		// ********************************
+		// **** Run one job on a worker of the pool, then start the next.
+		void run_job(std::shared_ptr<job> j)
+		{
+			bool ret = false;
+			try { ret = j->work(); }
+			catch (...) { ret = false; }
+
+			std::unique_lock<std::mutex> l(lock);
+			// No cancel can come in once the job is no longer running, so a request that
+			// came too late to be seen is taken back here.  A job that finished anyway is
+			// done, since its output is good.
+			if (j->cancel)
+				j->cancel(false);
+			j->status = ret ? done : (j->cancel_requested ? cancelled : failed);
+			j->work = nullptr;	// Let go of anything the job holds on to.
+			--active;
+			finished.notify_all();
+			start_jobs();
+		}
+
+		// ********************************
+		// **** Id of the job of 'owner' that is queued or running, or 0.  Call with the
+		// **** lock held.
+		int find(const void *owner)
+		{
+			for (auto &p : jobs)
+			{
+				if (p.second->owner == owner && (p.second->status == queued || p.second->status == running))
+					return p.first;
+			}
+			return 0;
+		}
+
+	public:
+		// ********************************
+		job_scheduler() : pool(get_thread_pool()), group(pool), max_workers(0), next_id(1), active(0), stopping(false) {}
+		~job_scheduler()
+		{
+			{
+				std::unique_lock<std::mutex> l(lock);
+				for (auto &p : jobs)
+				{
+					if (p.second->status == running && p.second->cancel)
+						p.second->cancel(true);
+				}
+				stopping = true;
+			}
+			group.wait();
+		}
+		// ********************************
+
+		// ********************************
+		// **** Number of jobs that run at once.  0 is one per worker of the pool.  Fewer
+		// **** than are running already only takes effect as the running jobs finish.
+		void set_workers(int count)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			max_workers = std::max(0, count);
+			start_jobs();
+		}
+
+		// ********************************
+		// **** Queue a job.  Returns its id, or 0 when 'owner' already has a job that is
+		// **** queued or running.
+		int submit(const void *owner, work_t work, cancel_t cancel = nullptr, progress_t progress = nullptr)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			if (stopping || find(owner) != 0)
+				return 0;
+
+			auto j = std::make_shared<job>();
+			j->owner = owner;
+			j->work = work;
+			j->cancel = cancel;
+			j->progress = progress;
+
+			int id = next_id++;
+			if (next_id <= 0)
+				next_id = 1;
+			jobs[id] = j;
+			pending.push_back(id);
+			start_jobs();
+			return id;
+		}
+
+		// ********************************
+		// **** Status of a job and, while it runs, how far it got.  Returns 'unknown' for
+		// **** ids that were never submitted or were released.
+		int poll(int id, int64_t *done_frames = nullptr, int64_t *total_frames = nullptr)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			auto it = jobs.find(id);
+			if (it == jobs.end())
+				return unknown;
+
+			int64_t d = 0, t = 0;
+			if (it->second->progress)
+				it->second->progress(d, t);
+			if (done_frames)
+				*done_frames = d;
+			if (total_frames)
+				*total_frames = t;
+			return it->second->status;
+		}
+
+		// ********************************
+		// **** Wait until a job is finished or 'timeout_ms' milliseconds went by.  A
+		// **** negative timeout waits for as long as it takes.  Returns the status.
+		int wait(int id, int timeout_ms = -1)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			auto it = jobs.find(id);
+			if (it == jobs.end())
+				return unknown;
+
+			std::shared_ptr<job> j = it->second;
+			auto ready = [&j] { return j->status != queued && j->status != running; };
+			if (timeout_ms < 0)
+				finished.wait(l, ready);
+			else
+				finished.wait_for(l, std::chrono::milliseconds(timeout_ms), ready);
+			return j->status;
+		}
+
+		// ********************************
+		// **** Cancel a job.  A queued job never runs, a running job is asked to stop and
+		// **** is 'cancelled' once it did, or 'done' if it finished before it saw the
+		// **** request.  Returns false for unknown or finished jobs.
+		bool cancel(int id)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			auto it = jobs.find(id);
+			if (it == jobs.end())
+				return false;
+
+			std::shared_ptr<job> j = it->second;
+			if (j->status == queued)
+			{
+				pending.erase(std::find(pending.begin(), pending.end(), id));
+				j->status = cancelled;
+				j->cancel_requested = true;
+				j->work = nullptr;
+				finished.notify_all();
+				return true;
+			}
+			if (j->status == running)
+			{
+				j->cancel_requested = true;
+				if (j->cancel)
+					j->cancel(true);
+				return true;
+			}
+			return false;
+		}
+
+		// ********************************
+		// **** True while 'owner' has a job that is queued or running.
+		bool is_busy(const void *owner)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			return find(owner) != 0;
+		}
+
+		// ********************************
+		// **** Forget a finished job.  Returns false if it is still queued or running.
+		bool release(int id)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			auto it = jobs.find(id);
+			if (it == jobs.end() || it->second->status == queued || it->second->status == running)
+				return false;
+			jobs.erase(it);
+			return true;
+		}
+
+		// ********************************
+		// **** Cancel the job of 'owner', wait for it and forget every job it had.  Used
+		// **** before the owner is destroyed.
+		void remove_owner(const void *owner)
+		{
+			int id;
+			{
+				std::unique_lock<std::mutex> l(lock);
+				id = find(owner);
+			}
+			if (id != 0)
+			{
+				cancel(id);
+				wait(id);
+			}
+
+			std::unique_lock<std::mutex> l(lock);
+			for (auto it = jobs.begin(); it != jobs.end();)
+			{
+				if (it->second->owner == owner)
+					it = jobs.erase(it);
+				else
+					++it;
+			}
+		}
+		// ********************************
+	};
+	// **** End job_scheduler
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
@@ -0,0 +1,209 @@
+﻿/* Machine information the processes tune themselves with.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Cache sizes and CPU times come from the operating system, so this header
+ * pulls in the system headers.  It is kept apart from machine.h, which nearly
+ * every file includes, and is only included where it is used.
+ */
+
+#pragma once
+
+#include "configure.h"
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <fstream>
+#include <vector>
+
+// Cache size detection.
+#if defined(_WIN32) || defined(_WIN64)
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <Windows.h>
+#elif defined(__APPLE__)
+	#include <sys/types.h>
+	#include <sys/sysctl.h>
+#else
+	#include <unistd.h>
+#endif
+
+// CPU time.
+#if !defined(_WIN32) && !defined(_WIN64)
+	#include <time.h>
+#endif
+
+// ********************************
+// **** dsp namespace for dsp based classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::machine namespace for machine specific information.
+	namespace machine
+	{
+		// ********************************
+		// **** machine::cache_info - Data cache sizes in bytes.  Anything that can't be
+		// **** detected gets a typical value so callers never see 0.
+		class cache_info
+		{
+		public:
+			size_t line;	// Cache line.
+			size_t l1d;		// Level 1 data cache of one core.
+			size_t l2;		// Level 2 cache of one core.
+			size_t l3;		// Level 3 cache, usually shared by every core.
+
+			cache_info() : line(0), l1d(0), l2(0), l3(0) {}
+
+			void set_defaults()
+			{
+				if (line == 0)	line = 64;
+				if (l1d == 0)	l1d = 32 * 1024;
+				if (l2 == 0)	l2 = 256 * 1024;
+				if (l3 == 0)	l3 = 4 * l2;
+			}
+		};
+
+		// **** Ask the operating system.  Use get_cache_info() instead, it only asks once.
+		inline cache_info detect_cache_info()
+		{
+			cache_info info;
+
+		#if defined(_WIN32) || defined(_WIN64)
+			DWORD size = 0;
+			GetLogicalProcessorInformation(nullptr, &size);
+			std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> buffer(size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION) + 1);
+			if (GetLogicalProcessorInformation(buffer.data(), &size))
+			{
+				for (size_t i = 0; i < size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION); ++i)
+				{
+					if (buffer[i].Relationship != RelationCache)
+						continue;
+					CACHE_DESCRIPTOR &c = buffer[i].Cache;
+					if (c.Type != CacheData && c.Type != CacheUnified)
+						continue;
+					switch (c.Level)
+					{
+					case 1: info.l1d = c.Size; info.line = c.LineSize; break;
+					case 2: info.l2 = c.Size; break;
+					case 3: info.l3 = c.Size; break;
+					}
+				}
+			}
+		#elif defined(__APPLE__)
+			int64_t value = 0;
+			size_t length = sizeof(value);
+			if (sysctlbyname("hw.cachelinesize", &value, &length, nullptr, 0) == 0) info.line = (size_t)value;
+			length = sizeof(value);
+			if (sysctlbyname("hw.l1dcachesize", &value, &length, nullptr, 0) == 0) info.l1d = (size_t)value;
+			length = sizeof(value);
+			if (sysctlbyname("hw.l2cachesize", &value, &length, nullptr, 0) == 0) info.l2 = (size_t)value;
+			length = sizeof(value);
+			if (sysctlbyname("hw.l3cachesize", &value, &length, nullptr, 0) == 0) info.l3 = (size_t)value;
+		#else
+			#if defined(_SC_LEVEL2_CACHE_SIZE)
+				long value;
+				if ((value = sysconf(_SC_LEVEL1_DCACHE_LINESIZE)) > 0) info.line = value;
+				if ((value = sysconf(_SC_LEVEL1_DCACHE_SIZE)) > 0) info.l1d = value;
+				if ((value = sysconf(_SC_LEVEL2_CACHE_SIZE)) > 0) info.l2 = value;
+				if ((value = sysconf(_SC_LEVEL3_CACHE_SIZE)) > 0) info.l3 = value;
+			#endif
+
+			// Some systems (ARM mostly) only have it in sysfs.
+			for (int i = 0; i < 8 && (info.l2 == 0 || info.l3 == 0); ++i)
+			{
+				std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+				std::ifstream level_file(dir + "level"), type_file(dir + "type"), size_file(dir + "size");
+				int level = 0;
+				std::string type, text;
+				if (!(level_file >> level) || !(type_file >> type) || !(size_file >> text) || type == "Instruction")
+					continue;
+
+				size_t bytes = std::strtoul(text.c_str(), nullptr, 10);
+				switch (text.back())
+				{
+				case 'K': bytes *= 1024; break;
+				case 'M': bytes *= 1024 * 1024; break;
+				}
+				switch (level)
+				{
+				case 1: if (info.l1d == 0) info.l1d = bytes; break;
+				case 2: if (info.l2 == 0) info.l2 = bytes; break;
+				case 3: if (info.l3 == 0) info.l3 = bytes; break;
+				}
+			}
+		#endif
+
+			info.set_defaults();
+			return info;
+		}
+
+		inline const cache_info &get_cache_info()
+		{
+			static const cache_info info = detect_cache_info();
+			return info;
+		}
+		// **** End dsp::machine::cache_info
+		// ********************************
+
+
+		// ********************************
+		// **** CPU time in nanoseconds used by the calling thread, and by every thread of
+		// **** the process.  Only differences between two calls mean anything.  Windows
+		// **** counts in clock ticks so short spans may read as 0.
+		inline uint64_t thread_cpu_ns()
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			FILETIME created, exited, kernel, user;
+			if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+				return 0;
+			return ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+				(((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 100;
+		#else
+			timespec ts;
+			if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+				return 0;
+			return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+		#endif
+		}
+
+		inline uint64_t process_cpu_ns()
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			FILETIME created, exited, kernel, user;
+			if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+				return 0;
+			return ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+				(((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 100;
+		#else
+			timespec ts;
+			if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+				return 0;
+			return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+		#endif
+		}
+		// ********************************
+	}
+	// **** End dsp::machine namespace
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
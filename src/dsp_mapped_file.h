@@ -0,0 +1,529 @@
+﻿/* Memory mapped reader for uncompressed PCM sample data.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Once the offset and length of the sample data in a WAV/RF64/W64/AIFF/CAF
+ * file is known there is no need to go through libsndfile to read it.  This
+ * class maps the data chunk into memory a window at a time and either gives
+ * out a zero-copy view of the frames as sample<_Type, _Native> or converts
+ * them straight into the callers buffer.
+ *
+ *   In direct mode the window is read into an aligned buffer through a
+ * descriptor that bypasses the page cache instead of being mapped, so a file
+ * that is read once doesn't push everything else out of memory.
+ *
+ *   Only 16, 24 and 32-bit integer and 32/64-bit floating-point data is
+ * handled here.  8-bit data is signed or unsigned depending on the container
+ * so that is left to libsndfile.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(_WIN32) || defined(_WIN64)
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "sample.h"
+#include "dsp_containers.h"
+#include "dsp_io_engine.h"
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::mapped_pcm_reader - Reads PCM frames from a memory mapped data chunk.
+	class mapped_pcm_reader
+	{
+	private:
+		// ********************************
+		// **** mapping_ref class.  Holds the file handle and the current window so
+		// **** copies of the reader share one mapping, just like dspfile does.
+		class mapping_ref
+		{
+		public:
+		#if defined(_WIN32) || defined(_WIN64)
+			HANDLE		file;
+			HANDLE		map;
+		#else
+			int			fd;
+		#endif
+			uint8_t *	base;			// Start of the mapped window.
+			int64_t		base_offset;	// File offset of 'base'.
+			int64_t		base_size;		// Size of the mapped window in bytes.
+
+			int			direct_fd;		// Unbuffered descriptor in direct mode or -1.
+			std::vector<uint8_t, aligned_allocator<uint8_t>> buffer;	// The window in direct mode.
+
+			mapping_ref() : base(nullptr), base_offset(0), base_size(0), direct_fd(-1)
+			{
+			#if defined(_WIN32) || defined(_WIN64)
+				file = INVALID_HANDLE_VALUE;
+				map = NULL;
+			#else
+				fd = -1;
+			#endif
+			}
+
+			~mapping_ref()
+			{
+				unmap();
+				io_engine::close_direct(direct_fd);
+			#if defined(_WIN32) || defined(_WIN64)
+				if (map != NULL)
+					CloseHandle(map);
+				if (file != INVALID_HANDLE_VALUE)
+					CloseHandle(file);
+			#else
+				if (fd >= 0)
+					::close(fd);
+			#endif
+			}
+
+			void unmap()
+			{
+				if (base == nullptr)
+					return;
+				if (direct_fd < 0)
+				{
+				#if defined(_WIN32) || defined(_WIN64)
+					UnmapViewOfFile(base);
+				#else
+					munmap(base, (size_t)base_size);
+				#endif
+				}
+				base = nullptr;
+				base_offset = base_size = 0;
+			}
+		};
+		// **** End mapping_ref class.
+		// ********************************
+
+		std::shared_ptr<mapping_ref> p;
+
+		int64_t	data_offset;		// File offset of the first frame.
+		int64_t	frames;				// Total number of frames in the data chunk.
+		int64_t	position;			// Current frame for read_frames().
+		int64_t	window_size;		// Preferred size of a mapped window in bytes.
+		int		channels;
+		int		bytes_per_sample;
+		bool	floating_point;
+		bool	big_endian;			// Byte order of the samples in the file.
+
+		// ********************************
+		// **** Mapping offsets must be a multiple of the page size (allocation granularity on Windows).
+		static int64_t get_granularity()
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwAllocationGranularity;
+		#else
+			return sysconf(_SC_PAGESIZE);
+		#endif
+		}
+		// ********************************
+
+		// ********************************
+		// **** Make sure the bytes [offset, offset + size) of the file are inside the mapped window.
+		bool map_range(int64_t offset, int64_t size)
+		{
+			if (p->base != nullptr &&
+				offset >= p->base_offset &&
+				offset + size <= p->base_offset + p->base_size)
+				return true;
+
+			p->unmap();
+			if (p->direct_fd >= 0)
+				return read_range(offset, size);
+
+			int64_t gran = get_granularity();
+			int64_t start = offset - (offset % gran);
+			int64_t end = data_offset + frames * get_sizeof_frame();
+			int64_t length = (offset - start) + size;
+			if (length < window_size)
+				length = window_size;
+			if (start + length > end)
+				length = end - start;
+			if (length <= 0)
+				return false;
+
+		#if defined(_WIN32) || defined(_WIN64)
+			p->base = (uint8_t *)MapViewOfFile(p->map, FILE_MAP_READ,
+				(DWORD)((uint64_t)start >> 32), (DWORD)(start & 0xffffffff), (SIZE_T)length);
+			if (p->base == nullptr)
+				return false;
+		#else
+			void *ptr = mmap(nullptr, (size_t)length, PROT_READ, MAP_SHARED, p->fd, (off_t)start);
+			if (ptr == MAP_FAILED)
+				return false;
+			p->base = (uint8_t *)ptr;
+
+			// We read front to back so let the kernel read ahead aggressively.
+			madvise(p->base, (size_t)length, MADV_SEQUENTIAL);
+			madvise(p->base, (size_t)length, MADV_WILLNEED);
+		#endif
+
+			p->base_offset = start;
+			p->base_size = length;
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Direct mode.  Read the window into the aligned buffer instead of mapping it.
+		bool read_range(int64_t offset, int64_t size)
+		{
+			const int64_t align = 4096;
+			int64_t start = offset - (offset % align);
+			int64_t end = data_offset + frames * get_sizeof_frame();
+			int64_t length = (offset - start) + size;
+			if (length < window_size)
+				length = window_size;
+			if (start + length > end)
+				length = end - start;
+			if (length <= 0)
+				return false;
+
+			int64_t aligned = ((length + align - 1) / align) * align;
+			if ((int64_t)p->buffer.size() < aligned)
+				p->buffer.resize((size_t)aligned);
+
+			int64_t got = read_direct(start, p->buffer.data(), aligned);
+			if (got < 0)
+				got = 0;
+
+			// The end of the file is usually not a whole block, and some file systems turn
+			// down unbuffered reads now and then.  Whatever is missing is read normally.
+			if (got < length && !read_buffered(start + got, p->buffer.data() + got, length - got))
+				return false;
+
+			p->base = p->buffer.data();
+			p->base_offset = start;
+			p->base_size = length;
+			return true;
+		}
+
+		int64_t read_direct(int64_t offset, uint8_t *ptr, int64_t size)
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			if (_lseeki64(p->direct_fd, offset, SEEK_SET) != offset)
+				return -1;
+			return _read(p->direct_fd, ptr, (unsigned int)size);
+		#else
+			return pread(p->direct_fd, ptr, (size_t)size, (off_t)offset);
+		#endif
+		}
+
+		bool read_buffered(int64_t offset, uint8_t *ptr, int64_t size)
+		{
+			while (size > 0)
+			{
+			#if defined(_WIN32) || defined(_WIN64)
+				OVERLAPPED ov = {};
+				ov.Offset = (DWORD)(offset & 0xffffffff);
+				ov.OffsetHigh = (DWORD)((uint64_t)offset >> 32);
+				DWORD n = 0;
+				if (!ReadFile(p->file, ptr, (DWORD)std::min<int64_t>(size, 0x40000000), &n, &ov))
+					return false;
+				int64_t ret = n;
+			#else
+				int64_t ret = pread(p->fd, ptr, (size_t)size, (off_t)offset);
+			#endif
+				if (ret <= 0)
+					return false;
+				ptr += ret;
+				offset += ret;
+				size -= ret;
+			}
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Convert 'count' samples of _TypeSrc from the file into the callers buffer.
+		template <typename _TypeSrc, typename _Type>
+		void convert(const uint8_t *src, _Type *dst, int64_t count)
+		{
+			sample<_Type> *out = (sample<_Type> *)dst;
+			if (big_endian != (BIG_ENDIAN != 0))
+			{
+				const sample<_TypeSrc, false> *in = (const sample<_TypeSrc, false> *)src;
+				for (int64_t i = 0; i < count; ++i)
+					out[i] = in[i];
+			}
+			else if (std::is_same<_TypeSrc, _Type>::value)
+			{
+				// Same type and byte order.  Nothing to convert.
+				std::memcpy(dst, src, (size_t)(count * sizeof(_Type)));
+			}
+			else
+			{
+				const sample<_TypeSrc, true> *in = (const sample<_TypeSrc, true> *)src;
+				for (int64_t i = 0; i < count; ++i)
+					out[i] = in[i];
+			}
+		}
+		// ********************************
+
+	public:
+		// ********************************
+		// **** Default window size is 64MB.  The window is moved along as the file is read.
+		mapped_pcm_reader() :
+			p(nullptr), data_offset(0), frames(0), position(0), window_size(64 * 1024 * 1024),
+			channels(0), bytes_per_sample(0), floating_point(false), big_endian(false)
+		{}
+		~mapped_pcm_reader() {}
+		// ********************************
+
+		// ********************************
+		// **** Returns true if the reader can handle this kind of sample data.
+		static bool is_supported(int bits, bool is_float)
+		{
+			if (is_float)
+				return (bits == 32 || bits == 64);
+			return (bits == 16 || bits == 24 || bits == 32);
+		}
+		// ********************************
+
+		// ********************************
+		// **** Open 'path' and prepare to map 'data_length' bytes of sample data at 'offset'.
+		// **** With 'direct' the data is read around the page cache when the file system
+		// **** allows it.
+		bool open(const std::string &path, int64_t offset, int64_t data_length,
+			int _channels, int bits, bool is_float, bool is_big_endian, bool direct = false)
+		{
+			close();
+
+			if (!is_supported(bits, is_float) || _channels <= 0 || offset < 0 || data_length <= 0)
+				return false;
+
+			p = std::make_shared<mapping_ref>();
+
+		#if defined(_WIN32) || defined(_WIN64)
+			p->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+				OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (p->file == INVALID_HANDLE_VALUE)
+			{
+				p = nullptr;
+				return false;
+			}
+
+			LARGE_INTEGER size;
+			GetFileSizeEx(p->file, &size);
+			int64_t file_size = size.QuadPart;
+
+			p->map = CreateFileMappingA(p->file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (p->map == NULL)
+			{
+				p = nullptr;
+				return false;
+			}
+		#else
+			p->fd = ::open(path.c_str(), O_RDONLY);
+			if (p->fd < 0)
+			{
+				p = nullptr;
+				return false;
+			}
+
+			struct stat st;
+			if (fstat(p->fd, &st) != 0)
+			{
+				p = nullptr;
+				return false;
+			}
+			int64_t file_size = st.st_size;
+		#endif
+
+			// Files that were not closed properly can claim more data than they hold.
+			if (offset + data_length > file_size)
+				data_length = file_size - offset;
+
+			channels = _channels;
+			bytes_per_sample = (bits + 7) / 8;
+			floating_point = is_float;
+			big_endian = is_big_endian;
+			data_offset = offset;
+			frames = data_length / get_sizeof_frame();
+			position = 0;
+
+			if (frames <= 0)
+			{
+				close();
+				return false;
+			}
+
+			if (direct)
+			{
+				p->direct_fd = io_engine::open_direct(path, false);
+				if (p->direct_fd >= 0 && io_engine::get_direct_alignment(p->direct_fd) != 4096)
+				{
+					io_engine::close_direct(p->direct_fd);
+					p->direct_fd = -1;
+				}
+
+				// Smaller windows keep the aligned buffer a reasonable size.
+				if (window_size > 8 * 1024 * 1024)
+					window_size = 8 * 1024 * 1024;
+			}
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		void close()
+		{
+			p = nullptr;
+			frames = position = 0;
+		}
+
+		bool is_open() const { return (p != nullptr); }
+		bool is_direct() const { return (p != nullptr) && p->direct_fd >= 0; }
+		// ********************************
+
+		// ********************************
+		int64_t	get_frames() const			{ return frames; }
+		int		get_channels() const		{ return channels; }
+		int64_t	get_sizeof_frame() const	{ return (int64_t)bytes_per_sample * channels; }
+		int		get_bytes_per_sample() const { return bytes_per_sample; }
+		bool	is_float() const			{ return floating_point; }
+		bool	is_big_endian() const		{ return big_endian; }
+		int64_t	get_data_offset() const		{ return data_offset; }
+		int64_t	tell() const				{ return position; }
+		void	set_window_size(int64_t bytes)	{ window_size = bytes; }
+		// ********************************
+
+		// ********************************
+		// **** Same meaning as dspfile::seek().  Returns the new position or -1.
+		int64_t seek(int64_t frame, int whence)
+		{
+			switch (whence)
+			{
+			case SEEK_CUR: frame += position; break;
+			case SEEK_END: frame += frames; break;
+			}
+			if (frame < 0 || frame > frames)
+				return -1;
+			return position = frame;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Zero-copy access to the encoded bytes of 'frame_count' frames starting at 'frame'.
+		// **** The pointer is valid until the next call that moves the window.
+		const uint8_t *raw(int64_t frame, int64_t frame_count)
+		{
+			if (!is_open() || frame < 0 || frame + frame_count > frames)
+				return nullptr;
+
+			int64_t offset = data_offset + frame * get_sizeof_frame();
+			if (!map_range(offset, frame_count * get_sizeof_frame()))
+				return nullptr;
+
+			return p->base + (offset - p->base_offset);
+		}
+		// ********************************
+
+		// ********************************
+		// **** Zero-copy view of the frames as samples.  _Type must match the file
+		// **** (int16_t, int24_t, int32_t, float or double) and _Native must be true
+		// **** when the file uses the byte order of this machine.
+		template <typename _Type, bool _Native>
+		const sample<_Type, _Native> *view(int64_t frame, int64_t frame_count)
+		{
+			if (sizeof(_Type) != (size_t)bytes_per_sample || _Native != (big_endian == (BIG_ENDIAN != 0)))
+				return nullptr;
+			return (const sample<_Type, _Native> *)raw(frame, frame_count);
+		}
+		// ********************************
+
+		// ********************************
+		// **** Read frames converting to _Type.  Works like dspfile::read_frames().
+		template <typename _Type>
+		int64_t read_frames(_Type *ptr, int64_t frame_count)
+		{
+			if (frame_count > frames - position)
+				frame_count = frames - position;
+			if (frame_count <= 0)
+				return 0;
+
+			const uint8_t *src = raw(position, frame_count);
+			if (src == nullptr)
+				return 0;
+
+			int64_t count = frame_count * channels;
+			switch (bytes_per_sample)
+			{
+			case 2: convert<int16_t>(src, ptr, count); break;
+			case 3: convert<int24_t>(src, ptr, count); break;
+			case 4:
+				if (floating_point)
+					convert<float>(src, ptr, count);
+				else
+					convert<int32_t>(src, ptr, count);
+				break;
+			case 8: convert<double>(src, ptr, count); break;
+			default:
+				return 0;
+			}
+
+			// Ask for the next part of the file while this part is being processed.
+			#if !defined(_WIN32) && !defined(_WIN64)
+				int64_t next = data_offset + (position + frame_count) * get_sizeof_frame();
+				int64_t base_end = p->base_offset + p->base_size;
+				if (p->direct_fd < 0 && next < base_end)
+				{
+					int64_t gran = get_granularity();
+					int64_t start = next - (next % gran);
+					int64_t length = frame_count * get_sizeof_frame();
+					if (start + length > base_end)
+						length = base_end - start;
+					madvise(p->base + (start - p->base_offset), (size_t)length, MADV_WILLNEED);
+				}
+			#endif
+
+			position += frame_count;
+			return frame_count;
+		}
+		// ********************************
+	};
+	// **** End mapped_pcm_reader
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
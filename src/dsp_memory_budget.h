@@ -0,0 +1,206 @@
+﻿/* Memory budget shared by every process in the program.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Each process works out how much memory its buffers and queues will take
+ * and leases it from the budget before it allocates anything.  When the rest
+ * of the budget is too small for the block size it wanted it gets a smaller
+ * block size, down to a floor it names.  When even that doesn't fit it waits
+ * for other processes to give memory back.  A process that needs more than
+ * the whole budget still runs, but only when nothing else holds any.
+ *
+ *   The budget has no limit until set_limit() is called.  The counters tell
+ * how often processes had to wait or shrink.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** Counters for a memory_budget.
+	class memory_budget_stats
+	{
+	public:
+		int64_t limit;			// Bytes in the budget.  0 is no limit.
+		int64_t in_use;			// Bytes leased right now.
+		int64_t peak;			// Most bytes leased at once.
+		uint64_t leases;		// Leases handed out.
+		uint64_t waits;			// Leases that had to wait for memory.
+		uint64_t wait_ns;		// Nanoseconds spent waiting.
+		uint64_t shrinks;		// Leases that got less than they asked for.
+		memory_budget_stats() : limit(0), in_use(0), peak(0), leases(0), waits(0), wait_ns(0), shrinks(0) {}
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::memory_budget - Bytes that processes lease before they allocate buffers.
+	class memory_budget
+	{
+	private:
+		std::mutex				lock;
+		std::condition_variable	freed;
+		memory_budget_stats		stats;
+
+	public:
+		// ********************************
+		memory_budget() {}
+		~memory_budget() {}
+		// ********************************
+
+		// ********************************
+		// **** Bytes processes may hold at once.  0 takes the limit away.  Leases that
+		// **** are out already are kept.
+		void set_limit(int64_t bytes)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			stats.limit = std::max<int64_t>(0, bytes);
+			freed.notify_all();
+		}
+
+		memory_budget_stats get_stats()
+		{
+			std::unique_lock<std::mutex> l(lock);
+			return stats;
+		}
+
+		// Start counting again.  The limit and the leases that are out stay.
+		void reset_stats()
+		{
+			std::unique_lock<std::mutex> l(lock);
+			stats.peak = stats.in_use;
+			stats.leases = stats.waits = stats.wait_ns = stats.shrinks = 0;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Take up to 'want' bytes and no less than 'least'.  Waits while 'least' doesn't
+		// **** fit.  Gives up and returns 0 once 'cancel' is set.  'waited' and 'shrunk' tell
+		// **** whether it had to wait or got less than 'want'.
+		int64_t acquire(int64_t want, int64_t least, const std::atomic<bool> *cancel = nullptr, bool *waited = nullptr, bool *shrunk = nullptr)
+		{
+			want = std::max<int64_t>(0, want);
+			least = std::max<int64_t>(0, std::min(least, want));
+
+			std::unique_lock<std::mutex> l(lock);
+			auto fits = [&] { return stats.limit <= 0 || stats.in_use == 0 || stats.in_use + least <= stats.limit; };
+			if (!fits())
+			{
+				++stats.waits;
+				if (waited)
+					*waited = true;
+				auto start = std::chrono::steady_clock::now();
+				while (!fits())
+				{
+					if (cancel != nullptr && *cancel)
+						break;
+					freed.wait_for(l, std::chrono::milliseconds(10));
+				}
+				stats.wait_ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - start).count();
+				if (!fits())
+					return 0;
+			}
+
+			int64_t got = want;
+			if (stats.limit > 0 && stats.in_use + want > stats.limit)
+			{
+				got = std::max(least, stats.limit - stats.in_use);
+				++stats.shrinks;
+				if (shrunk)
+					*shrunk = true;
+			}
+			stats.in_use += got;
+			stats.peak = std::max(stats.peak, stats.in_use);
+			++stats.leases;
+			return got;
+		}
+
+		void release(int64_t bytes)
+		{
+			if (bytes <= 0)
+				return;
+			std::unique_lock<std::mutex> l(lock);
+			stats.in_use -= bytes;
+			freed.notify_all();
+		}
+		// ********************************
+
+		// ********************************
+		// **** Gives the bytes back when it goes out of scope.
+		class lease
+		{
+			memory_budget	*budget;
+			int64_t			bytes;
+			lease(const lease &) = delete;
+			lease &operator=(const lease &) = delete;
+		public:
+			lease() : budget(nullptr), bytes(0) {}
+			~lease() { release(); }
+
+			int64_t acquire(memory_budget &b, int64_t want, int64_t least, const std::atomic<bool> *cancel = nullptr, bool *waited = nullptr, bool *shrunk = nullptr)
+			{
+				release();
+				budget = &b;
+				bytes = b.acquire(want, least, cancel, waited, shrunk);
+				return bytes;
+			}
+
+			void release()
+			{
+				if (budget != nullptr)
+					budget->release(bytes);
+				budget = nullptr;
+				bytes = 0;
+			}
+
+			int64_t get_bytes() const { return bytes; }
+		};
+		// ********************************
+	};
+	// **** End memory_budget
+	// ********************************
+
+
+	// ********************************
+	// **** The budget shared by every process in the program.
+	inline memory_budget &get_memory_budget()
+	{
+		static memory_budget budget;
+		return budget;
+	}
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
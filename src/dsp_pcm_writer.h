@@ -0,0 +1,906 @@
+﻿/* Native writer for uncompressed PCM files.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Writes 16, 24 and 32-bit integer and 32/64-bit floating-point samples to
+ * WAV, RF64 and W64 files, and integer samples to AIFF files, without going
+ * through libsndfile.  The expected size of the file is reserved up front so
+ * the file system can give us one contiguous piece of disk, samples are
+ * written in large blocks that start on a 4096 byte boundary in the file and
+ * the header (and bext chunk) is patched with the real sizes at close.
+ *
+ *   A WAV file reserves room for a ds64 chunk in a JUNK chunk so it can be
+ * turned into an RF64 file in place if the data grows past 4GB.
+ *
+ *   Given an asynchronous io_engine the writer keeps two staging buffers.  One
+ * is filled while the other is being written by the kernel.
+ *
+ *   In direct mode full staging buffers go through a second descriptor that
+ * bypasses the page cache.  The header and the last partial buffer can't be
+ * aligned so they always go through the normal descriptor.
+ *
+ *   When the length is known up front set_frames() writes the header and fixes
+ * the size of the sample data.  After that any number of threads can write
+ * their own ranges of frames with write_frames_at().
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <io.h>
+	#include <Windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "sndfile.h"
+#include "sample.h"
+#include "dsp_containers.h"
+#include "dsp_io_engine.h"
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::pcm_writer - Writes PCM frames straight to a WAV/RF64/W64/AIFF file.
+	class pcm_writer
+	{
+	private:
+		// ********************************
+		// **** writer_ref class.  Holds the open file.  The file is finished when the
+		// **** last copy of the writer goes away, just like dspfile does with SNDFILE.
+		class writer_ref
+		{
+		public:
+			int			fd;
+			int			direct_fd;		// Unbuffered descriptor for full staging buffers or -1.
+			int			container;		// SF_FORMAT_WAV, SF_FORMAT_RF64, SF_FORMAT_W64 or SF_FORMAT_AIFF.
+			int			channels;
+			int			rate;
+			int			bytes_per_sample;
+			bool		floating_point;
+			bool		big_endian;
+
+			int64_t		data_offset;	// File offset of the first frame.  Always a multiple of 4096.
+			int64_t		data_bytes;		// Bytes of sample data written so far.
+			int64_t		reserved;		// Bytes reserved on disk at open.
+
+			std::vector<uint8_t, aligned_allocator<uint8_t>> buffers[2];	// Staging buffers for encoded frames.
+			io_request				requests[2];	// Last write of each staging buffer.
+			int						current;		// Buffer being filled.
+			size_t					used;			// Bytes used in the current buffer.
+			io_engine				io;
+
+			bool		has_bext;
+			SF_BROADCAST_INFO bext;
+			std::vector<std::pair<int, std::string>> strings;
+
+			bool		header_written;
+			std::string	error;
+			std::mutex	lock;			// File position on Windows and 'error' while segments are written.
+
+			writer_ref() :
+				fd(-1), direct_fd(-1), container(0), channels(0), rate(0), bytes_per_sample(0), floating_point(false), big_endian(false),
+				data_offset(0), data_bytes(0), reserved(0), current(0), used(0), has_bext(false), header_written(false)
+			{
+				std::memset(&bext, 0, sizeof(bext));
+			}
+
+			~writer_ref()
+			{
+				finish();
+			}
+
+			int64_t get_sizeof_frame() const { return (int64_t)bytes_per_sample * channels; }
+
+			// ********************************
+			// **** Write 'size' bytes at 'offset'.  Sets the error string on failure.
+			bool write_at(int64_t offset, const void *ptr, size_t size)
+			{
+				const uint8_t *src = (const uint8_t *)ptr;
+				while (size > 0)
+				{
+				#if defined(_WIN32) || defined(_WIN64)
+					int ret = -1;
+					{
+						std::lock_guard<std::mutex> l(lock);
+						if (_lseeki64(fd, offset, SEEK_SET) >= 0)
+							ret = _write(fd, src, (unsigned int)std::min<size_t>(size, 0x40000000));
+					}
+				#else
+					ssize_t ret = pwrite(fd, src, size, (off_t)offset);
+				#endif
+					if (ret <= 0)
+					{
+						fail("pcm_writer: Write failed.  The disk may be full.\n");
+						return false;
+					}
+					src += ret;
+					offset += ret;
+					size -= ret;
+				}
+				return true;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Remember the first thing that went wrong.
+			void fail(const std::string &msg)
+			{
+				std::lock_guard<std::mutex> l(lock);
+				if (error.empty())
+					error = msg;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Reserve 'size' bytes of disk space for the file without changing its size.
+			void preallocate(int64_t size)
+			{
+				if (size <= 0)
+					return;
+			#if defined(_WIN32) || defined(_WIN64)
+				FILE_ALLOCATION_INFO info;
+				info.AllocationSize.QuadPart = size;
+				SetFileInformationByHandle((HANDLE)_get_osfhandle(fd), FileAllocationInfo, &info, sizeof(info));
+			#elif defined(__linux__)
+				if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)size) != 0)
+					posix_fallocate(fd, 0, (off_t)size);
+			#else
+				posix_fallocate(fd, 0, (off_t)size);
+			#endif
+				reserved = size;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Little helpers for building headers.
+			void put_bytes(std::vector<uint8_t> &h, const void *p, size_t n)	{ h.insert(h.end(), (const uint8_t *)p, (const uint8_t *)p + n); }
+			void put_id(std::vector<uint8_t> &h, const char *id)				{ put_bytes(h, id, 4); }
+			void put_zeros(std::vector<uint8_t> &h, size_t n)					{ h.insert(h.end(), n, 0); }
+
+			void put_le(std::vector<uint8_t> &h, uint64_t v, int n)
+			{
+				for (int i = 0; i < n; ++i)
+					h.push_back((uint8_t)(v >> (i * 8)));
+			}
+
+			void put_be(std::vector<uint8_t> &h, uint64_t v, int n)
+			{
+				for (int i = n - 1; i >= 0; --i)
+					h.push_back((uint8_t)(v >> (i * 8)));
+			}
+
+			// W64 chunk ids are GUIDs that start with the four character code.
+			void put_guid(std::vector<uint8_t> &h, const char *id)
+			{
+				static const uint8_t riff_tail[12] = { 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00 };
+				static const uint8_t tail[12] = { 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+				put_id(h, id);
+				put_bytes(h, (std::strncmp(id, "riff", 4) == 0) ? riff_tail : tail, 12);
+			}
+
+			// AIFF stores the sample rate as an 80-bit IEEE extended float.
+			void put_extended(std::vector<uint8_t> &h, uint32_t value)
+			{
+				int exponent = 16383 + 31;
+				uint64_t mantissa = value;
+				if (mantissa == 0)
+					exponent = 0;
+				else
+				{
+					mantissa <<= 32;
+					while (!(mantissa & 0x8000000000000000ull))
+					{
+						mantissa <<= 1;
+						--exponent;
+					}
+				}
+				put_be(h, exponent, 2);
+				put_be(h, mantissa, 8);
+			}
+
+			// The bext chunk body, coding history included.
+			void put_bext(std::vector<uint8_t> &h)
+			{
+				put_bytes(h, bext.description, sizeof(bext.description));
+				put_bytes(h, bext.originator, sizeof(bext.originator));
+				put_bytes(h, bext.originator_reference, sizeof(bext.originator_reference));
+				put_bytes(h, bext.origination_date, sizeof(bext.origination_date));
+				put_bytes(h, bext.origination_time, sizeof(bext.origination_time));
+				put_le(h, bext.time_reference_low, 4);
+				put_le(h, bext.time_reference_high, 4);
+				put_le(h, (uint16_t)bext.version, 2);
+				put_bytes(h, bext.umid, sizeof(bext.umid));
+				put_bytes(h, bext.reserved, sizeof(bext.reserved));
+				put_bytes(h, bext.coding_history, get_coding_history_size());
+			}
+
+			size_t get_coding_history_size() const
+			{
+				size_t size = bext.coding_history_size;
+				if (size > sizeof(bext.coding_history))
+					size = sizeof(bext.coding_history);
+				return size;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Four character codes for string metadata.  Returns nullptr if the
+			// **** container has no place for the string.
+			const char *get_string_id(int str_type) const
+			{
+				if (container == SF_FORMAT_AIFF)
+				{
+					switch (str_type)
+					{
+					case SF_STR_TITLE:		return "NAME";
+					case SF_STR_ARTIST:		return "AUTH";
+					case SF_STR_COPYRIGHT:	return "(c) ";
+					case SF_STR_COMMENT:	return "ANNO";
+					}
+					return nullptr;
+				}
+				if (container == SF_FORMAT_W64)
+					return nullptr;
+
+				switch (str_type)
+				{
+				case SF_STR_TITLE:			return "INAM";
+				case SF_STR_COPYRIGHT:		return "ICOP";
+				case SF_STR_SOFTWARE:		return "ISFT";
+				case SF_STR_ARTIST:			return "IART";
+				case SF_STR_COMMENT:		return "ICMT";
+				case SF_STR_DATE:			return "ICRD";
+				case SF_STR_ALBUM:			return "IPRD";
+				case SF_STR_TRACKNUMBER:	return "ITRK";
+				case SF_STR_GENRE:			return "IGNR";
+				}
+				return nullptr;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Build the header for 'bytes' of sample data.  The size of the header
+			// **** only depends on the format, the bext chunk and the strings so the
+			// **** header written at close fits exactly over the one written at open.
+			void build_header(std::vector<uint8_t> &h, int64_t bytes)
+			{
+				h.clear();
+				int64_t frames = bytes / get_sizeof_frame();
+				int64_t pad = bytes & 1;
+				int bits = bytes_per_sample * 8;
+				int format_tag = floating_point ? 3 : 1;
+
+				if (container == SF_FORMAT_AIFF)
+				{
+					put_id(h, "FORM");
+					put_be(h, 0, 4);	// Patched below.
+					put_id(h, "AIFF");
+
+					put_id(h, "COMM");
+					put_be(h, 18, 4);
+					put_be(h, channels, 2);
+					put_be(h, (uint32_t)frames, 4);
+					put_be(h, bits, 2);
+					put_extended(h, rate);
+
+					for (auto &s : strings)
+					{
+						const char *id = get_string_id(s.first);
+						put_id(h, id);
+						put_be(h, s.second.size(), 4);
+						put_bytes(h, s.second.data(), s.second.size());
+						if (s.second.size() & 1)
+							put_zeros(h, 1);
+					}
+
+					// The SSND offset field pads the start of the data to a 4096 byte boundary.
+					int64_t offset = (4096 - ((h.size() + 16) % 4096)) % 4096;
+					put_id(h, "SSND");
+					put_be(h, (uint32_t)(8 + offset + bytes), 4);
+					put_be(h, (uint32_t)offset, 4);
+					put_be(h, 0, 4);
+					put_zeros(h, (size_t)offset);
+
+					int64_t form_size = h.size() - 8 + bytes + pad;
+					for (int i = 0; i < 4; ++i)
+						h[4 + i] = (uint8_t)(form_size >> ((3 - i) * 8));
+				}
+				else if (container == SF_FORMAT_W64)
+				{
+					put_guid(h, "riff");
+					put_le(h, 0, 8);	// Patched below.
+					put_guid(h, "wave");
+
+					put_guid(h, "fmt ");
+					put_le(h, 24 + 16, 8);
+					put_le(h, format_tag, 2);
+					put_le(h, channels, 2);
+					put_le(h, rate, 4);
+					put_le(h, rate * get_sizeof_frame(), 4);
+					put_le(h, get_sizeof_frame(), 2);
+					put_le(h, bits, 2);
+
+					if (floating_point)
+					{
+						put_guid(h, "fact");
+						put_le(h, 24 + 8, 8);
+						put_le(h, frames, 8);
+					}
+
+					if (has_bext)
+					{
+						size_t size = 602 + get_coding_history_size();
+						put_guid(h, "bext");
+						put_le(h, 24 + size, 8);
+						put_bext(h);
+						put_zeros(h, (8 - (size % 8)) % 8);
+					}
+
+					// Pad the start of the data to a 4096 byte boundary.
+					int64_t junk = (4096 - ((h.size() + 48) % 4096)) % 4096;
+					put_guid(h, "junk");
+					put_le(h, 24 + junk, 8);
+					put_zeros(h, (size_t)junk);
+
+					put_guid(h, "data");
+					put_le(h, 24 + bytes, 8);
+
+					int64_t riff_size = h.size() + bytes + ((8 - (bytes % 8)) % 8);
+					for (int i = 0; i < 8; ++i)
+						h[16 + i] = (uint8_t)(riff_size >> (i * 8));
+				}
+				else
+				{
+					// WAV and RF64.  A WAV file becomes an RF64 file when it can't hold the data.
+					put_id(h, "RIFF");
+					put_le(h, 0, 4);	// Patched below.
+					put_id(h, "WAVE");
+
+					// JUNK chunk that becomes the ds64 chunk for RF64.
+					size_t ds64_pos = h.size();
+					put_id(h, "JUNK");
+					put_le(h, 28, 4);
+					put_zeros(h, 28);
+
+					put_id(h, "fmt ");
+					put_le(h, floating_point ? 18 : 16, 4);
+					put_le(h, format_tag, 2);
+					put_le(h, channels, 2);
+					put_le(h, rate, 4);
+					put_le(h, rate * get_sizeof_frame(), 4);
+					put_le(h, get_sizeof_frame(), 2);
+					put_le(h, bits, 2);
+					if (floating_point)
+					{
+						put_le(h, 0, 2);
+
+						put_id(h, "fact");
+						put_le(h, 4, 4);
+						put_le(h, (frames > 0xffffffff) ? 0xffffffff : frames, 4);
+					}
+
+					if (has_bext)
+					{
+						size_t size = 602 + get_coding_history_size();
+						put_id(h, "bext");
+						put_le(h, size, 4);
+						put_bext(h);
+						if (size & 1)
+							put_zeros(h, 1);
+					}
+
+					if (!strings.empty())
+					{
+						size_t list_pos = h.size();
+						put_id(h, "LIST");
+						put_le(h, 0, 4);	// Patched below.
+						put_id(h, "INFO");
+						for (auto &s : strings)
+						{
+							size_t size = s.second.size() + 1;
+							put_id(h, get_string_id(s.first));
+							put_le(h, size, 4);
+							put_bytes(h, s.second.c_str(), size);
+							if (size & 1)
+								put_zeros(h, 1);
+						}
+						uint32_t list_size = (uint32_t)(h.size() - list_pos - 8);
+						for (int i = 0; i < 4; ++i)
+							h[list_pos + 4 + i] = (uint8_t)(list_size >> (i * 8));
+					}
+
+					// Pad the start of the data to a 4096 byte boundary.
+					int64_t junk = (4096 - ((h.size() + 16) % 4096)) % 4096;
+					put_id(h, "JUNK");
+					put_le(h, junk, 4);
+					put_zeros(h, (size_t)junk);
+
+					put_id(h, "data");
+					put_le(h, 0, 4);	// Patched below.
+
+					int64_t riff_size = h.size() - 8 + bytes + pad;
+					bool rf64 = (container == SF_FORMAT_RF64) || (riff_size > 0xffffffffll);
+					if (rf64)
+					{
+						std::vector<uint8_t> ds64;
+						put_id(ds64, "ds64");
+						put_le(ds64, 28, 4);
+						put_le(ds64, riff_size, 8);
+						put_le(ds64, bytes, 8);
+						put_le(ds64, frames, 8);
+						put_le(ds64, 0, 4);
+						std::copy(ds64.begin(), ds64.end(), h.begin() + ds64_pos);
+						std::memcpy(h.data(), "RF64", 4);
+						riff_size = 0xffffffff;
+					}
+
+					int64_t data_size = rf64 ? 0xffffffff : bytes;
+					for (int i = 0; i < 4; ++i)
+					{
+						h[4 + i] = (uint8_t)(riff_size >> (i * 8));
+						h[h.size() - 4 + i] = (uint8_t)(data_size >> (i * 8));
+					}
+				}
+			}
+			// ********************************
+
+			// ********************************
+			// **** Write the header if this is the first write.
+			bool write_header()
+			{
+				if (header_written)
+					return true;
+
+				std::vector<uint8_t> h;
+				build_header(h, 0);
+				data_offset = h.size();
+				header_written = true;
+				return write_at(0, h.data(), h.size());
+			}
+			// ********************************
+
+			// ********************************
+			// **** Wait for the last write of a staging buffer.
+			bool wait(int index)
+			{
+				if (io.wait(&requests[index]))
+					return true;
+				error = "pcm_writer: Write failed.  The disk may be full.\n";
+				return false;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Write the current staging buffer to disk.  With an asynchronous engine
+			// **** the write is only queued and we move on to the other buffer.
+			bool flush()
+			{
+				if (!write_header())
+					return false;
+				if (used == 0)
+					return true;
+
+				// Only whole blocks can bypass the page cache.  That is every buffer but the last.
+				int out = (direct_fd >= 0 && (used % 4096) == 0) ? direct_fd : fd;
+				requests[current].set(out, data_offset + data_bytes, buffers[current].data(), used, true);
+				io.queue(&requests[current]);
+				data_bytes += used;
+				used = 0;
+
+				if (io.is_async())
+					current ^= 1;
+				return wait(current);
+			}
+			// ********************************
+
+			// ********************************
+			// **** Flush, patch the header with the real sizes and close the file.
+			bool finish()
+			{
+				if (fd < 0)
+					return error.empty();
+
+				bool ret = flush() && error.empty();
+				ret = wait(0) && ret;
+				ret = wait(1) && ret;
+				io_engine::close_direct(direct_fd);
+				direct_fd = -1;
+
+				// AIFF can't hold more than 4GB.
+				if (container == SF_FORMAT_AIFF && data_offset + data_bytes > 0xffffffffll)
+				{
+					error = "pcm_writer: AIFF file is larger than 4GB.\n";
+					ret = false;
+				}
+
+				// Chunks are padded to an even size, W64 chunks to a multiple of 8.
+				int64_t pad = (container == SF_FORMAT_W64) ? ((8 - (data_bytes % 8)) % 8) : (data_bytes & 1);
+				if (ret && pad)
+				{
+					static const uint8_t zeros[8] = { 0 };
+					ret = write_at(data_offset + data_bytes, zeros, (size_t)pad);
+				}
+
+				if (ret)
+				{
+					std::vector<uint8_t> h;
+					build_header(h, data_bytes);
+					ret = write_at(0, h.data(), h.size());
+				}
+
+				// Give back any reserved space we didn't use.
+			#if defined(_WIN32) || defined(_WIN64)
+				_chsize_s(fd, data_offset + data_bytes + pad);
+				_close(fd);
+			#else
+				if (ftruncate(fd, (off_t)(data_offset + data_bytes + pad)) != 0)
+					ret = false;
+				::close(fd);
+			#endif
+				fd = -1;
+				return ret;
+			}
+			// ********************************
+		};
+		// **** End writer_ref class.
+		// ********************************
+
+		std::shared_ptr<writer_ref> p;
+
+		// ********************************
+		// **** Encode 'count' samples of _Type into the file's sample type.
+		template <typename _TypeDst, typename _Type>
+		void encode(const _Type *src, uint8_t *dst, int64_t count)
+		{
+			const sample<_Type> *in = (const sample<_Type> *)src;
+			if (p->big_endian != (BIG_ENDIAN != 0))
+			{
+				sample<_TypeDst, false> *out = (sample<_TypeDst, false> *)dst;
+				for (int64_t i = 0; i < count; ++i)
+					out[i] = in[i];
+			}
+			else if (std::is_same<_TypeDst, _Type>::value)
+			{
+				// Same type and byte order.  Nothing to convert.
+				std::memcpy(dst, src, (size_t)(count * sizeof(_Type)));
+			}
+			else
+			{
+				sample<_TypeDst, true> *out = (sample<_TypeDst, true> *)dst;
+				for (int64_t i = 0; i < count; ++i)
+					out[i] = in[i];
+			}
+		}
+
+		template <typename _Type>
+		void encode_samples(const _Type *src, uint8_t *dst, int64_t count)
+		{
+			switch (p->bytes_per_sample)
+			{
+			case 2: encode<int16_t>(src, dst, count); break;
+			case 3: encode<int24_t>(src, dst, count); break;
+			case 4:
+				if (p->floating_point)
+					encode<float>(src, dst, count);
+				else
+					encode<int32_t>(src, dst, count);
+				break;
+			case 8: encode<double>(src, dst, count); break;
+			}
+		}
+		// ********************************
+
+	public:
+		// ********************************
+		pcm_writer() : p(nullptr) {}
+		~pcm_writer() {}
+		// ********************************
+
+		// ********************************
+		// **** Returns true if this writer can write the libsndfile format 'sf_format'.
+		static bool is_supported(int sf_format)
+		{
+			int container = sf_format & SF_FORMAT_TYPEMASK;
+			switch (sf_format & SF_FORMAT_SUBMASK)
+			{
+			case SF_FORMAT_PCM_16:
+			case SF_FORMAT_PCM_24:
+			case SF_FORMAT_PCM_32:
+				break;
+			case SF_FORMAT_FLOAT:
+			case SF_FORMAT_DOUBLE:
+				// AIFF needs AIFC for floating-point.
+				if (container == SF_FORMAT_AIFF)
+					return false;
+				break;
+			default:
+				return false;
+			}
+
+			// Default endianness only.  That is little for WAV/RF64/W64 and big for AIFF.
+			if (sf_format & SF_FORMAT_ENDMASK)
+				return false;
+
+			switch (container)
+			{
+			case SF_FORMAT_WAV:
+			case SF_FORMAT_RF64:
+			case SF_FORMAT_W64:
+			case SF_FORMAT_AIFF:
+				return true;
+			}
+			return false;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Create the file 'path' and reserve room for 'expected_frames' frames.  With
+		// **** 'direct' the sample data is written around the page cache when the file
+		// **** system allows it.  Samples are written 'buffer_bytes' at a time, rounded
+		// **** down to whole frames and 4096 byte blocks.
+		bool open(const std::string &path, int sf_format, int channels, int rate, int64_t expected_frames,
+			bool direct = false, int64_t buffer_bytes = 4 * 1024 * 1024)
+		{
+			close();
+			if (!is_supported(sf_format) || channels <= 0 || rate <= 0)
+				return false;
+
+			p = std::make_shared<writer_ref>();
+			p->container = sf_format & SF_FORMAT_TYPEMASK;
+			p->channels = channels;
+			p->rate = rate;
+			p->big_endian = (p->container == SF_FORMAT_AIFF);
+
+			switch (sf_format & SF_FORMAT_SUBMASK)
+			{
+			case SF_FORMAT_PCM_16:	p->bytes_per_sample = 2; break;
+			case SF_FORMAT_PCM_24:	p->bytes_per_sample = 3; break;
+			case SF_FORMAT_PCM_32:	p->bytes_per_sample = 4; break;
+			case SF_FORMAT_FLOAT:	p->bytes_per_sample = 4; p->floating_point = true; break;
+			case SF_FORMAT_DOUBLE:	p->bytes_per_sample = 8; p->floating_point = true; break;
+			}
+
+		#if defined(_WIN32) || defined(_WIN64)
+			p->fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+		#else
+			p->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		#endif
+			if (p->fd < 0)
+			{
+				p = nullptr;
+				return false;
+			}
+
+			if (direct)
+			{
+				p->direct_fd = io_engine::open_direct(path, true);
+				if (p->direct_fd >= 0 && io_engine::get_direct_alignment(p->direct_fd) != 4096)
+				{
+					io_engine::close_direct(p->direct_fd);
+					p->direct_fd = -1;
+				}
+			}
+
+			// The staging buffer holds whole frames and is a multiple of 4096 bytes
+			// so every block lands on a 4096 byte boundary in the file.
+			int64_t unit = p->get_sizeof_frame() * 4096;
+			int64_t blocks = buffer_bytes / unit;
+			p->buffers[0].resize((size_t)(((blocks > 0) ? blocks : 1) * unit));
+
+			// Header is at most a few pages.
+			if (expected_frames > 0)
+				p->preallocate(65536 + expected_frames * p->get_sizeof_frame());
+
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Finish the file.  Returns false if anything went wrong while writing.
+		bool close()
+		{
+			bool ret = true;
+			if (p != nullptr)
+			{
+				ret = p->finish();
+				if (!ret && p->error.empty())
+					p->error = "pcm_writer: Could not finish the file.\n";
+			}
+			return ret;
+		}
+		// ********************************
+
+		// ********************************
+		bool is_open() const { return (p != nullptr) && (p->fd >= 0); }
+		int get_channels() const { return (p != nullptr) ? p->channels : 0; }
+		int get_bytes_per_sample() const { return (p != nullptr) ? p->bytes_per_sample : 0; }
+		bool is_float() const { return (p != nullptr) && p->floating_point; }
+		bool is_big_endian() const { return (p != nullptr) && p->big_endian; }
+		bool is_direct() const { return (p != nullptr) && p->direct_fd >= 0; }
+		int64_t get_buffer_bytes() const { return (p != nullptr) ? (int64_t)(p->buffers[0].capacity() + p->buffers[1].capacity()) : 0; }
+		const char *get_error_str() const { return (p != nullptr) ? p->error.c_str() : ""; }
+		// ********************************
+
+		// ********************************
+		// **** Send sample data through 'engine'.  Must be set before the first frames
+		// **** are written.  An asynchronous engine only gets the writes queued, the
+		// **** owner of the engine decides when to submit them.
+		bool set_io_engine(const io_engine &engine)
+		{
+			if (!is_open() || p->header_written)
+				return false;
+			p->io = engine;
+			if (p->io.is_async())
+				p->buffers[1].resize(p->buffers[0].size());
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Metadata.  Must be set before the first frames are written.
+		bool set_bext(const SF_BROADCAST_INFO &info)
+		{
+			if (!is_open() || p->header_written || p->container == SF_FORMAT_AIFF)
+				return false;
+			p->bext = info;
+			p->has_bext = true;
+			return true;
+		}
+
+		bool set_string(int str_type, const char *str)
+		{
+			if (!is_open() || p->header_written || str == nullptr || p->get_string_id(str_type) == nullptr)
+				return false;
+			for (auto &s : p->strings)
+			{
+				if (s.first == str_type)
+				{
+					s.second = str;
+					return true;
+				}
+			}
+			p->strings.emplace_back(str_type, str);
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Write frames of _Type.  Works like dspfile::write_frames().
+		template <typename _Type>
+		int64_t write_frames(const _Type *ptr, int64_t frame_count)
+		{
+			if (!is_open())
+				return 0;
+
+			int64_t frame_size = p->get_sizeof_frame();
+			int64_t done = 0;
+			while (done < frame_count)
+			{
+				int64_t space = (int64_t)(p->buffers[p->current].size() - p->used) / frame_size;
+				if (space == 0)
+				{
+					if (!p->flush())
+						return done;
+					continue;
+				}
+
+				int64_t n = std::min(space, frame_count - done);
+				encode_samples(ptr + done * p->channels, p->buffers[p->current].data() + p->used, n * p->channels);
+
+				p->used += (size_t)(n * frame_size);
+				done += n;
+			}
+			return done;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Direct access to the staging buffer for frames that are already encoded
+		// **** the way the file wants them.  reserve() returns room for at most
+		// **** 'frame_count' frames and sets 'frame_count' to how many fit.  commit()
+		// **** adds that many frames to the file.  Returns nullptr if a write failed.
+		uint8_t *reserve(int64_t &frame_count)
+		{
+			if (!is_open())
+			{
+				frame_count = 0;
+				return nullptr;
+			}
+
+			int64_t frame_size = p->get_sizeof_frame();
+			int64_t space = (int64_t)(p->buffers[p->current].size() - p->used) / frame_size;
+			if (space == 0)
+			{
+				if (!p->flush())
+				{
+					frame_count = 0;
+					return nullptr;
+				}
+				space = (int64_t)(p->buffers[p->current].size() - p->used) / frame_size;
+			}
+
+			if (frame_count > space)
+				frame_count = space;
+			return p->buffers[p->current].data() + p->used;
+		}
+
+		void commit(int64_t frame_count)
+		{
+			if (is_open())
+				p->used += (size_t)(frame_count * p->get_sizeof_frame());
+		}
+		// ********************************
+
+		// ********************************
+		// **** Segments.  set_frames() writes the header and fixes the length of the file
+		// **** at 'frame_count' frames before anything else is written.  Then each thread
+		// **** writes its own frames with write_frames_at(), encoding them in 'scratch'.
+		// **** fail() makes close() report 'msg' for a segment that couldn't be finished.
+		bool set_frames(int64_t frame_count)
+		{
+			if (!is_open() || p->header_written || frame_count < 0 || !p->write_header())
+				return false;
+			p->data_bytes = frame_count * p->get_sizeof_frame();
+			return true;
+		}
+
+		template <typename _Type>
+		int64_t write_frames_at(int64_t frame, const _Type *ptr, int64_t frame_count, std::vector<uint8_t> &scratch)
+		{
+			if (!is_open() || frame < 0 || (frame + frame_count) * p->get_sizeof_frame() > p->data_bytes)
+				return 0;
+
+			scratch.resize((size_t)(frame_count * p->get_sizeof_frame()));
+			encode_samples(ptr, scratch.data(), frame_count * p->channels);
+			if (!p->write_at(p->data_offset + frame * p->get_sizeof_frame(), scratch.data(), scratch.size()))
+				return 0;
+			return frame_count;
+		}
+
+		void fail(const std::string &msg)
+		{
+			if (p != nullptr)
+				p->fail(msg);
+		}
+		// ********************************
+	};
+	// **** End pcm_writer
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
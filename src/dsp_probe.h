@@ -0,0 +1,706 @@
+﻿/* Header probe for uncompressed PCM files.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Opening a file with libsndfile just to find out how many channels it has
+ * parses every chunk in the file.  This reads the chunk headers of a WAV, RF64,
+ * W64, AIFF/AIFC or CAF file and the few chunks we care about (fmt, ds64, COMM,
+ * desc, bext) and skips over everything else, the sample data included.
+ *
+ *   probe_cache remembers the results by path, size and modification time and
+ * can keep them in a file between runs so an unchanged library is never read
+ * again.  Files the probe doesn't understand (compressed data, odd containers)
+ * return false so the caller can fall back to libsndfile.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "sndfile.h"
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::probe_info - What the probe found out about a file.  Plain data so the
+	// **** cache can store it as is.
+	class probe_info
+	{
+	public:
+		int		container;		// SF_FORMAT_WAV, SF_FORMAT_RF64, SF_FORMAT_W64, SF_FORMAT_AIFF or SF_FORMAT_CAF.
+		int		subformat;		// SF_FORMAT_PCM_16, SF_FORMAT_FLOAT...
+		int		channels;
+		int		bits;
+		int		rate;
+		bool	floating_point;
+		bool	big_endian;		// Byte order of the samples.
+		bool	has_bext;
+		bool	extensible;		// WAV fmt chunk is WAVE_FORMAT_EXTENSIBLE.
+		int64_t	data_offset;	// File offset of the first frame.
+		int64_t	data_bytes;		// Size of the sample data in bytes.
+		int64_t	frames;
+		SF_BROADCAST_INFO bext;
+
+		probe_info() { clear(); }
+		void clear() { std::memset(this, 0, sizeof(*this)); }
+
+		int get_sf_format() const { return container | subformat | (big_endian ? SF_ENDIAN_BIG : SF_ENDIAN_LITTLE); }
+
+		// Major format as libsndfile reports it, which calls an extensible WAV "WAVEX".
+		int get_major_format() const { return (container == SF_FORMAT_WAV && extensible) ? SF_FORMAT_WAVEX : container; }
+	};
+	// **** End probe_info
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::file_probe - Reads the header of a PCM file without libsndfile.
+	class file_probe
+	{
+	private:
+		int			fd;
+		int64_t		file_size;
+		std::string	error;
+
+		// ********************************
+		// **** Read 'size' bytes at 'offset'.  Short reads are errors.
+		bool read_at(int64_t offset, void *buffer, int64_t size)
+		{
+			if (offset < 0 || offset + size > file_size)
+				return false;
+		#if defined(_WIN32) || defined(_WIN64)
+			if (_lseeki64(fd, offset, SEEK_SET) != offset)
+				return false;
+			return _read(fd, buffer, (unsigned int)size) == size;
+		#else
+			return pread(fd, buffer, (size_t)size, offset) == size;
+		#endif
+		}
+		// ********************************
+
+		// ********************************
+		// **** Helpers to take numbers out of a header.
+		static uint64_t get_le(const uint8_t *b, int n)
+		{
+			uint64_t v = 0;
+			for (int i = n - 1; i >= 0; --i)
+				v = (v << 8) | b[i];
+			return v;
+		}
+
+		static uint64_t get_be(const uint8_t *b, int n)
+		{
+			uint64_t v = 0;
+			for (int i = 0; i < n; ++i)
+				v = (v << 8) | b[i];
+			return v;
+		}
+
+		static bool is_id(const uint8_t *b, const char *id) { return std::memcmp(b, id, 4) == 0; }
+
+		// AIFF stores the sample rate as an 80-bit IEEE extended float.
+		static int get_extended(const uint8_t *b)
+		{
+			int exponent = (int)(get_be(b, 2) & 0x7FFF) - 16383 - 63;
+			uint64_t mantissa = get_be(b + 2, 8);
+			if (exponent >= 0 || exponent < -63)
+				return 0;
+			return (int)(mantissa >> -exponent);
+		}
+
+		static int get_double_be(const uint8_t *b)
+		{
+			uint64_t v = get_be(b, 8);
+			double d;
+			std::memcpy(&d, &v, sizeof(d));
+			return (int)(d + 0.5);
+		}
+		// ********************************
+
+		// ********************************
+		// **** Pick the libsndfile subformat.  Only what the native reader and writer
+		// **** handle is accepted.
+		bool set_subformat(probe_info &info)
+		{
+			if (info.channels <= 0 || info.rate <= 0)
+			{
+				error = "file_probe: Missing or bad format chunk.\n";
+				return false;
+			}
+
+			if (info.floating_point)
+			{
+				switch (info.bits)
+				{
+				case 32: info.subformat = SF_FORMAT_FLOAT; return true;
+				case 64: info.subformat = SF_FORMAT_DOUBLE; return true;
+				}
+			}
+			else
+			{
+				switch (info.bits)
+				{
+				case 16: info.subformat = SF_FORMAT_PCM_16; return true;
+				case 24: info.subformat = SF_FORMAT_PCM_24; return true;
+				case 32: info.subformat = SF_FORMAT_PCM_32; return true;
+				}
+			}
+			error = "file_probe: Unsupported sample format.\n";
+			return false;
+		}
+
+		// The data chunk of a file that was never finished can say 0 or run past the end.
+		void set_data(probe_info &info, int64_t offset, int64_t size)
+		{
+			info.data_offset = offset;
+			if (size <= 0 || offset + size > file_size)
+				size = file_size - offset;
+			info.data_bytes = size;
+		}
+
+		void read_bext(probe_info &info, int64_t offset, int64_t size)
+		{
+			if (size > 602 + (int64_t)sizeof(info.bext.coding_history))
+				size = 602 + (int64_t)sizeof(info.bext.coding_history);
+			std::vector<uint8_t> b((size_t)size);
+			if (size < 602 || !read_at(offset, b.data(), size))
+				return;
+
+			SF_BROADCAST_INFO &x = info.bext;
+			const uint8_t *s = b.data();
+			std::memcpy(x.description, s, sizeof(x.description));			s += sizeof(x.description);
+			std::memcpy(x.originator, s, sizeof(x.originator));				s += sizeof(x.originator);
+			std::memcpy(x.originator_reference, s, sizeof(x.originator_reference)); s += sizeof(x.originator_reference);
+			std::memcpy(x.origination_date, s, sizeof(x.origination_date));	s += sizeof(x.origination_date);
+			std::memcpy(x.origination_time, s, sizeof(x.origination_time));	s += sizeof(x.origination_time);
+			x.time_reference_low = (uint32_t)get_le(s, 4);						s += 4;
+			x.time_reference_high = (uint32_t)get_le(s, 4);					s += 4;
+			x.version = (short)get_le(s, 2);									s += 2;
+			std::memcpy(x.umid, s, sizeof(x.umid));								s += sizeof(x.umid);
+			std::memcpy(x.reserved, s, sizeof(x.reserved));						s += sizeof(x.reserved);
+
+			int64_t history = size - 602;
+			if (history > (int64_t)sizeof(x.coding_history))
+				history = sizeof(x.coding_history);
+			x.coding_history_size = (uint32_t)history;
+			std::memcpy(x.coding_history, b.data() + 602, (size_t)history);
+			info.has_bext = true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** WAV and RF64.  Chunks are a four character code and a 32-bit size.
+		bool scan_riff(probe_info &info, bool rf64)
+		{
+			uint8_t b[40];
+			int64_t ds64_data = -1;
+			bool have_fmt = false;
+			int64_t pos = 12;
+
+			info.container = rf64 ? SF_FORMAT_RF64 : SF_FORMAT_WAV;
+			while (pos + 8 <= file_size && read_at(pos, b, 8))
+			{
+				int64_t size = (int64_t)get_le(b + 4, 4);
+				int64_t body = pos + 8;
+
+				if (is_id(b, "ds64") && size >= 24 && read_at(body, b, 24))
+					ds64_data = (int64_t)get_le(b + 8, 8);
+				else if (is_id(b, "fmt ") && size >= 16 && read_at(body, b, (size >= 40) ? 40 : 16))
+				{
+					int tag = (int)get_le(b, 2);
+					info.extensible = (tag == 0xFFFE);
+					if (tag == 0xFFFE && size >= 40)
+						tag = (int)get_le(b + 24, 2);	// First two bytes of the subformat GUID.
+					if (tag != 1 && tag != 3)
+					{
+						error = "file_probe: Compressed WAV data.\n";
+						return false;
+					}
+					info.channels = (int)get_le(b + 2, 2);
+					info.rate = (int)get_le(b + 4, 4);
+					info.bits = (int)get_le(b + 14, 2);
+					info.floating_point = (tag == 3);
+					have_fmt = true;
+				}
+				else if (is_id(b, "bext"))
+					read_bext(info, body, size);
+				else if (is_id(b, "data"))
+				{
+					if (rf64 && size == 0xFFFFFFFF && ds64_data >= 0)
+						size = ds64_data;
+					set_data(info, body, size);
+					if (info.data_offset + info.data_bytes >= file_size)
+						break;
+				}
+
+				pos = body + size + (size & 1);
+			}
+
+			if (!have_fmt || info.data_offset == 0)
+			{
+				error = "file_probe: No fmt or data chunk.\n";
+				return false;
+			}
+			return set_subformat(info);
+		}
+		// ********************************
+
+		// ********************************
+		// **** W64.  Chunks are a GUID that starts with the four character code and a
+		// **** 64-bit size that counts the 24 byte chunk header.  Chunks are 8 byte aligned.
+		bool scan_w64(probe_info &info)
+		{
+			uint8_t b[40];
+			bool have_fmt = false;
+			int64_t pos = 40;
+
+			info.container = SF_FORMAT_W64;
+			while (pos + 24 <= file_size && read_at(pos, b, 24))
+			{
+				int64_t size = (int64_t)get_le(b + 16, 8) - 24;
+				int64_t body = pos + 24;
+				if (size < 0)
+					break;
+
+				if (is_id(b, "fmt ") && size >= 16 && read_at(body, b, (size >= 40) ? 40 : 16))
+				{
+					int tag = (int)get_le(b, 2);
+					if (tag == 0xFFFE && size >= 40)
+						tag = (int)get_le(b + 24, 2);
+					if (tag != 1 && tag != 3)
+					{
+						error = "file_probe: Compressed W64 data.\n";
+						return false;
+					}
+					info.channels = (int)get_le(b + 2, 2);
+					info.rate = (int)get_le(b + 4, 4);
+					info.bits = (int)get_le(b + 14, 2);
+					info.floating_point = (tag == 3);
+					have_fmt = true;
+				}
+				else if (is_id(b, "bext"))
+					read_bext(info, body, size);
+				else if (is_id(b, "data"))
+				{
+					set_data(info, body, size);
+					if (info.data_offset + info.data_bytes >= file_size)
+						break;
+				}
+
+				pos = (body + size + 7) & ~(int64_t)7;
+			}
+
+			if (!have_fmt || info.data_offset == 0)
+			{
+				error = "file_probe: No fmt or data chunk.\n";
+				return false;
+			}
+			return set_subformat(info);
+		}
+		// ********************************
+
+		// ********************************
+		// **** AIFF and AIFC.  Big-endian 32-bit chunk sizes.
+		bool scan_aiff(probe_info &info, bool aifc)
+		{
+			uint8_t b[26];
+			bool have_comm = false;
+			int64_t pos = 12;
+
+			info.container = SF_FORMAT_AIFF;
+			info.big_endian = true;
+			while (pos + 8 <= file_size && read_at(pos, b, 8))
+			{
+				int64_t size = (int64_t)get_be(b + 4, 4);
+				int64_t body = pos + 8;
+
+				if (is_id(b, "COMM") && size >= 18 && read_at(body, b, (aifc && size >= 22) ? 22 : 18))
+				{
+					info.channels = (int)get_be(b, 2);
+					info.bits = (int)get_be(b + 6, 2);
+					info.rate = get_extended(b + 8);
+					if (aifc && size >= 22)
+					{
+						if (is_id(b + 18, "sowt"))
+							info.big_endian = false;
+						else if (is_id(b + 18, "fl32") || is_id(b + 18, "FL32"))
+						{
+							info.floating_point = true;
+							info.bits = 32;
+						}
+						else if (is_id(b + 18, "fl64") || is_id(b + 18, "FL64"))
+						{
+							info.floating_point = true;
+							info.bits = 64;
+						}
+						else if (!is_id(b + 18, "NONE") && !is_id(b + 18, "twos"))
+						{
+							error = "file_probe: Compressed AIFC data.\n";
+							return false;
+						}
+					}
+					have_comm = true;
+				}
+				else if (is_id(b, "SSND") && size >= 8 && read_at(body, b, 8))
+				{
+					int64_t offset = (int64_t)get_be(b, 4);
+					set_data(info, body + 8 + offset, size - 8 - offset);
+					if (info.data_offset + info.data_bytes >= file_size)
+						break;
+				}
+
+				pos = body + size + (size & 1);
+			}
+
+			if (!have_comm || info.data_offset == 0)
+			{
+				error = "file_probe: No COMM or SSND chunk.\n";
+				return false;
+			}
+			return set_subformat(info);
+		}
+		// ********************************
+
+		// ********************************
+		// **** CAF.  Big-endian 64-bit chunk sizes.  A data chunk size of -1 runs to the
+		// **** end of the file.
+		bool scan_caf(probe_info &info)
+		{
+			uint8_t b[32];
+			bool have_desc = false;
+			int64_t pos = 8;
+
+			info.container = SF_FORMAT_CAF;
+			while (pos + 12 <= file_size && read_at(pos, b, 12))
+			{
+				int64_t size = (int64_t)get_be(b + 4, 8);
+				int64_t body = pos + 12;
+
+				if (is_id(b, "desc") && size >= 32 && read_at(body, b, 32))
+				{
+					if (!is_id(b + 8, "lpcm"))
+					{
+						error = "file_probe: Compressed CAF data.\n";
+						return false;
+					}
+					uint32_t flags = (uint32_t)get_be(b + 12, 4);
+					info.rate = get_double_be(b);
+					info.floating_point = (flags & 1) != 0;
+					info.big_endian = (flags & 2) == 0;
+					info.channels = (int)get_be(b + 24, 4);
+					info.bits = (int)get_be(b + 28, 4);
+					have_desc = true;
+				}
+				else if (is_id(b, "data"))
+				{
+					// The data starts after a 4 byte edit count.
+					set_data(info, body + 4, (size < 0) ? -1 : size - 4);
+					break;
+				}
+
+				if (size < 0)
+					break;
+				pos = body + size;
+			}
+
+			if (!have_desc || info.data_offset == 0)
+			{
+				error = "file_probe: No desc or data chunk.\n";
+				return false;
+			}
+			return set_subformat(info);
+		}
+		// ********************************
+
+	public:
+		// ********************************
+		file_probe() : fd(-1), file_size(0) {}
+		~file_probe() {}
+		// ********************************
+
+		// ********************************
+		// **** Read the header of 'path'.  Returns false if the file can't be opened or
+		// **** isn't an uncompressed WAV/RF64/W64/AIFF/CAF file.
+		bool scan(const std::string &path, probe_info &info)
+		{
+			info.clear();
+			error.clear();
+
+		#if defined(_WIN32) || defined(_WIN64)
+			fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+		#else
+			fd = ::open(path.c_str(), O_RDONLY);
+		#endif
+			if (fd < 0)
+			{
+				error = "file_probe: Could not open the file: " + path + "\n";
+				return false;
+			}
+
+		#if defined(_WIN32) || defined(_WIN64)
+			file_size = _lseeki64(fd, 0, SEEK_END);
+		#else
+			file_size = lseek(fd, 0, SEEK_END);
+		#endif
+
+			uint8_t b[40];
+			bool ret = false;
+			if (!read_at(0, b, 12))
+				error = "file_probe: File is too short.\n";
+			else if (is_id(b, "RIFF") && is_id(b + 8, "WAVE"))
+				ret = scan_riff(info, false);
+			else if ((is_id(b, "RF64") || is_id(b, "BW64")) && is_id(b + 8, "WAVE"))
+				ret = scan_riff(info, true);
+			else if (is_id(b, "riff") && read_at(0, b, 40) && is_id(b + 24, "wave"))
+				ret = scan_w64(info);
+			else if (is_id(b, "FORM") && (is_id(b + 8, "AIFF") || is_id(b + 8, "AIFC")))
+				ret = scan_aiff(info, is_id(b + 8, "AIFC"));
+			else if (is_id(b, "caff"))
+				ret = scan_caf(info);
+			else
+				error = "file_probe: Unknown file type.\n";
+
+			if (ret)
+				info.frames = info.data_bytes / ((info.bits / 8) * info.channels);
+
+		#if defined(_WIN32) || defined(_WIN64)
+			_close(fd);
+		#else
+			::close(fd);
+		#endif
+			fd = -1;
+			return ret;
+		}
+		// ********************************
+
+		const char *get_error_str() const { return error.c_str(); }
+	};
+	// **** End file_probe
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::probe_cache - Probe results keyed by path, size and modification time.
+	class probe_cache
+	{
+	private:
+		class entry
+		{
+		public:
+			int64_t		size;
+			int64_t		mtime;
+			probe_info	info;
+		};
+
+		// ********************************
+		// **** cache_ref class.  The cache file is written when the last copy goes away.
+		class cache_ref
+		{
+		public:
+			std::string path;		// Cache file.  Empty keeps the cache in memory only.
+			std::unordered_map<std::string, entry> entries;
+			bool		dirty;
+			int64_t		hits;
+			int64_t		misses;
+
+			cache_ref() : dirty(false), hits(0), misses(0) {}
+			~cache_ref() { save(); }
+
+			// The cache file is only good for the build that wrote it.
+			static uint32_t get_magic() { return 0x44535100 | (uint32_t)(sizeof(entry) & 0xFF); }
+
+			bool save()
+			{
+				if (!dirty || path.empty())
+					return true;
+
+				std::FILE *f = std::fopen(path.c_str(), "wb");
+				if (f == nullptr)
+					return false;
+
+				uint32_t head[2] = { get_magic(), (uint32_t)sizeof(entry) };
+				bool ok = std::fwrite(head, sizeof(head), 1, f) == 1;
+				for (auto &e : entries)
+				{
+					uint32_t length = (uint32_t)e.first.size();
+					ok = ok &&
+						std::fwrite(&length, sizeof(length), 1, f) == 1 &&
+						std::fwrite(e.first.data(), 1, length, f) == length &&
+						std::fwrite(&e.second, sizeof(entry), 1, f) == 1;
+				}
+				ok = (std::fclose(f) == 0) && ok;
+				dirty = !ok;
+				return ok;
+			}
+
+			bool load()
+			{
+				std::FILE *f = std::fopen(path.c_str(), "rb");
+				if (f == nullptr)
+					return false;
+
+				uint32_t head[2];
+				bool ok = std::fread(head, sizeof(head), 1, f) == 1 && head[0] == get_magic() && head[1] == sizeof(entry);
+				uint32_t length;
+				while (ok && std::fread(&length, sizeof(length), 1, f) == 1)
+				{
+					std::string name(length, '\0');
+					entry e;
+					if (length > 0x10000 ||
+						std::fread(&name[0], 1, length, f) != length ||
+						std::fread(&e, sizeof(entry), 1, f) != 1)
+						break;
+					entries[name] = e;
+				}
+				std::fclose(f);
+				return ok;
+			}
+		};
+		// **** End cache_ref class.
+		// ********************************
+
+		std::shared_ptr<cache_ref> p;
+		file_probe scanner;
+
+	public:
+		// ********************************
+		// **** Size and modification time of 'path'.  Returns false if it doesn't exist.
+		static bool get_file_stamp(const std::string &path, int64_t &size, int64_t &mtime)
+		{
+		#if defined(_WIN32) || defined(_WIN64)
+			struct _stat64 st;
+			if (_stat64(path.c_str(), &st) != 0)
+				return false;
+		#else
+			struct stat st;
+			if (::stat(path.c_str(), &st) != 0)
+				return false;
+		#endif
+			size = st.st_size;
+			mtime = st.st_mtime;
+			return true;
+		}
+
+		// ********************************
+		// **** True if 'path' can be read, or can be created if it doesn't exist yet.
+		static bool can_use_file(const std::string &path)
+		{
+			int64_t size, mtime;
+			std::FILE *f = std::fopen(path.c_str(), "rb");
+			if (f != nullptr)
+			{
+				std::fclose(f);
+				return true;
+			}
+			if (get_file_stamp(path, size, mtime))
+				return false;
+
+			f = std::fopen(path.c_str(), "wb");
+			if (f == nullptr)
+				return false;
+			std::fclose(f);
+			std::remove(path.c_str());
+			return true;
+		}
+
+		// ********************************
+		probe_cache() : p(std::make_shared<cache_ref>()) {}
+		~probe_cache() {}
+		// ********************************
+
+		// ********************************
+		// **** Use 'path' to keep the cache between runs.  Entries already in the file are
+		// **** loaded.  A missing or stale file starts an empty cache.  Returns false and
+		// **** keeps the cache in memory only if 'path' can't be read or created.
+		bool open(const std::string &path)
+		{
+			p = std::make_shared<cache_ref>();
+			if (!can_use_file(path))
+				return false;
+			p->path = path;
+			p->load();
+			return true;
+		}
+
+		// **** Write the cache file now instead of when the cache goes away.
+		bool save() { return p->save(); }
+		// ********************************
+
+		// ********************************
+		// **** Get the header information of 'path', reading the file only if it is not
+		// **** in the cache or has changed since it was cached.
+		bool probe(const std::string &path, probe_info &info)
+		{
+			int64_t size, mtime;
+			if (!get_file_stamp(path, size, mtime))
+				return false;
+
+			auto it = p->entries.find(path);
+			if (it != p->entries.end() && it->second.size == size && it->second.mtime == mtime)
+			{
+				++p->hits;
+				info = it->second.info;
+				return true;
+			}
+
+			++p->misses;
+			if (!scanner.scan(path, info))
+				return false;
+
+			entry &e = p->entries[path];
+			e.size = size;
+			e.mtime = mtime;
+			e.info = info;
+			p->dirty = true;
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		int64_t get_hits() const { return p->hits; }
+		int64_t get_misses() const { return p->misses; }
+		const char *get_error_str() const { return scanner.get_error_str(); }
+		// ********************************
+	};
+	// **** End probe_cache
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
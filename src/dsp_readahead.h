@@ -0,0 +1,287 @@
+﻿/* Asynchronous read-ahead for audio inputs.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   A background thread keeps a ring of blocks filled ahead of the consumer so
+ * decoding and disk reads overlap with whatever the caller does with the
+ * samples.  The source is any function that reads frames into a buffer, so
+ * this works the same on a dspfile (libsndfile) or a mapped_pcm_reader.  The
+ * ring is a dsp::block_queue so neither side takes a lock unless it has to
+ * wait for the other.
+ *
+ *   read_frames() copies frames out of the ring in any amount.  A consumer
+ * whose blocks are as long as the ring's can borrow each block instead with
+ * begin_read() and end_read() and work on it in place.
+ *
+ *   Two stall counters tell you which side is the bottleneck.  A consumer
+ * stall means the reader was waiting on the disk/decoder.  A producer stall
+ * means the ring was full and the disk was waiting on the reader.  The wait
+ * times say how much each of them cost.
+ */
+
+#pragma once
+
+#include "configure.h"
+#include "dsp_block_queue.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** Counters for a single read-ahead run.
+	class readahead_stats
+	{
+	public:
+		uint64_t blocks;			// Blocks read by the background thread.
+		uint64_t frames;			// Frames read by the background thread.
+		uint64_t consumer_stalls;	// Times the reader had to wait for a block.
+		uint64_t producer_stalls;	// Times the background thread found the ring full.
+		uint64_t consumer_wait_ns;	// Nanoseconds the reader waited for blocks.
+		uint64_t producer_wait_ns;	// Nanoseconds the background thread waited for room.
+		uint64_t read_ns;			// Nanoseconds the background thread spent reading.
+		double average_fill;		// Average number of blocks in the ring.
+		readahead_stats() :
+			blocks(0), frames(0), consumer_stalls(0), producer_stalls(0),
+			consumer_wait_ns(0), producer_wait_ns(0), read_ns(0), average_fill(0.0) {}
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::readahead - Reads blocks of frames ahead of the consumer on a background thread.
+	class readahead
+	{
+	public:
+		// Reads up to 'frames' frames into 'buffer' and returns the number read.
+		typedef std::function<int64_t(void *buffer, int64_t frames)> source_t;
+
+	private:
+		// ********************************
+		// **** readahead_ref class.  Holds the ring and the thread.
+		class readahead_ref
+		{
+		public:
+			source_t				source;
+			block_queue				queue;
+			int64_t					pos;			// Frames consumed from the head block.
+			int64_t					frame_size;		// Bytes per frame.
+			int64_t					block_frames;	// Frames per block.
+			bool					stopping;		// Only touched by the owner of the readahead.
+			bool					done;			// The last block has been consumed.
+			block_queue::block		*held;			// Block lent out by begin_read().
+
+			std::thread				worker;
+			std::atomic<uint64_t>	blocks, frames, read_ns;
+
+			readahead_ref() :
+				pos(0), frame_size(0), block_frames(0), stopping(false), done(false), held(nullptr), blocks(0), frames(0), read_ns(0) {}
+			~readahead_ref() { stop(); }
+
+			// ********************************
+			// **** Background thread.  Fills the ring until the source runs dry.
+			void run()
+			{
+				block_queue::block *b;
+				while ((b = queue.begin_push()) != nullptr)
+				{
+					auto start = std::chrono::steady_clock::now();
+					b->frames = source(b->data.data(), block_frames);
+					read_ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count();
+					if (b->frames < 0)
+						b->frames = 0;
+
+					bool last = (b->frames < block_frames);
+					++blocks;
+					frames += b->frames;
+					queue.end_push();
+
+					// A short block marks the end of the input.  The consumer still gets
+					// every block in the ring.
+					if (last)
+					{
+						queue.close();
+						return;
+					}
+				}
+			}
+			// ********************************
+
+			// ********************************
+			void stop()
+			{
+				stopping = true;
+				queue.close();
+				if (worker.joinable())
+					worker.join();
+			}
+			// ********************************
+		};
+		// **** End readahead_ref class.
+		// ********************************
+
+		std::shared_ptr<readahead_ref> p;
+
+	public:
+		// ********************************
+		readahead() : p(nullptr) {}
+		~readahead() {}
+		// ********************************
+
+		// ********************************
+		// **** Start reading ahead.  'frame_size' is the size of a frame in bytes as
+		// **** written by 'source', 'block_frames' the frames per block and 'depth' the
+		// **** number of blocks in the ring.
+		bool start(source_t source, int64_t frame_size, int64_t block_frames, int depth)
+		{
+			stop();
+			if (!source || frame_size <= 0 || block_frames <= 0 || depth <= 0)
+				return false;
+
+			p = std::make_shared<readahead_ref>();
+			p->source = source;
+			p->frame_size = frame_size;
+			p->block_frames = block_frames;
+			p->queue.init(depth, (size_t)(frame_size * block_frames));
+
+			p->worker = std::thread(&readahead_ref::run, p.get());
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Stop the background thread.  The stats stay until the next start().
+		void stop()
+		{
+			if (p != nullptr)
+				p->stop();
+		}
+		// ********************************
+
+		// ********************************
+		bool is_running() const { return (p != nullptr) && !p->stopping; }
+		int64_t get_block_frames() const { return (p != nullptr) ? p->block_frames : 0; }
+
+		// Bytes held by the blocks of the queue.
+		int64_t get_buffer_bytes() const { return (p != nullptr) ? (int64_t)p->queue.capacity() * p->frame_size * p->block_frames : 0; }
+
+		readahead_stats get_stats() const
+		{
+			readahead_stats stats;
+			if (p == nullptr)
+				return stats;
+			block_queue_stats q = p->queue.get_stats();
+			stats.blocks = p->blocks;
+			stats.frames = p->frames;
+			stats.consumer_stalls = q.consumer_waits;
+			stats.producer_stalls = q.producer_waits;
+			stats.consumer_wait_ns = q.consumer_wait_ns;
+			stats.producer_wait_ns = q.producer_wait_ns;
+			stats.read_ns = p->read_ns;
+			stats.average_fill = q.get_average_fill();
+			return stats;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Read frames from the ring.  Works like dspfile::read_frames().  Returns
+		// **** fewer frames than asked for only at the end of the input.
+		int64_t read_frames(void *ptr, int64_t frames)
+		{
+			if (!is_running())
+				return 0;
+
+			uint8_t *dst = (uint8_t *)ptr;
+			int64_t total = 0;
+			while (total < frames && !p->done)
+			{
+				// Wait for a block.
+				block_queue::block *b = p->queue.begin_pop();
+				if (b == nullptr)
+					break;
+
+				// Copy what we can from the head block.
+				int64_t n = std::min(b->frames - p->pos, frames - total);
+				std::memcpy(dst + total * p->frame_size, b->data.data() + p->pos * p->frame_size, (size_t)(n * p->frame_size));
+				p->pos += n;
+				total += n;
+
+				// Hand the block back to the background thread once it is used up.
+				if (p->pos == b->frames)
+				{
+					if (b->frames < p->block_frames)
+						p->done = true;
+					p->pos = 0;
+					p->queue.end_pop();
+				}
+			}
+			return total;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Borrow the rest of the head block instead of copying it.  'frames' gets the
+		// **** number of frames in it.  Returns nullptr at the end of the input.  The
+		// **** block has to go back with end_read() before anything else is read.
+		const void *begin_read(int64_t &frames)
+		{
+			frames = 0;
+			if (!is_running() || p->done || p->held != nullptr)
+				return nullptr;
+
+			block_queue::block *b = p->queue.begin_pop();
+			if (b == nullptr)
+				return nullptr;
+			p->held = b;
+			frames = b->frames - p->pos;
+			return b->data.data() + p->pos * p->frame_size;
+		}
+
+		// **** Hand the block from begin_read() back to the background thread.
+		void end_read()
+		{
+			if (p == nullptr || p->held == nullptr)
+				return;
+			if (p->held->frames < p->block_frames)
+				p->done = true;
+			p->held = nullptr;
+			p->pos = 0;
+			p->queue.end_pop();
+		}
+		// ********************************
+	};
+	// **** End readahead
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
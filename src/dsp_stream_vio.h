@@ -0,0 +1,361 @@
+﻿/* Virtual I/O for pipes and other streams.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   libsndfile can read and write through SF_VIRTUAL_IO but it expects to be
+ * able to seek.  This class puts a fixed size ring buffer between libsndfile
+ * and a file descriptor that can't seek (a pipe, stdin, stdout, a socket...).
+ *
+ *   Reading keeps the last 'window' bytes of the stream in the ring so the
+ * header parser can seek back over what it has already looked at.  Seeking
+ * forward just reads and throws away.
+ *
+ *   Writing holds the last 'window' bytes before they go out so short seeks
+ * back still work.  A seek back past what has already been sent (libsndfile
+ * does that at close to rewrite the header) is allowed but everything written
+ * there is dropped until the next seek to the end.  That is fine for formats
+ * that don't need the header rewritten, like RAW, AU and CAF.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#if defined(_WIN32) || defined(_WIN64)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "sndfile.h"
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** dsp::stream_vio - SF_VIRTUAL_IO over a non-seekable stream.
+	class stream_vio
+	{
+	private:
+		// ********************************
+		// **** stream_ref class.  Everything libsndfile gets through 'user_data'.
+		class stream_ref
+		{
+		public:
+			int						fd;
+			bool					writing;
+			bool					eof;		// No more bytes to read.
+			bool					failed;		// A read or write on the stream failed.
+			bool					discard;	// Writing to a part of the stream that is already gone.
+			std::vector<uint8_t>	ring;
+			int64_t					base;		// Stream offset of the oldest byte in the ring.
+			int64_t					end;		// Stream offset one past the newest byte.
+			int64_t					position;	// Current stream offset.
+			int64_t					length;		// Length reported to libsndfile when reading.
+
+			stream_ref() : fd(-1), writing(false), eof(false), failed(false), discard(false), base(0), end(0), position(0), length(0) {}
+
+			int64_t capacity() const { return (int64_t)ring.size(); }
+
+			// ********************************
+			// **** Raw stream access.
+			int64_t sys_read(void *ptr, int64_t size)
+			{
+			#if defined(_WIN32) || defined(_WIN64)
+				int ret = _read(fd, ptr, (unsigned int)std::min<int64_t>(size, 0x40000000));
+			#else
+				ssize_t ret;
+				do
+					ret = ::read(fd, ptr, (size_t)size);
+				while (ret < 0 && errno == EINTR);
+			#endif
+				return ret;
+			}
+
+			bool sys_write(const uint8_t *ptr, int64_t size)
+			{
+				while (size > 0)
+				{
+				#if defined(_WIN32) || defined(_WIN64)
+					int ret = _write(fd, ptr, (unsigned int)std::min<int64_t>(size, 0x40000000));
+				#else
+					ssize_t ret = ::write(fd, ptr, (size_t)size);
+					if (ret < 0 && errno == EINTR)
+						continue;
+				#endif
+					if (ret <= 0)
+					{
+						failed = true;
+						return false;
+					}
+					ptr += ret;
+					size -= ret;
+				}
+				return true;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Read more of the stream into the ring.  Drops the oldest bytes when the
+			// **** ring is full.  Returns false at the end of the stream.
+			bool fill()
+			{
+				if (eof || failed)
+					return false;
+
+				int64_t at = end % capacity();
+				int64_t size = capacity() - at;
+				int64_t ret = sys_read(ring.data() + at, size);
+				if (ret <= 0)
+				{
+					if (ret < 0)
+						failed = true;
+					eof = true;
+					return false;
+				}
+
+				end += ret;
+				if (end - base > capacity())
+					base = end - capacity();
+				return true;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Send the oldest 'size' bytes in the ring to the stream.
+			bool drain(int64_t size)
+			{
+				while (size > 0)
+				{
+					int64_t at = base % capacity();
+					int64_t n = std::min(size, capacity() - at);
+					if (!sys_write(ring.data() + at, n))
+						return false;
+					base += n;
+					size -= n;
+				}
+				return true;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Reading.
+			int64_t read(void *ptr, int64_t count)
+			{
+				uint8_t *dst = (uint8_t *)ptr;
+				int64_t total = 0;
+				if (position < base)
+					return 0;	// Fell out of the back of the window.
+
+				while (total < count)
+				{
+					if (position >= end && !fill())
+						break;
+
+					int64_t at = position % capacity();
+					int64_t n = std::min(std::min(count - total, end - position), capacity() - at);
+					std::memcpy(dst + total, ring.data() + at, (size_t)n);
+					position += n;
+					total += n;
+				}
+				return total;
+			}
+
+			int64_t seek_read(int64_t target)
+			{
+				if (target < base)
+					return -1;
+				while (end < target)
+				{
+					if (!fill())
+						return -1;
+				}
+				return position = target;
+			}
+			// ********************************
+
+			// ********************************
+			// **** Writing.
+			int64_t write(const void *ptr, int64_t count)
+			{
+				const uint8_t *src = (const uint8_t *)ptr;
+				int64_t total = 0;
+				if (failed)
+					return 0;
+
+				// This part of the stream is gone already.  Pretend we wrote it.
+				if (discard)
+				{
+					position += count;
+					return count;
+				}
+
+				while (total < count)
+				{
+					// Send the older half of the ring on its way when it is full.
+					if (position - base >= capacity() && !drain(std::max<int64_t>(capacity() / 2, position - base - capacity() + 1)))
+						return total;
+
+					int64_t at = position % capacity();
+					int64_t n = std::min(std::min(count - total, capacity() - (position - base)), capacity() - at);
+					std::memcpy(ring.data() + at, src + total, (size_t)n);
+					position += n;
+					total += n;
+					if (position > end)
+						end = position;
+				}
+				return total;
+			}
+
+			int64_t seek_write(int64_t target)
+			{
+				if (target > end)
+					return -1;
+
+				// Anything before 'base' has been sent.  Drop what gets written there.
+				discard = (target < base);
+				return position = target;
+			}
+			// ********************************
+
+			// ********************************
+			// **** libsndfile callbacks.
+			static sf_count_t vio_get_filelen(void *user_data)
+			{
+				stream_ref *r = (stream_ref *)user_data;
+				return r->writing ? r->end : r->length;
+			}
+
+			static sf_count_t vio_seek(sf_count_t offset, int whence, void *user_data)
+			{
+				stream_ref *r = (stream_ref *)user_data;
+				int64_t target = offset;
+				switch (whence)
+				{
+				case SEEK_CUR: target += r->position; break;
+				case SEEK_END: target += r->writing ? r->end : r->length; break;
+				}
+				return r->writing ? r->seek_write(target) : r->seek_read(target);
+			}
+
+			static sf_count_t vio_read(void *ptr, sf_count_t count, void *user_data)
+			{
+				stream_ref *r = (stream_ref *)user_data;
+				return r->writing ? 0 : r->read(ptr, count);
+			}
+
+			static sf_count_t vio_write(const void *ptr, sf_count_t count, void *user_data)
+			{
+				stream_ref *r = (stream_ref *)user_data;
+				return r->writing ? r->write(ptr, count) : 0;
+			}
+
+			static sf_count_t vio_tell(void *user_data)
+			{
+				return ((stream_ref *)user_data)->position;
+			}
+			// ********************************
+		};
+		// **** End stream_ref class.
+		// ********************************
+
+		std::shared_ptr<stream_ref> p;
+		SF_VIRTUAL_IO vio;
+
+		bool open(int fd, bool writing, int64_t window)
+		{
+			p = nullptr;
+			if (fd < 0 || window <= 0)
+				return false;
+
+			p = std::make_shared<stream_ref>();
+			p->fd = fd;
+			p->writing = writing;
+			p->ring.resize((size_t)window);
+			return true;
+		}
+
+	public:
+		// ********************************
+		stream_vio() : p(nullptr)
+		{
+			vio.get_filelen = stream_ref::vio_get_filelen;
+			vio.seek = stream_ref::vio_seek;
+			vio.read = stream_ref::vio_read;
+			vio.write = stream_ref::vio_write;
+			vio.tell = stream_ref::vio_tell;
+		}
+		~stream_vio() {}
+		// ********************************
+
+		// ********************************
+		// **** Read from 'fd' keeping 'window' bytes for seeking back.  libsndfile is told
+		// **** the stream is 'length' bytes long.  When that isn't known the default is
+		// **** big enough that the data chunk size in the header is believed.
+		bool open_read(int fd, int64_t window = 1024 * 1024, int64_t length = 0x7fffffffffffll)
+		{
+			if (!open(fd, false, window))
+				return false;
+			p->length = length;
+			return true;
+		}
+
+		// **** Write to 'fd' holding back the last 'window' bytes for seeking back.
+		bool open_write(int fd, int64_t window = 1024 * 1024)
+		{
+			return open(fd, true, window);
+		}
+		// ********************************
+
+		// ********************************
+		// **** Send everything that is still held back to the stream.  Call after the
+		// **** SNDFILE writing to this stream has been closed.
+		bool finish()
+		{
+			if (p == nullptr)
+				return true;
+			if (p->writing && !p->failed)
+				p->drain(p->end - p->base);
+			return !p->failed;
+		}
+		// ********************************
+
+		// ********************************
+		bool is_open() const { return p != nullptr; }
+		bool has_failed() const { return (p != nullptr) && p->failed; }
+		SF_VIRTUAL_IO &get_vio() { return vio; }
+		void *get_user_data() { return p.get(); }
+		// ********************************
+	};
+	// **** End stream_vio
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
@@ -0,0 +1,518 @@
+﻿/* Pool of worker threads shared by everything that works in parallel.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   Every worker has a queue of its own.  A task started from a worker goes on
+ * the back of that worker's queue and the worker takes its own tasks from the
+ * back, so the data it just touched is likely still in its cache.  A worker
+ * with nothing left steals from the front of another worker's queue.  Tasks
+ * started from outside the pool go on a queue of their own that every worker
+ * takes from.
+ *
+ *   Tasks are started through a task_group.  wait() runs tasks of its own group
+ * while it waits instead of sleeping, so a task may start and wait for tasks of
+ * its own without tying up a worker and without the pool running out of
+ * workers.  It never runs tasks of other groups, which could take much longer
+ * than the tasks it waits for.
+ *
+ *   The pool has one worker per core until set_workers() is called.  The queues
+ * are made once for the most workers a pool can have and are never freed, so a
+ * thread looking for a task never touches a queue that went away.  Since
+ * segments, converted files, background jobs and large transposes all run on
+ * the same workers, the program never runs more threads than that at once,
+ * however they are nested.  The I/O threads of readahead and writebehind are
+ * not part of the pool since they spend their time waiting on the disk.
+ */
+
+#pragma once
+
+#include "configure.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#if defined(_WIN32) || defined(_WIN64)
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <Windows.h>
+#elif !defined(__APPLE__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	class task_group;
+
+
+	// ********************************
+	// **** dsp::thread_pool - Worker threads that run the tasks of task groups.
+	class thread_pool
+	{
+		friend class task_group;
+
+	private:
+		class task
+		{
+		public:
+			std::function<void()>	fn;
+			task_group				*group;
+			task() : group(nullptr) {}
+		};
+
+		class queue
+		{
+		public:
+			std::mutex			lock;
+			std::deque<task>	tasks;
+		};
+
+		// Which pool and worker the current thread belongs to.
+		class worker_id
+		{
+		public:
+			thread_pool *pool;
+			int			index;
+			worker_id() : pool(nullptr), index(-1) {}
+		};
+
+		static worker_id &current()
+		{
+			static thread_local worker_id id;
+			return id;
+		}
+
+		std::mutex					lock;		// Starting and stopping the workers.
+		std::condition_variable		wake;		// A task was queued or the workers are stopping.
+		std::vector<std::unique_ptr<queue>> queues;	// One per possible worker plus the shared queue last.
+		std::vector<std::thread>	threads;
+		std::atomic<int>			started;	// Workers started, so the worker queues in use.
+		std::atomic<int64_t>		queued;		// Tasks in all queues.
+		std::atomic<int64_t>		groups;		// Task groups with tasks queued or running.
+		std::atomic<uint64_t>		steals;		// Tasks taken from another worker's queue.
+		std::atomic<bool>			stopping;
+		std::atomic<bool>			running;	// The workers were started.
+		std::atomic<int>			workers;	// 0 is one per core.
+		std::atomic<bool>			pinning;
+
+		// ********************************
+		// **** Pin worker 'index' to a core of its own.  Does nothing where that isn't
+		// **** supported.
+		static void pin(int index)
+		{
+			int cores = std::max(1, (int)std::thread::hardware_concurrency());
+#if defined(_WIN32) || defined(_WIN64)
+			SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (index % std::min(cores, (int)sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(index % std::min(cores, (int)CPU_SETSIZE), &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+			(void)index;
+			(void)cores;
+#endif
+		}
+
+		// ********************************
+		// **** Start the workers if they are not running.  Call with 'lock' held.
+		void start()
+		{
+			if (!threads.empty())
+				return;
+
+			int count = get_workers();
+			bool pinned = pinning;
+			started = count;
+			stopping = false;
+			for (int i = 0; i < count; ++i)
+				threads.emplace_back(&thread_pool::worker, this, i, pinned);
+			running = true;
+		}
+
+		// ********************************
+		// **** Stop the workers once they finished the task they are running.  Tasks
+		// **** still queued are moved to the shared queue for when the workers start
+		// **** again.  Call with 'lock' held and never from a worker.
+		void stop()
+		{
+			{
+				std::unique_lock<std::mutex> l(queues.back()->lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (auto &t : threads)
+				t.join();
+			threads.clear();
+			running = false;
+
+			queue &shared = *queues.back();
+			std::unique_lock<std::mutex> l(shared.lock);
+			for (int i = 0; i < started; ++i)
+			{
+				std::unique_lock<std::mutex> ql(queues[i]->lock);
+				for (auto &t : queues[i]->tasks)
+					shared.tasks.push_back(std::move(t));
+				queues[i]->tasks.clear();
+			}
+		}
+
+		// ********************************
+		// **** Take a task from queue 'q'.  From the back when it's the queue of the worker
+		// **** itself, else from the front.  With 'group' set only a task of that group is
+		// **** taken.
+		bool take(queue &q, bool back, task_group *group, task &t)
+		{
+			std::unique_lock<std::mutex> l(q.lock);
+			if (q.tasks.empty())
+				return false;
+
+			if (group == nullptr)
+			{
+				if (back)
+				{
+					t = std::move(q.tasks.back());
+					q.tasks.pop_back();
+				}
+				else
+				{
+					t = std::move(q.tasks.front());
+					q.tasks.pop_front();
+				}
+			}
+			else
+			{
+				auto it = std::find_if(q.tasks.begin(), q.tasks.end(), [group](const task &x) { return x.group == group; });
+				if (it == q.tasks.end())
+					return false;
+				t = std::move(*it);
+				q.tasks.erase(it);
+			}
+			--queued;
+			return true;
+		}
+
+		// ********************************
+		// **** Find a task for worker 'index', or for a thread outside the pool when
+		// **** 'index' is -1.  Own queue first, then the shared queue, then the others.
+		bool find(int index, task_group *group, task &t)
+		{
+			if (queued <= 0)
+				return false;
+
+			int count = started;
+			if (index >= 0 && take(*queues[index], true, group, t))
+				return true;
+			if (take(*queues.back(), false, group, t))
+				return true;
+			for (int i = 1; i <= count; ++i)
+			{
+				int victim = (std::max(index, 0) + i) % count;
+				if (victim != index && take(*queues[victim], false, group, t))
+				{
+					++steals;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// ********************************
+		// **** Queue a task.  On the worker's own queue when called from a worker.
+		void push(task &&t)
+		{
+			if (!running)
+			{
+				std::unique_lock<std::mutex> l(lock);
+				start();
+			}
+
+			worker_id &id = current();
+			queue &q = (id.pool == this) ? *queues[id.index] : *queues.back();
+			{
+				std::unique_lock<std::mutex> ql(q.lock);
+				q.tasks.push_back(std::move(t));
+				++queued;
+			}
+			// A worker that just found nothing is either waiting already or sees 'queued'.
+			{ std::unique_lock<std::mutex> sl(queues.back()->lock); }
+			wake.notify_one();
+		}
+
+		inline void run(task &t);
+
+		// ********************************
+		// **** Worker thread.  Runs tasks until the workers are stopped.
+		void worker(int index, bool pinned)
+		{
+			worker_id &id = current();
+			id.pool = this;
+			id.index = index;
+			if (pinned)
+				pin(index);
+
+			task t;
+			for (;;)
+			{
+				if (stopping)
+					return;
+				if (find(index, nullptr, t))
+				{
+					run(t);
+					continue;
+				}
+
+				// The shared queue's lock orders the wake up against push() and stop().
+				std::unique_lock<std::mutex> l(queues.back()->lock);
+				wake.wait_for(l, std::chrono::milliseconds(50), [this] { return stopping || queued > 0; });
+			}
+		}
+
+	public:
+		// ********************************
+		// The most workers a pool can have.
+		static const int max_workers = 256;
+
+		thread_pool() : started(0), queued(0), groups(0), steals(0), stopping(false), running(false), workers(0), pinning(false)
+		{
+			for (int i = 0; i <= max_workers; ++i)
+				queues.emplace_back(new queue);
+		}
+		~thread_pool()
+		{
+			std::unique_lock<std::mutex> l(lock);
+			if (!threads.empty())
+				stop();
+		}
+		// ********************************
+
+		// ********************************
+		// **** Number of workers.  0 is one per core.  The workers are restarted, so this
+		// **** returns false and changes nothing while a task group has work or when
+		// **** called from a worker.
+		bool set_workers(int count)
+		{
+			return set_workers(count, pinning);
+		}
+
+		// **** Number of workers and pinning at once.
+		bool set_workers(int count, bool pin)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			if (is_worker() || is_busy())
+				return false;
+
+			bool was_running = !threads.empty();
+			if (was_running)
+				stop();
+			workers = std::max(0, count);
+			pinning = pin;
+			if (was_running)
+				start();
+			return true;
+		}
+
+		int get_workers() const
+		{
+			int count = workers;
+			if (count <= 0)
+				count = (int)std::thread::hardware_concurrency();
+			return std::min(std::max(1, count), (int)max_workers);
+		}
+
+		// ********************************
+		// **** Keep every worker on one core.  Workers are restarted like set_workers().
+		bool set_pinning(bool enable)
+		{
+			return set_workers(workers, enable);
+		}
+
+		bool get_pinning() const { return pinning; }
+
+		// Tasks queued and not started yet, and tasks that were stolen so far.
+		int64_t get_queued() const { return queued; }
+		uint64_t get_steals() const { return steals; }
+
+		// True when the current thread is a worker of this pool.
+		bool is_worker() { return current().pool == this; }
+		// True while a task group has tasks queued or running.
+		bool is_busy() const { return groups > 0; }
+		// ********************************
+	};
+	// **** End thread_pool
+	// ********************************
+
+
+	// ********************************
+	// **** The pool shared by every process in the program.  It is never destroyed
+	// **** since joining its workers while a DLL unloads would hang.
+	inline thread_pool &get_thread_pool()
+	{
+		static thread_pool *pool = new thread_pool;
+		return *pool;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::task_group - Tasks that are waited for or cancelled together.  The group
+	// **** waits for its tasks when it goes away.
+	class task_group
+	{
+		friend class thread_pool;
+
+	private:
+		thread_pool				&pool;
+		std::mutex				lock;
+		std::condition_variable	done;
+		std::atomic<int64_t>	pending;	// Tasks queued or running.
+		std::atomic<bool>		cancelled;
+		std::atomic<bool>		failed;		// A task threw.
+
+		task_group(const task_group &) = delete;
+		task_group &operator=(const task_group &) = delete;
+
+		// ********************************
+		// **** Called by the pool when a task of the group is finished or skipped.
+		void finish(bool ok)
+		{
+			if (!ok)
+				failed = true;
+			std::unique_lock<std::mutex> l(lock);
+			if (--pending == 0)
+			{
+				--pool.groups;
+				done.notify_all();
+			}
+		}
+
+	public:
+		// ********************************
+		task_group() : pool(get_thread_pool()), pending(0), cancelled(false), failed(false) {}
+		explicit task_group(thread_pool &p) : pool(p), pending(0), cancelled(false), failed(false) {}
+		~task_group() { wait(); }
+		// ********************************
+
+		// ********************************
+		// **** Start 'fn' on the pool.  Once the group was cancelled nothing is started.
+		void run(std::function<void()> fn)
+		{
+			if (cancelled)
+				return;
+			if (pending++ == 0)
+				++pool.groups;
+			thread_pool::task t;
+			t.fn = std::move(fn);
+			t.group = this;
+			pool.push(std::move(t));
+		}
+
+		// ********************************
+		// **** Wait for every task of the group, running the ones that didn't start yet
+		// **** on this thread.  Returns false if the group was cancelled or a task threw.
+		bool wait()
+		{
+			int index = pool.is_worker() ? thread_pool::current().index : -1;
+			thread_pool::task t;
+			while (pending > 0)
+			{
+				if (pool.find(index, this, t))
+				{
+					pool.run(t);
+					continue;
+				}
+				std::unique_lock<std::mutex> l(lock);
+				done.wait_for(l, std::chrono::milliseconds(1), [this] { return pending == 0; });
+			}
+			// The last task may still be in finish().  Let it leave before the group can go away.
+			std::unique_lock<std::mutex> l(lock);
+			return !cancelled && !failed;
+		}
+
+		// ********************************
+		// **** Tasks that did not start yet are skipped.  Running tasks can look at
+		// **** is_cancelled() to stop early.
+		void cancel() { cancelled = true; }
+		bool is_cancelled() const { return cancelled; }
+		// ********************************
+	};
+	// **** End task_group
+	// ********************************
+
+
+	// ********************************
+	// **** Run a task.  Skipped when its group was cancelled.
+	inline void thread_pool::run(task &t)
+	{
+		task_group *group = t.group;
+		bool ok = true;
+		if (!group->cancelled)
+		{
+			try { t.fn(); }
+			catch (...) { ok = false; }
+		}
+		t.fn = nullptr;	// Let go of anything the task holds on to.
+		group->finish(ok);
+	}
+
+
+	// ********************************
+	// **** Call fn(begin, end) over [first, last) in parts of at least 'grain' on the pool.
+	// **** Runs on this thread alone when the range is too small to split.
+	template <typename _Fn>
+	void parallel_for(int64_t first, int64_t last, int64_t grain, _Fn fn, thread_pool &pool = get_thread_pool())
+	{
+		int64_t count = last - first;
+		int64_t parts = std::min<int64_t>(pool.get_workers(), count / std::max<int64_t>(1, grain));
+		if (parts <= 1)
+		{
+			if (count > 0)
+				fn(first, last);
+			return;
+		}
+
+		int64_t step = (count + parts - 1) / parts;
+		task_group group(pool);
+		for (int64_t begin = first + step; begin < last; begin += step)
+		{
+			int64_t end = std::min(begin + step, last);
+			group.run([&fn, begin, end] { fn(begin, end); });
+		}
+		fn(first, std::min(first + step, last));
+		group.wait();
+	}
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
@@ -3,16 +3,20 @@
  * Ron S. Novy
  *
  *  Class for transposing arrays or vecotrs.  Primarily used to interleave or
- * to de-interleave audio samples.
+ * to de-interleave audio samples.  Transposes of pointers and vectors that
+ * are large enough are split by rows over the thread pool.
  */
 
 #pragma once
 
 #include "configure.h"
 #include "dsp_containers.h"
+#include "dsp_thread_pool.h"
 
 #include <array>
 #include <vector>
+#include <cstdint>
+#include <cstring>
 
 
 // ********************************
@@ -28,6 +32,18 @@ namespace dsp
 	{
 	private:
 		int rows, cols;
+
+		// Samples a task of a pooled transpose should move at least.
+		static int64_t get_grain() { return 256 * 1024; }
+
+		// ********************************
+		// **** Transpose rows 'first' to 'last' on the pool when there are enough samples.
+		template <typename _Fn>
+		void for_rows(_Fn fn)
+		{
+			parallel_for(0, rows, std::max<int64_t>(1, get_grain() / std::max(1, cols)),
+				[&fn](int64_t first, int64_t last) { fn((int)first, (int)last); });
+		}
 	public:
 		// ********************************
 		// **** Constructor - 'mode' should be either 'dsp::interleave' or 'dsp::deinterleave'
@@ -52,13 +68,16 @@ namespace dsp
 		template <typename _Type>
 		void operator()(_Type *A, _Type *B)
 		{
-			for (int r = 0; r < rows; ++r)
+			for_rows([&](int first, int last)
 			{
-				for (int c = 0; c < cols; ++c)
+				for (int r = first; r < last; ++r)
 				{
-					B[c * rows + r] = A[r * cols + c];
+					for (int c = 0; c < cols; ++c)
+					{
+						B[c * rows + r] = A[r * cols + c];
+					}
 				}
-			}
+			});
 		}
 
 		template <typename _TypeSrc, size_t _SizeSrc>
@@ -88,19 +107,71 @@ namespace dsp
 		template <typename _TypeSrc, bool _NativeSrc, class _AllocSrc, typename _TypeDst, bool _NativeDst, class _AllocDst>
 		inline void operator()(dspvector<_TypeSrc, _NativeSrc, _AllocSrc> & A, dspvector<_TypeDst, _NativeDst, _AllocDst> & B)
 		{
-			for (int r = 0; r < rows; ++r)
+			for_rows([&](int first, int last)
 			{
-				for (int c = 0; c < cols; ++c)
+				for (int r = first; r < last; ++r)
 				{
-					B[c * rows + r] = A[r * cols + c];
+					for (int c = 0; c < cols; ++c)
+					{
+						B[c * rows + r] = A[r * cols + c];
+					}
 				}
-			}
+			});
 		}
 		// **** End process() functions
 		// ********************************
 	};
 
 
+	// ********************************
+	// **** copy_channel - Copy 'count' samples from 'src' to 'dst' using a separate stride
+	// **** for each side, converting the sample type on the way.  Used to pull a single
+	// **** channel out of an interleaved buffer and place it into another buffer that
+	// **** may be interleaved with a different number of channels.
+	template <typename _TypeSrc, bool _NativeSrc, typename _TypeDst, bool _NativeDst>
+	inline void copy_channel(
+		const sample<_TypeSrc, _NativeSrc> *src, int64_t src_stride,
+		sample<_TypeDst, _NativeDst> *dst, int64_t dst_stride,
+		int64_t count)
+	{
+		for (int64_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride)
+			*dst = *src;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** copy_channel_bytes - Same as copy_channel() for samples that are already encoded.
+	// **** Moves 'bytes' bytes per sample without looking at them, so the result is bit
+	// **** identical to the source.
+	template <int _Bytes>
+	inline void copy_channel_bytes_n(const uint8_t *src, int64_t src_stride, uint8_t *dst, int64_t dst_stride, int64_t count)
+	{
+		for (int64_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride)
+			std::memcpy(dst, src, _Bytes);
+	}
+
+	inline void copy_channel_bytes(
+		const uint8_t *src, int64_t src_stride,
+		uint8_t *dst, int64_t dst_stride,
+		int bytes, int64_t count)
+	{
+		switch (bytes)
+		{
+		case 1: copy_channel_bytes_n<1>(src, src_stride, dst, dst_stride, count); break;
+		case 2: copy_channel_bytes_n<2>(src, src_stride, dst, dst_stride, count); break;
+		case 3: copy_channel_bytes_n<3>(src, src_stride, dst, dst_stride, count); break;
+		case 4: copy_channel_bytes_n<4>(src, src_stride, dst, dst_stride, count); break;
+		case 8: copy_channel_bytes_n<8>(src, src_stride, dst, dst_stride, count); break;
+		default:
+			for (int64_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride)
+				std::memcpy(dst, src, bytes);
+			break;
+		}
+	}
+	// ********************************
+
+
 	// ********************************
 	// **** debug functions
 	template <typename _Type>
@@ -0,0 +1,291 @@
+﻿/* Write-behind queue for audio outputs.
+ * Copyright (C) 2015
+ * Ron S. Novy
+ *
+ *   The process thread puts each block it produces into a bounded queue and
+ * goes straight back to work.  A background thread takes the blocks off the
+ * queue and writes them to the output, so the process only waits on the disk
+ * when the queue is full.  This is the mirror image of dsp::readahead.
+ *
+ *   write_frames() copies frames into the queue in any amount.  A process can
+ * borrow a free block with begin_write() instead, fill it in place and hand it
+ * on with end_write().
+ *
+ *   The queue is a dsp::block_queue so neither side takes a lock unless it has
+ * to wait for the other.  The wait
+ * counters tell which side is the bottleneck.  A process that waits for room
+ * is faster than the disk/encoder, a background thread that waits for blocks
+ * is faster than the process.
+ *
+ *   The first failed write is remembered and every write after it is dropped.
+ * flush() and stop() wait for the queue to drain and report the failure.
+ */
+
+#pragma once
+
+#include "configure.h"
+#include "dsp_block_queue.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+// ********************************
+// **** dsp namespace for dsp classes and functions.
+namespace dsp
+{
+	// ********************************
+	// **** Counters for a single write-behind run.
+	class writebehind_stats
+	{
+	public:
+		uint64_t blocks;			// Blocks written by the background thread.
+		uint64_t frames;			// Frames written by the background thread.
+		uint64_t producer_stalls;	// Times the process had to wait for room in the queue.
+		uint64_t producer_wait_ns;	// Nanoseconds the process waited for room.
+		uint64_t consumer_wait_ns;	// Nanoseconds the background thread waited for blocks.
+		uint64_t write_ns;			// Nanoseconds the background thread spent writing.
+		double average_fill;		// Average number of blocks in the queue.
+		writebehind_stats() :
+			blocks(0), frames(0), producer_stalls(0), producer_wait_ns(0), consumer_wait_ns(0), write_ns(0), average_fill(0.0) {}
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** dsp::writebehind - Writes blocks of frames to an output on a background thread.
+	class writebehind
+	{
+	public:
+		// Writes 'frames' frames from 'buffer' and returns the number written.
+		typedef std::function<int64_t(const void *buffer, int64_t frames)> sink_t;
+
+	private:
+		// ********************************
+		// **** writebehind_ref class.  Holds the queue and the thread.
+		class writebehind_ref
+		{
+		public:
+			sink_t					sink;
+			block_queue				queue;
+			int64_t					frame_size;		// Bytes per frame.
+			int64_t					block_frames;	// Frames per block.
+			bool					stopping;		// Only touched by the owner of the writebehind.
+			std::atomic<bool>		failed;
+			std::string				error;			// Set once before 'failed'.
+			block_queue::block		*held;			// Block lent out by begin_write().
+
+			std::thread				worker;
+			std::atomic<uint64_t>	blocks, frames, write_ns;
+
+			writebehind_ref() :
+				frame_size(0), block_frames(0), stopping(false), failed(false), held(nullptr), blocks(0), frames(0), write_ns(0) {}
+			~writebehind_ref() { stop(); }
+
+			// ********************************
+			// **** Background thread.  Writes blocks until stopped and the queue is empty.
+			void run()
+			{
+				block_queue::block *b;
+				while ((b = queue.begin_pop()) != nullptr)
+				{
+					// Once a write has failed the rest of the queue is dropped.
+					auto start = std::chrono::steady_clock::now();
+					int64_t written = failed ? 0 : sink(b->data.data(), b->frames);
+					write_ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count();
+
+					if (!failed && written != b->frames)
+					{
+						error = "writebehind: Write failed after " + std::to_string(frames + ((written > 0) ? written : 0)) + " frames.\n";
+						failed = true;
+					}
+					++blocks;
+					frames += (written > 0) ? written : 0;
+					queue.end_pop();
+				}
+			}
+			// ********************************
+
+			// ********************************
+			void stop()
+			{
+				stopping = true;
+				queue.close();
+				if (worker.joinable())
+					worker.join();
+			}
+			// ********************************
+		};
+		// **** End writebehind_ref class.
+		// ********************************
+
+		std::shared_ptr<writebehind_ref> p;
+
+	public:
+		// ********************************
+		writebehind() : p(nullptr) {}
+		~writebehind() {}
+		// ********************************
+
+		// ********************************
+		// **** Start the background thread.  'frame_size' is the size of a frame in bytes,
+		// **** 'block_frames' the most frames a single write_frames() call will pass and
+		// **** 'depth' the number of blocks the queue can hold.
+		bool start(sink_t sink, int64_t frame_size, int64_t block_frames, int depth)
+		{
+			stop();
+			if (!sink || frame_size <= 0 || block_frames <= 0 || depth <= 0)
+				return false;
+
+			p = std::make_shared<writebehind_ref>();
+			p->sink = sink;
+			p->frame_size = frame_size;
+			p->block_frames = block_frames;
+			p->queue.init(depth, (size_t)(frame_size * block_frames));
+
+			p->worker = std::thread(&writebehind_ref::run, p.get());
+			return true;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Write everything in the queue and stop the background thread.  Returns
+		// **** false if any write failed.
+		bool stop()
+		{
+			if (p == nullptr)
+				return true;
+			p->stop();
+			return !p->failed;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Wait until everything in the queue has been written.
+		bool flush()
+		{
+			if (!is_running())
+				return stop();
+			p->queue.drain();
+			return !p->failed;
+		}
+		// ********************************
+
+		// ********************************
+		bool is_running() const { return (p != nullptr) && !p->stopping; }
+		int64_t get_block_frames() const { return (p != nullptr) ? p->block_frames : 0; }
+		bool is_borrowed() const { return (p != nullptr) && (p->held != nullptr); }
+
+		// Bytes held by the blocks of the queue.
+		int64_t get_buffer_bytes() const { return (p != nullptr) ? (int64_t)p->queue.capacity() * p->frame_size * p->block_frames : 0; }
+		bool has_failed() const { return (p != nullptr) && p->failed; }
+		const char *get_error_str() const { return (p != nullptr && p->failed) ? p->error.c_str() : ""; }
+
+		writebehind_stats get_stats() const
+		{
+			writebehind_stats stats;
+			if (p == nullptr)
+				return stats;
+			block_queue_stats q = p->queue.get_stats();
+			stats.blocks = p->blocks;
+			stats.frames = p->frames;
+			stats.producer_stalls = q.producer_waits;
+			stats.producer_wait_ns = q.producer_wait_ns;
+			stats.consumer_wait_ns = q.consumer_wait_ns;
+			stats.write_ns = p->write_ns;
+			stats.average_fill = q.get_average_fill();
+			return stats;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Queue frames for writing.  Only waits when the queue is full.  Returns the
+		// **** number of frames queued, which is 0 once a write has failed.
+		int64_t write_frames(const void *ptr, int64_t frames)
+		{
+			if (!is_running())
+				return 0;
+
+			const uint8_t *src = (const uint8_t *)ptr;
+			int64_t total = 0;
+			while (total < frames)
+			{
+				block_queue::block *b = p->queue.begin_push();
+				if (b == nullptr || p->failed)
+					return 0;
+
+				// The background thread never touches a block before it is pushed.
+				int64_t n = std::min(p->block_frames, frames - total);
+				std::memcpy(b->data.data(), src + total * p->frame_size, (size_t)(n * p->frame_size));
+				b->frames = n;
+				total += n;
+				p->queue.end_push();
+			}
+			return total;
+		}
+		// ********************************
+
+		// ********************************
+		// **** Borrow a free block to fill in place.  'frames' gets the number of frames it
+		// **** holds.  Waits only when the queue is full.  Returns nullptr once a write has
+		// **** failed.  Blocks start out zeroed and keep what they held the last time
+		// **** round, so parts the process never writes stay silent.
+		void *begin_write(int64_t &frames)
+		{
+			frames = 0;
+			if (!is_running() || p->failed || p->held != nullptr)
+				return nullptr;
+
+			block_queue::block *b = p->queue.begin_push();
+			if (b == nullptr || p->failed)
+				return nullptr;
+			p->held = b;
+			frames = p->block_frames;
+			return b->data.data();
+		}
+
+		// **** Queue the block from begin_write() with 'frames' frames in it.  Returns the
+		// **** number of frames queued.
+		int64_t end_write(int64_t frames)
+		{
+			if (p == nullptr || p->held == nullptr)
+				return 0;
+			p->held->frames = std::min(frames, p->block_frames);
+			p->held = nullptr;
+			p->queue.end_push();
+			return frames;
+		}
+		// ********************************
+	};
+	// **** End writebehind
+	// ********************************
+}
+// **** End dsp namespace
+// ********************************
+
+
+/*	▄▄▄▄▄▄▄ ▄▄     ▄▄  ▄▄ ▄▄▄▄▄▄▄
+ *	█ ▄▄▄ █ ▄  ▄▄▄██  █ ▄ █ ▄▄▄ █
+ *	█ ███ █ ██▄█ ▄  ▀█▄▄▀ █ ███ █
+ *	█▄▄▄▄▄█ ▄▀▄ █ █ ▄▀█▀▄ █▄▄▄▄▄█
+ *	▄▄▄▄  ▄ ▄▀ ▀ ██ ▄█▀▄▀▄  ▄▄▄ ▄
+ *	██  ██▄█▀▀    ▄█▀▀█▀ ███▀▀▀▀▀
+ *	█▄█ █ ▄ █▄ █▀▀▀▀ ▄ █▀▀  ▀ ▄ ▄
+ *	▄▀ █ █▄▀▀ █▀▄▀▄  █▀█▀▄▀▄ █▄▄█
+ *	█▀▀█ █▄▄▀▀▄▄▀▀  ▄ █ ▄ ▀▄█▀ ▄█
+ *	▄▀▀▀ █▄▄███▄█▀ █▄█  ▄ ▄█▄▄█
+ *	▄▀▀█ ▄▄▄ █▄█▄  ▀█▄ ▄▄███▀█ █
+ *	▄▄▄▄▄▄▄ ▀█▀▄██▀ ▀▀█▄█ ▄ █▀ ▄▀
+ *	█ ▄▄▄ █   █ ▄ ▄▀ ▄▀ █▄▄▄█▄▄█▀
+ *	█ ███ █ █▀ █▀▄▀▀ ██▀▄▀ ▄▀   █
+ *	█▄▄▄▄▄█ ██ ▀▄ ██▄ █▄██▄▄▀▀▄█
+ */
@@ -6,8 +6,12 @@
 #include "configure.h"
 
 #include <vector>
+#include <atomic>
+#include <chrono>
 
 #include "split-combine.h"
+#include "dsp_machine_info.h"
+#include "dsp_thread_pool.h"
 
  
  // ********************************
@@ -43,7 +47,28 @@ namespace dsp
 	{
 		input.clear();
 		output.clear();
+		routes.clear();
+		active_routes.clear();
+		split_layout.clear();
 		error.clear();
+		readahead_depth = 4;
+		readahead_frames = 0;
+		writebehind_depth = 4;
+		output_buffer = 4 * 1024 * 1024;
+		parallel_encode = true;
+		segment_workers = 0;
+		convert_workers = 0;
+		running_files = 1;
+		stream_window = 1024 * 1024;
+		direct_io = false;
+		block_frames = 0;
+		last_block_frames = 0;
+		progress = nullptr;
+		progress_done = 0;
+		progress_total = 0;
+		cancel_flag = false;
+		clear_fanout();
+		io.close();
 		format_override = false;
 		out_format = dsp::dspformat();
 		out_sf_format = SF_FORMAT_WAV;
@@ -53,6 +78,7 @@ namespace dsp
 
 	// ********************************
 	// **** This function adds an input file and returns data about the file.
+	// **** Offsets and sizes over 4GB don't fit, use add_input_ex64() for those.
 	bool dsp_split_combine::add_input_ex(
 		const char *name,			// Path to and name of file.
 		int &Channels,				// Total number of channels.
@@ -67,6 +93,31 @@ namespace dsp
 		int &MediaType,				// 1 = wav, 2 = aif;
 		SF_BROADCAST_INFO &bext
 	)
+	{
+		int64_t offset64 = 0, size64 = 0;
+		bool ret = add_input_ex64(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, offset64, size64, HasBWF, MediaType, bext);
+		dataOffset = (int)offset64;
+		dataSize = (unsigned long)std::min<int64_t>(size64, 0xFFFFFFFF);
+		return ret;
+	}
+
+
+	// ********************************
+	// **** This function adds an input file and returns data about the file.
+	bool dsp_split_combine::add_input_ex64(
+		const char *name,			// Path to and name of file.
+		int &Channels,				// Total number of channels.
+		int &SampleSize,			// Bits per sample.
+		int &FrameSize,				// Size of a single frame of audio (Channels * BytesPerSample).
+		int &SampleRate,			// Sample rate.
+		int &Float,					// True or false. Changed to Float from mFormat.
+		int &ByteOrder,				// Endianness.
+		int64_t &dataOffset,		// File offset of sample data
+		int64_t &dataSize,			// Size of sample data in bytes
+		int &HasBWF,				// 0 for no BWF and 1 for has BWF
+		int &MediaType,				// 1 = wav, 2 = aif;
+		SF_BROADCAST_INFO &bext
+	)
 	{
 		// Create a path object.
 		std::sys::path path(name);
@@ -98,6 +149,73 @@ namespace dsp
 			return false;
 		}
 
+		describe_input(tmp, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+
+		// If this is the first input we need to set the default output format.
+		dsp::dspformat fmt = tmp.get_dspformat();
+		if (input.size() == 0)
+		{
+			out_format = fmt;
+			out_sf_format = tmp.get_format();
+		}
+
+		// Add the file to the input list
+		input.emplace_back(path, tmp, fmt);
+
+		// Uncompressed sample data in these containers is read through a memory map
+		// instead of libsndfile.  If the map can't be opened libsndfile is used.
+		bool mappable = false;
+		switch (tmp.get_format() & SF_FORMAT_TYPEMASK)
+		{
+		case SF_FORMAT_WAV:
+		case SF_FORMAT_WAVEX:
+		case SF_FORMAT_RF64:
+		case SF_FORMAT_W64:
+		case SF_FORMAT_AIFF:
+		case SF_FORMAT_CAF:
+			switch (tmp.get_format() & SF_FORMAT_SUBMASK)
+			{
+			case SF_FORMAT_PCM_16:
+			case SF_FORMAT_PCM_24:
+			case SF_FORMAT_PCM_32:
+			case SF_FORMAT_FLOAT:
+			case SF_FORMAT_DOUBLE:
+				mappable = true;
+				break;
+			}
+			break;
+		}
+
+		if (mappable)
+		{
+			input.back().mapped.open(
+				path.string(),
+				sfp_get_dataoffset(tmp.get_sndfile_ptr()),
+				sfp_get_datalength(tmp.get_sndfile_ptr()),
+				Channels, SampleSize, Float != 0, ByteOrder == 1, direct_io);
+		}
+		return true;
+	}
+
+
+	// ********************************
+	// **** Fill in the information add_input_ex() and probe_input() return from an
+	// **** open file.
+	void dsp_split_combine::describe_input(
+		dsp::dspfile &tmp,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	)
+	{
 		// Get data calling function...
 		dsp::dspformat fmt = tmp.get_dspformat();
 		Channels	=	tmp.get_channels();		// Total number of channels.
@@ -129,18 +247,160 @@ namespace dsp
 		//int &dataOffset,	// ???
 		dataOffset = dataSize = 0;
 		tmp.seek(0, SF_SEEK_SET);
-		dataOffset = (int)sfp_get_dataoffset(tmp.get_sndfile_ptr());
-		dataSize = (unsigned long)sfp_get_datalength(tmp.get_sndfile_ptr());//((unsigned int)tmp.get_frames() * FrameSize);
+		dataOffset = sfp_get_dataoffset(tmp.get_sndfile_ptr());
+		dataSize = sfp_get_datalength(tmp.get_sndfile_ptr());//((unsigned int)tmp.get_frames() * FrameSize);
+	}
 
-		// If this is the first input we need to set the default output format.
-		if (input.size() == 0)
+
+	// ********************************
+	// **** Returns the same information as add_input_ex() without adding the file.
+	// **** Uncompressed WAV/RF64/W64/AIFF/CAF files only have their headers read and the
+	// **** result is kept in the probe cache.  Anything else is opened with libsndfile.
+	bool dsp_split_combine::probe_input(
+		const char *name,
+		int &Channels,
+		int &SampleSize,
+		int &FrameSize,
+		int &SampleRate,
+		int &Float,
+		int &ByteOrder,
+		int64_t &dataOffset,
+		int64_t &dataSize,
+		int &HasBWF,
+		int &MediaType,
+		SF_BROADCAST_INFO &bext
+	)
+	{
+		dsp::probe_info info;
+		if (probes.probe(name, info))
 		{
-			out_format = fmt;
-			out_sf_format = tmp.get_format();
+			Channels	=	info.channels;
+			SampleSize	=	info.bits;
+			FrameSize	=	(info.bits / 8) * info.channels;
+			SampleRate	=	info.rate;
+			Float		=	info.floating_point;
+			ByteOrder	=	info.big_endian ? 1 : 0;
+			dataOffset	=	info.data_offset;
+			dataSize	=	info.data_bytes;
+			HasBWF		=	info.has_bext;
+			MediaType	=	info.get_major_format() >> 16;
+			bext		=	info.bext;
+			return true;
 		}
 
-		// Add the file to the input list
-		input.emplace_back(path, tmp, fmt);
+		dsp::dspfile tmp;
+		tmp.open(std::string(name));
+		if (!tmp.is_open())
+		{
+			error = "probe_input(): Could not open the file: " + std::string(name) + "\n";
+			error += tmp.get_error_string();
+			error += "\n";
+			return false;
+		}
+		describe_input(tmp, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+		return true;
+	}
+
+
+	// ********************************
+	// **** Keep probe results in the file 'name' between runs.  Returns false if the
+	// **** old cache could not be written or 'name' can't be read or created.
+	bool dsp_split_combine::set_probe_cache(const char *name)
+	{
+		bool saved = probes.save();
+		if (name == nullptr || !probes.open(name))
+		{
+			error = std::string("set_probe_cache(): Could not read or create the probe cache \"") + ((name) ? name : "") + "\".\n";
+			return false;
+		}
+		if (!saved)
+		{
+			error = "set_probe_cache(): Could not write the old probe cache.\n";
+			return false;
+		}
+		return true;
+	}
+
+	bool dsp_split_combine::save_probe_cache()
+	{
+		if (!probes.save())
+		{
+			error = "save_probe_cache(): Could not write the probe cache.\n";
+			return false;
+		}
+		return true;
+	}
+
+
+	// ********************************
+	// **** Keep finished jobs in the file 'name' so unchanged ones are skipped next time.
+	bool dsp_split_combine::set_job_cache(const char *name, bool hash)
+	{
+		bool saved = done_jobs.close();
+		done_jobs.set_hash(hash);
+		if (name != nullptr && *name != 0 && !done_jobs.open(name))
+		{
+			error = std::string("set_job_cache(): Could not read or create the job cache \"") + name + "\".\n";
+			return false;
+		}
+		if (!saved)
+		{
+			error = "set_job_cache(): Could not write the old job cache.\n";
+			return false;
+		}
+		return true;
+	}
+
+	bool dsp_split_combine::save_job_cache()
+	{
+		if (!done_jobs.save())
+		{
+			error = "save_job_cache(): Could not write the job cache.\n";
+			return false;
+		}
+		return true;
+	}
+
+
+	// ********************************
+	// **** Key and signature of a job.  The key is the operation and the paths of its
+	// **** outputs.  The signature is what the outputs are made from, so the format of
+	// **** every output as it will be written, the routes and the identity and range of
+	// **** every input.  Returns false when the cache is off or the job reads or writes
+	// **** a stream.
+	bool dsp_split_combine::get_job_signature(
+		const char *op, const std::vector<file_description *> &ins, const std::vector<file_description *> &outs,
+		const std::vector<route_t> &job_routes, std::string &job, std::string &signature)
+	{
+		if (!done_jobs.is_open() || ins.empty() || outs.empty())
+			return false;
+
+		// Outputs without a rate or sample format take them from the first input.
+		const dsp::dspformat &in_format = ins[0]->format;
+		job = op;
+		signature = op;
+		for (auto out : outs)
+		{
+			if (out->stream.is_open())
+				return false;
+			bool has_bits = out->format.get_bits() != 0;
+			int rate = out->format.get_rate() ? out->format.get_rate() : in_format.get_rate();
+			int bits = has_bits ? out->format.get_bits() : in_format.get_bits();
+			bool floats = has_bits ? out->format.is_floats() : in_format.is_floats();
+			job += "|" + out->path.string();
+			signature += "|" + std::to_string(rate) + ":" + std::to_string(bits) + (floats ? "f" : "i");
+		}
+		for (auto &r : job_routes)
+		{
+			signature += "|" + std::to_string(r.src_file) + "." + std::to_string(r.src_ch) +
+				">" + std::to_string(r.dst_file) + "." + std::to_string(r.dst_ch);
+		}
+		for (auto in : ins)
+		{
+			if (in->stream.is_open() || !done_jobs.add_input(signature, in->path.string()))
+				return false;
+			signature += "@" + std::to_string(in->range_start) + "+" + std::to_string(in->range_length);
+		}
 		return true;
 	}
 
@@ -158,11 +418,12 @@ namespace dsp
 			SampleRate,		// Sample rate.
 			Float,			// True or false.
 			ByteOrder,		// Endianness.
-			dataOffset,		// File offset of sample data
 			HasBWF,			// 0 for no BWF and 1 for has BWF
 			MediaType;		// 1 = wav, 2 = aif;
-		unsigned long dataSize;	// Size of sample data in bytes
-		return add_input_ex(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
+		int64_t
+			dataOffset,		// File offset of sample data
+			dataSize;		// Size of sample data in bytes
+		return add_input_ex64(name, Channels, SampleSize, FrameSize, SampleRate, Float, ByteOrder, dataOffset, dataSize, HasBWF, MediaType, bext);
 	}
 
 
@@ -188,206 +449,1724 @@ namespace dsp
 
 
 	// ********************************
-	// ********************************
-	// **** This function will return the number of frames for a single buffer.
-	template <typename _Type>
-	unsigned int dsp_split_combine::get_buffer_length()
+	// **** Add an input read from a pipe or other stream.  Nothing is memory mapped and
+	// **** the length isn't known until the end of the stream is reached.
+	bool dsp_split_combine::add_input_stream(int fd, const char *name, int &Channels)
 	{
-		return (1*2*3*4*5*6*7*8);	// What is a good size for this???
-	}
+		std::sys::path path(name);
+		dsp::stream_vio stream;
+		if (!stream.open_read(fd, stream_window))
+		{
+			error = "add_input_stream(): Bad stream for: " + path.string() + "\n";
+			return false;
+		}
 
+		dsp::dspfile tmp;
+		tmp.open(stream.get_vio(), stream.get_user_data(), SFM_READ);
+		if (!tmp.is_open())
+		{
+			error = "add_input_stream(): Could not open the stream: " + path.string() + "\n";
+			error += tmp.get_error_string();
+			error += "\n";
+			return false;
+		}
 
-	// ********************************
-	// **** A private template function used to run the actual split.
-	template <typename _TypeSrc, typename _TypeDst>
-	void dsp_split_combine::split_template()
-	{
-		// Get number of frames to read each round.  And number of channels.
-		int frames = get_buffer_length<_TypeDst>();
-		int channels = input[0].format.get_channels();
+		dsp::dspformat fmt = tmp.get_dspformat();
+		fmt.set_frames(0);
+		Channels = tmp.get_channels();
 
-		// Main buffer.
-		dsp::dspvector<_TypeSrc> inbuffer(frames * channels);
-		dsp::dspvector<_TypeDst> outbuffer(frames * channels);
-		std::vector<_TypeDst *>  chptr(channels);
+		// If this is the first input we need to set the default output format.
+		if (input.size() == 0)
+		{
+			out_format = fmt;
+			out_sf_format = tmp.get_format();
+		}
 
-		// Setup some pointers to each channel in non-interleaved space.
-		for (int i = 0; i < channels; ++i)
-			chptr[i] = (_TypeDst*)((unsigned char*)outbuffer.data() + (frames * i * sizeof(_TypeDst)));
+		input.emplace_back(path, fmt);
+		input.back().stream = stream;
+		input.back().file = tmp;
+		return true;
+	}
 
-		// Setup transposition process.
-		dsp::transpose_to de_interleave(frames, channels, deinterleave);
 
-		// Main loop:
-		int rframes;
-		while ((rframes = (int)input[0].file.read_frames<_TypeSrc>((_TypeSrc*)inbuffer.data(), frames)) == frames) // Read input.
+	// ********************************
+	// **** Add an output written to a pipe or other stream.
+	bool dsp_split_combine::add_output_stream(int fd, const char *name, int fmtcodec, int rate)
+	{
+		if (input.size() == 0)
 		{
-			// Transpose and convert type.
-			de_interleave(inbuffer, outbuffer);
+			error = "add_output_stream(): Add the inputs first.\n";
+			return false;
+		}
+
+		std::sys::path path(name);
 
-			// Write output.  FIXME: We should really log and report errors while writing.
-			for (int i = 0; i < channels; ++i)
-				output[i].file.write_frames<_TypeDst>(chptr[i], rframes);
+		// The header of anything else is patched at the end, behind the part of the
+		// stream that was already sent.
+		dsp::dspfile tmp;
+		int type = tmp.get_good_sf_format(path.extension(), input[0].format) & SF_FORMAT_TYPEMASK;
+		if (type != SF_FORMAT_RAW && type != SF_FORMAT_AU && type != SF_FORMAT_CAF)
+		{
+			error = "add_output_stream(): Streams can only be written as raw, au or caf: " + path.string() + "\n";
+			return false;
 		}
 
-		// Handle leftovers...
-		if (rframes > 0)
+		dsp::stream_vio stream;
+		if (!stream.open_write(fd, stream_window))
 		{
-			dsp::transpose_to de_interleave_leftovers(rframes, channels, deinterleave);
-			de_interleave_leftovers(inbuffer, outbuffer);
+			error = "add_output_stream(): Bad stream for: " + path.string() + "\n";
+			return false;
+		}
+
+		if (!add_output_path(path, fmtcodec, rate))
+			return false;
+		output.back().stream = stream;
+		return true;
+	}
+
 
-			// Write output.  FIXME: We should really log and report errors while writing.
-			for (int i = 0; i < channels; ++i)
-				output[i].file.write_frames<_TypeDst>((_TypeDst*)((unsigned char*)outbuffer.data() + (rframes * i * sizeof(_TypeDst))), rframes);
+	// ********************************
+	// **** Set the number of frames processed in each block.  0 picks it from the cache
+	// **** sizes of the machine.
+	bool dsp_split_combine::set_block_frames(int frames)
+	{
+		if (frames < 0)
+		{
+			error = "set_block_frames(): Block size can not be negative.\n";
+			return false;
 		}
+		block_frames = frames;
+		return true;
+	}
+
+	// **** Frames per block used by the last process.
+	bool dsp_split_combine::get_block_frames(int &frames)
+	{
+		frames = (int)last_block_frames;
+		return true;
 	}
+	// ********************************
 
 
 	// ********************************
-	// **** Template for the combine process.
-	template <typename _TypeSrc, typename _TypeDst>
-	void dsp_split_combine::combine_template()
+	// **** Turn unbuffered I/O on or off for files added or opened after this call.
+	bool dsp_split_combine::set_direct_io(bool enable)
 	{
-		// Get number of frames to read each round, number of channels etc...
-		bool do_complex_method = false;
-		bool done = false;
-		int channels = 0;
-		int i, cur_c, rframes, maxframes = 0;
-		int frames = get_buffer_length<_TypeDst>();
-		int num_inputs = input.size();
+		direct_io = enable;
+		return true;
+	}
+	// ********************************
 
-		// Calculate number of output channels and decide what method to use.
-		for (i = 0; i < num_inputs; ++i)
+
+	// ********************************
+	// **** Progress callback and cancel flag.  Only set_cancel() and the getters may be
+	// **** called while a process runs.  The C interface refuses everything else while
+	// **** a handle has a job.
+	bool dsp_split_combine::set_progress(std::function<void(int64_t done, int64_t total)> fn)
+	{
+		progress = fn;
+		return true;
+	}
+
+	bool dsp_split_combine::get_progress(int64_t &done, int64_t &total)
+	{
+		done = progress_done;
+		total = progress_total;
+		return true;
+	}
+
+	bool dsp_split_combine::set_cancel(bool cancel)
+	{
+		cancel_flag = cancel;
+		return true;
+	}
+
+	bool dsp_split_combine::is_cancelled() { return cancel_flag; }
+
+
+	// ********************************
+	// **** Add an output that a split writes every channel of the first input to.
+	bool dsp_split_combine::add_copy_output(const char *name, int fmtcodec, int rate)
+	{
+		if (input.empty())
 		{
-			int c = input[i].format.get_channels();
-			channels += c;
-			if (c != 1)
-				do_complex_method = true;
+			error = "add_copy_output(): Add the input file first.\n";
+			return false;
+		}
+		dsp::dspformat fmt;
+		if (fmtcodec)
+			fmt = input[0].file.get_dspformat_from(fmtcodec, rate);
+		fmt.set_rate(rate);
+		std::sys::path path(name);
+		copies.emplace_back(path, fmt);
+		return true;
+	}
+
+	bool dsp_split_combine::add_tap(std::function<void(const float *samples, int channels, int64_t frames)> fn)
+	{
+		if (!fn)
+		{
+			error = "add_tap(): No function given.\n";
+			return false;
 		}
+		taps.push_back(fn);
+		return true;
+	}
+
+	bool dsp_split_combine::set_levels(bool enable)
+	{
+		measure_levels = enable;
+		return true;
+	}
 
-		if (!do_complex_method)
+	bool dsp_split_combine::get_levels(int channel, double &peak, double &rms)
+	{
+		if (channel < 0 || channel >= (int)levels.peak.size())
 		{
-			// Simple method...
-			// Setup interleave functor.
-			dsp::transpose_to interleave(frames, channels, dsp::interleave);
+			error = "get_levels(): No levels for channel " + std::to_string(channel) + ".\n";
+			return false;
+		}
+		peak = levels.peak[channel];
+		rms = levels.get_rms(channel);
+		return true;
+	}
 
-			// Create buffers.
-			dsp::dspvector<_TypeSrc> inbuffer(frames * num_inputs);
-			dsp::dspvector<_TypeDst> outbuffer(frames * num_inputs);
+	bool dsp_split_combine::clear_fanout()
+	{
+		copies.clear();
+		taps.clear();
+		measure_levels = false;
+		levels = dsp::channel_levels();
+		return true;
+	}
 
-			// Run loop.
-			while (!done)
-			{
-				done = true;
-				maxframes = 0;
+	bool dsp_split_combine::has_fanout() { return !copies.empty() || has_taps(); }
+	bool dsp_split_combine::has_taps() { return !taps.empty() || measure_levels; }
+
+	// Hand a block to every tap.
+	void dsp_split_combine::feed_taps(const float *samples, int channels, int64_t frames)
+	{
+		if (measure_levels)
+			levels.add(samples, channels, frames);
+		for (auto &tap : taps)
+			tap(samples, channels, frames);
+	}
 
-				for (i = 0; i < num_inputs; ++i)
-				{
-					// Read in buffer.
-					if ((rframes = (int)input[i].file.read_frames<_TypeSrc>((_TypeSrc*)(inbuffer.data() + (frames * i)), frames)) == frames)
-						done = false;
 
-					// Zero out end of buffer if necessary.
-					for (int x = rframes; x < frames; ++x)
-						inbuffer[(frames * i) + x] = dsp::sample_traits<_TypeSrc>::zero();
+	// ********************************
+	// **** Called at the start of a process and after every block.
+	void dsp_split_combine::start_progress(int64_t total)
+	{
+		progress_done = 0;
+		progress_total = total;
+		if (progress)
+			progress(0, total);
+	}
 
-					// Set max frames.
-					if (rframes > maxframes)
-						maxframes = rframes;
+	bool dsp_split_combine::step_progress(int64_t frames)
+	{
+		int64_t done = (progress_done += frames);
+		if (progress)
+			progress(done, progress_total);
+		return !cancel_flag;
+	}
+	// ********************************
 
-				} // for (i = 0; i < num_inputs; ++i)
 
-				if (maxframes)
-				{
-					// Finally, transpose input buffer to output buffer.
-					interleave(inbuffer, outbuffer);
+	// ********************************
+	// **** Statistics.
+	static inline uint64_t steady_ns()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void dsp_split_combine::stats_counters::reset()
+	{
+		frames_read = bytes_read = frames_written = bytes_written = blocks = 0;
+		for (stage_counter *s : { &read, &convert, &transpose, &write, &metadata })
+			s->wall_ns = s->cpu_ns = 0;
+		buffer_bytes = peak_buffer_bytes = 0;
+		budget_waits = budget_shrinks = 0;
+		jobs_skipped = 0;
+		wall_start = cpu_start = wall_ns = cpu_ns = 0;
+		running = false;
+	}
 
-					// And write to output file.
-					output[0].file.write_frames<_TypeDst>((_TypeDst*)outbuffer.data(), maxframes);
+	dsp_split_combine::stage_timer::stage_timer(stage_counter &s) :
+		stage(&s), wall(steady_ns()), cpu(dsp::machine::thread_cpu_ns()) {}
 
-				} // if (maxframes)
-			} // while (!done)
-		}
-		else
-		{
-			// Complex method is below and the simple method is above.
-			// Create input/mid buffers.
-			std::vector<dsp::dspvector<_TypeDst>> inbuffers(num_inputs);
-			std::vector<dsp::dspvector<_TypeDst>> midbuffers(num_inputs);
+	void dsp_split_combine::stage_timer::stop()
+	{
+		if (stage == nullptr)
+			return;
+		stage->wall_ns += steady_ns() - wall;
+		stage->cpu_ns += dsp::machine::thread_cpu_ns() - cpu;
+		stage = nullptr;
+	}
+
+	dsp_split_combine::process_timer::process_timer(stats_counters &_c) : c(_c)
+	{
+		c.reset();
+		c.wall_start = steady_ns();
+		c.cpu_start = dsp::machine::process_cpu_ns();
+		c.running = true;
+	}
+
+	dsp_split_combine::process_timer::~process_timer()
+	{
+		c.wall_ns = steady_ns() - c.wall_start;
+		c.cpu_ns = dsp::machine::process_cpu_ns() - c.cpu_start;
+		c.running = false;
+	}
+
+	void dsp_split_combine::count_read(file_description &in, int64_t frames)
+	{
+		if (frames <= 0)
+			return;
+		counters.frames_read += frames;
+		counters.bytes_read += frames * in.format.get_channels() * ((in.format.get_bits() + 7) / 8);
+	}
+
+	void dsp_split_combine::count_write(file_description &out, int64_t frames)
+	{
+		if (frames <= 0)
+			return;
+		counters.frames_written += frames;
+		counters.bytes_written += frames * out.format.get_channels() * ((out.format.get_bits() + 7) / 8);
+	}
+
+	// Add 'bytes' to the buffer memory in use.  Negative when buffers are let go.
+	void dsp_split_combine::use_buffers(int64_t bytes)
+	{
+		int64_t now = (counters.buffer_bytes += bytes);
+		int64_t peak = counters.peak_buffer_bytes;
+		while (now > peak && !counters.peak_buffer_bytes.compare_exchange_weak(peak, now)) {}
+	}
+
+	// Bytes held by the queues and staging buffers of a file.
+	int64_t dsp_split_combine::get_buffer_bytes(file_description &f)
+	{
+		return
+			f.readahead.get_buffer_bytes() + f.writebehind.get_buffer_bytes() +
+			(int64_t)f.staging.capacity() + f.writer.get_buffer_bytes();
+	}
+
+	bool dsp_split_combine::get_stats(dsp::process_stats &stats)
+	{
+		stats = dsp::process_stats();
+		stats.frames_read = counters.frames_read;
+		stats.bytes_read = counters.bytes_read;
+		stats.frames_written = counters.frames_written;
+		stats.bytes_written = counters.bytes_written;
+		stats.blocks = counters.blocks;
+
+		dsp::stage_time *dst[5] = { &stats.read, &stats.convert, &stats.transpose, &stats.write, &stats.metadata };
+		stage_counter *src[5] = { &counters.read, &counters.convert, &counters.transpose, &counters.write, &counters.metadata };
+		for (int i = 0; i < 5; ++i)
+		{
+			dst[i]->wall_ns = src[i]->wall_ns;
+			dst[i]->cpu_ns = src[i]->cpu_ns;
+		}
+
+		// A running process is measured up to now.
+		if (counters.running)
+		{
+			stats.wall_ns = steady_ns() - counters.wall_start;
+			stats.cpu_ns = dsp::machine::process_cpu_ns() - counters.cpu_start;
+		}
+		else
+		{
+			stats.wall_ns = counters.wall_ns;
+			stats.cpu_ns = counters.cpu_ns;
+		}
+		stats.peak_buffer_bytes = (uint64_t)std::max<int64_t>(0, counters.peak_buffer_bytes);
+		stats.budget_waits = counters.budget_waits;
+		stats.budget_shrinks = counters.budget_shrinks;
+		stats.jobs_skipped = counters.jobs_skipped;
+		if (stats.wall_ns > 0)
+			stats.mb_per_sec = (double)(stats.bytes_read + stats.bytes_written) / (1024.0 * 1024.0) / (stats.wall_ns / 1e9);
+		return true;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Set the ring buffer size used by streams added after this call.  It has to
+	// **** hold the whole header of a stream input.
+	bool dsp_split_combine::set_stream_window(int window)
+	{
+		if (window < 4096)
+		{
+			error = "set_stream_window(): The window must be at least 4096 bytes.\n";
+			return false;
+		}
+		stream_window = window;
+		return true;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Add a channel route from an input file/channel to an output file/channel.
+	bool dsp_split_combine::add_route(int src_file, int src_ch, int dst_file, int dst_ch)
+	{
+		if (src_file < 0 || src_ch < 0 || dst_file < 0 || dst_ch < 0)
+		{
+			error = "add_route(): Negative file or channel index.\n";
+			return false;
+		}
+
+		// Two routes can not write to the same output channel.
+		for (auto &r : routes)
+		{
+			if (r.dst_file == dst_file && r.dst_ch == dst_ch)
+			{
+				error = "add_route(): Output file " + std::to_string(dst_file) +
+					" channel " + std::to_string(dst_ch) + " is already routed.\n";
+				return false;
+			}
+		}
+
+		routes.emplace_back(src_file, src_ch, dst_file, dst_ch);
+		return true;
+	}
+
+	bool dsp_split_combine::clear_routes()
+	{
+		routes.clear();
+		return true;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Set the channel grouping used by split.
+	bool dsp_split_combine::set_split_layout(const int *groups, int count)
+	{
+		split_layout.clear();
+		for (int i = 0; i < count; ++i)
+		{
+			if (groups[i] <= 0)
+			{
+				error = "set_split_layout(): Group " + std::to_string(i) + " has no channels.\n";
+				split_layout.clear();
+				return false;
+			}
+			split_layout.push_back(groups[i]);
+		}
+		return true;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Set how far ahead of the process inputs are read.
+	bool dsp_split_combine::set_readahead(int depth, int block_frames)
+	{
+		if (depth < 0 || block_frames < 0)
+		{
+			error = "set_readahead(): Depth and block size can not be negative.\n";
+			return false;
+		}
+		readahead_depth = depth;
+		readahead_frames = block_frames;
+		return true;
+	}
+
+	// ********************************
+	// **** Get the read-ahead counters from the last process that read input 'index'.
+	bool dsp_split_combine::get_readahead_stats(int index, dsp::readahead_stats &stats)
+	{
+		if (index < 0 || index >= (int)input.size())
+		{
+			error = "get_readahead_stats(): No input file " + std::to_string(index) + ".\n";
+			return false;
+		}
+		stats = input[index].readahead.get_stats();
+		return true;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Set how many blocks can be queued behind each output.
+	bool dsp_split_combine::set_writebehind(int depth)
+	{
+		if (depth < 0)
+		{
+			error = "set_writebehind(): Depth can not be negative.\n";
+			return false;
+		}
+		writebehind_depth = depth;
+		return true;
+	}
+
+	// ********************************
+	// **** Process only part of input 'index'.  'start' is a frame of the file or, with
+	// **** 'timecode', a time reference in samples since midnight like the bext chunk
+	// **** holds.  A 'length' of 0 goes to the end of the file.
+	bool dsp_split_combine::set_input_range(int index, int64_t start, int64_t length, bool timecode)
+	{
+		if (index < 0 || index >= (int)input.size())
+		{
+			error = "set_input_range(): No input file " + std::to_string(index) + ".\n";
+			return false;
+		}
+
+		file_description &in = input[index];
+		if (timecode)
+		{
+			dsp::dspbwf bext;
+			if (!in.file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO)))
+			{
+				error = "set_input_range(): \"" + in.path.string() + "\" has no bext chunk to take the time reference from.\n";
+				return false;
+			}
+			start -= (int64_t)bext.get_time_reference();
+		}
+
+		if (start > 0 && in.stream.is_open())
+		{
+			error = "set_input_range(): A stream can only be read from the start.\n";
+			return false;
+		}
+		int64_t total = in.mapped.is_open() ? in.mapped.get_frames() : in.file.get_frames();
+		if (start < 0 || length < 0 || (!in.stream.is_open() && start >= total))
+		{
+			error = "set_input_range(): Range is outside of \"" + in.path.string() + "\".\n";
+			return false;
+		}
+
+		in.range_start = start;
+		in.range_length = length;
+		return true;
+	}
+
+	// ********************************
+	// **** Set how many files do_convert() converts at once.
+	bool dsp_split_combine::set_convert_workers(int workers)
+	{
+		if (workers < 0)
+		{
+			error = "set_convert_workers(): Number of workers can not be negative.\n";
+			return false;
+		}
+		convert_workers = workers;
+		return true;
+	}
+
+	// ********************************
+	// **** Set how many segments a long input can be processed in at once.
+	bool dsp_split_combine::set_segments(int workers)
+	{
+		if (workers < 0)
+		{
+			error = "set_segments(): Number of segments can not be negative.\n";
+			return false;
+		}
+		segment_workers = workers;
+		return true;
+	}
+
+	// ********************************
+	// **** Turn encoding compressed outputs on their own threads on or off.
+	bool dsp_split_combine::set_parallel_encode(bool enable)
+	{
+		parallel_encode = enable;
+		return true;
+	}
+
+	// ********************************
+	// **** Set how many bytes are collected for each output before they are written.
+	bool dsp_split_combine::set_output_buffer(int bytes)
+	{
+		if (bytes < 0)
+		{
+			error = "set_output_buffer(): Size can not be negative.\n";
+			return false;
+		}
+		output_buffer = bytes;
+		return true;
+	}
+
+	// ********************************
+	// **** Get the write-behind counters from the last process that wrote output 'index'.
+	bool dsp_split_combine::get_writebehind_stats(int index, dsp::writebehind_stats &stats)
+	{
+		if (index < 0 || index >= (int)output.size())
+		{
+			error = "get_writebehind_stats(): No output file " + std::to_string(index) + ".\n";
+			return false;
+		}
+		stats = output[index].writebehind.get_stats();
+		return true;
+	}
+
+	// ********************************
+	// **** Add up the counters of every input and output of the last process.
+	bool dsp_split_combine::get_pipeline_stats(dsp::pipeline_stats &stats)
+	{
+		stats = dsp::pipeline_stats();
+		int readers = 0, writers = 0;
+		for (auto &in : input)
+		{
+			dsp::readahead_stats s = in.readahead.get_stats();
+			if (s.blocks == 0)
+				continue;
+			stats.read_ns += s.read_ns;
+			stats.read_wait_ns += s.producer_wait_ns;
+			stats.process_read_wait_ns += s.consumer_wait_ns;
+			stats.read_fill += s.average_fill;
+			++readers;
+		}
+		for (auto &out : output)
+		{
+			dsp::writebehind_stats s = out.writebehind.get_stats();
+			if (s.blocks == 0)
+				continue;
+			stats.write_ns += s.write_ns;
+			stats.write_wait_ns += s.consumer_wait_ns;
+			stats.process_write_wait_ns += s.producer_wait_ns;
+			stats.write_fill += s.average_fill;
+			++writers;
+		}
+		if (readers > 0)
+			stats.read_fill /= readers;
+		if (writers > 0)
+			stats.write_fill /= writers;
+
+		// The process thread waits on readers and writers one after the other.  Readers
+		// and writers wait on the process side by side, so use the average for them.
+		uint64_t on_read = stats.process_read_wait_ns;
+		uint64_t on_write = stats.process_write_wait_ns;
+		uint64_t on_process = (readers > 0) ? stats.read_wait_ns / readers : ((writers > 0) ? stats.write_wait_ns / writers : 0);
+		if (on_read > on_write && on_read > on_process)
+			stats.bottleneck = dsp::pipeline_stats::read_stage;
+		else if (on_write > on_process)
+			stats.bottleneck = dsp::pipeline_stats::write_stage;
+		else
+			stats.bottleneck = dsp::pipeline_stats::process_stage;
+		return true;
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Choose the I/O engine used by the native reader/writer paths.
+	bool dsp_split_combine::set_io_engine(int mode)
+	{
+		if (mode != dsp::io_engine::blocking && mode != dsp::io_engine::uring)
+		{
+			error = "set_io_engine(): Unknown I/O engine " + std::to_string(mode) + ".\n";
+			return false;
+		}
+		io.open(mode);
+		return true;
+	}
+
+	// ********************************
+	// **** Get the I/O engine that is really in use.
+	int dsp_split_combine::get_io_engine()
+	{
+		return io.get_mode();
+	}
+	// ********************************
+
+
+	// ********************************
+	// **** Check the active routing map against the input files.
+	// **** Returns the number of output files used by the map or -1 on error.
+	int dsp_split_combine::check_routes(const char *func)
+	{
+		int num_outputs = 0;
+		for (auto &r : active_routes)
+		{
+			if (r.src_file >= (int)input.size())
+			{
+				error = std::string(func) + ": Route uses input file " + std::to_string(r.src_file) + " which does not exist.\n";
+				return -1;
+			}
+			if (r.src_ch >= input[r.src_file].format.get_channels())
+			{
+				error = std::string(func) + ": Route uses channel " + std::to_string(r.src_ch) +
+					" which does not exist in \"" + input[r.src_file].path.string() + "\".\n";
+				return -1;
+			}
+			if (r.dst_file + 1 > num_outputs)
+				num_outputs = r.dst_file + 1;
+		}
+
+		if (num_outputs == 0)
+			error = std::string(func) + ": Routing map is empty.\n";
+
+		// Every output file must receive at least one channel.
+		for (int i = 0; i < num_outputs; ++i)
+		{
+			if (get_route_channels(i) == 0)
+			{
+				error = std::string(func) + ": Output file " + std::to_string(i) + " has no channels routed to it.\n";
+				return -1;
+			}
+		}
+		return (num_outputs) ? num_outputs : -1;
+	}
+
+
+	// ********************************
+	// **** Returns the number of channels routed to output file 'index'.
+	int dsp_split_combine::get_route_channels(int index)
+	{
+		int channels = 0;
+		for (auto &r : active_routes)
+		{
+			if (r.dst_file == index && r.dst_ch + 1 > channels)
+				channels = r.dst_ch + 1;
+		}
+		return channels;
+	}
+	// ********************************
+
+
+	// ********************************
+	// ********************************
+	// **** This function will return the number of frames for a single buffer.  The
+	// **** input and output buffers of a block should sit in L2 with room to spare and
+	// **** the blocks waiting in the read-ahead and write-behind queues in half of L3.
+	// **** 'in_frame_bytes' and 'out_frame_bytes' are the size of one frame of every
+	// **** input and output buffer the process uses.
+	int64_t dsp_split_combine::pick_block_frames(int64_t in_frame_bytes, int64_t out_frame_bytes)
+	{
+		if (block_frames > 0)
+			return last_block_frames = block_frames;
+
+		const dsp::machine::cache_info &cache = dsp::machine::get_cache_info();
+		int64_t hot = std::max<int64_t>(in_frame_bytes + out_frame_bytes, 1);
+		int64_t queued = in_frame_bytes * readahead_depth + out_frame_bytes * writebehind_depth;
+
+		int64_t frames = (int64_t)(cache.l2 / 2) / hot;
+		if (queued > 0)
+			frames = std::min<int64_t>(frames, (int64_t)(cache.l3 / 2) / queued);
+
+		// Below this the system calls and queue hand-offs for each block cost more than
+		// the cache misses.  Above it nothing gets faster.
+		frames = std::max<int64_t>(256, std::min<int64_t>(65536, frames));
+		return last_block_frames = frames & ~(int64_t)63;
+	}
+
+
+	// ********************************
+	// **** Lease what a process with blocks of 'frames' frames needs from the memory
+	// **** budget shared by every process.  The process buffers and queued blocks grow
+	// **** with the block size, the staging buffers of the outputs in 'outs' don't.  When
+	// **** the budget is short the blocks shrink down to 256 frames, below that the
+	// **** process waits for memory.
+	int64_t dsp_split_combine::fit_budget(dsp::memory_budget::lease &mem, int64_t frames, int64_t in_frame_bytes, int64_t out_frame_bytes, const std::vector<int> &outs, bool with_copies)
+	{
+		int64_t per_frame =
+			in_frame_bytes * (1 + std::max(0, readahead_depth)) +
+			out_frame_bytes * (1 + std::max(0, writebehind_depth));
+		std::vector<file_description *> files;
+		for (int o : outs)
+			files.push_back(&output[o]);
+		if (with_copies)
+		{
+			for (auto &c : copies)
+				files.push_back(&c);
+		}
+		int64_t fixed = 0;
+		for (auto f : files)
+		{
+			if (f->writer.is_open())
+				fixed += f->writer.get_buffer_bytes();
+			else if (output_buffer > 0)
+				fixed += output_buffer * 2;	// The staging buffer and the one being written.
+		}
+
+		int64_t least = std::min<int64_t>(frames, 256);
+		int64_t want = frames * per_frame + fixed;
+		bool waited = false, shrunk = false;
+		int64_t got = mem.acquire(dsp::get_memory_budget(), want, least * per_frame + fixed, &cancel_flag, &waited, &shrunk);
+		if (waited)
+			++counters.budget_waits;
+		if (shrunk)
+			++counters.budget_shrinks;
+		if (got <= 0 && want > 0)
+			return 0;
+
+		if (shrunk && per_frame > 0)
+		{
+			frames = (got - fixed) / per_frame;
+			if (frames > 64)
+				frames &= ~(int64_t)63;
+			last_block_frames = frames = std::max(frames, least);
+		}
+		return frames;
+	}
+
+
+	// ********************************
+	// **** Read frames from an input file.  Takes them from the read-ahead ring while
+	// **** it is running.
+	template <typename _Type>
+	inline int64_t dsp_split_combine::read_input(file_description &in, _Type *ptr, int64_t frames)
+	{
+		stage_timer t(counters.read);
+		int64_t ret;
+		if (in.readahead.is_running())
+			ret = in.readahead.read_frames(ptr, frames);
+		else
+			ret = read_direct<_Type>(in, ptr, frames);
+		count_read(in, ret);
+		return ret;
+	}
+
+
+	// ********************************
+	// **** Get the next block of an input.  Lends out the block of the read-ahead ring
+	// **** when it is 'frames' long, else reads into 'buffer'.  'got' is the number of
+	// **** frames.  return_input() must follow before the next block is read.
+	template <typename _Type>
+	inline const dsp::sample<_Type> *dsp_split_combine::borrow_input(file_description &in, dsp::sample<_Type> *buffer, int64_t frames, int64_t &got)
+	{
+		if (!in.readahead.is_running() || in.readahead.get_block_frames() != frames)
+		{
+			got = read_input<_Type>(in, (_Type *)buffer, frames);
+			return buffer;
+		}
+
+		stage_timer t(counters.read);
+		const void *block = in.readahead.begin_read(got);
+		count_read(in, got);
+		return (block != nullptr) ? (const dsp::sample<_Type> *)block : buffer;
+	}
+
+
+	// ********************************
+	// **** Give a block lent out by borrow_input() back to the read-ahead ring.
+	void dsp_split_combine::return_input(file_description &in)
+	{
+		in.readahead.end_read();
+	}
+
+
+	// ********************************
+	// **** Read frames straight from an input file.  Uses the memory mapped reader when
+	// **** the input is uncompressed, otherwise libsndfile.
+	template <typename _Type>
+	inline int64_t dsp_split_combine::read_direct(file_description &in, _Type *ptr, int64_t frames)
+	{
+		if (frames > in.range_left)
+			frames = in.range_left;
+
+		int64_t ret;
+		if (in.mapped.is_open())
+			ret = in.mapped.read_frames<_Type>(ptr, frames);
+		else
+			ret = in.file.read_frames<_Type>(ptr, frames);
+		if (ret > 0)
+			in.range_left -= ret;
+		return ret;
+	}
+
+
+	// ********************************
+	// **** Number of frames a process reads from an input.  That is the whole file unless
+	// **** set_input_range() picked a part of it.
+	int64_t dsp_split_combine::get_range_frames(file_description &in)
+	{
+		int64_t total = in.mapped.is_open() ? in.mapped.get_frames() : in.file.get_frames();
+		int64_t frames = total - std::min(in.range_start, total);
+		if (in.range_length > 0 && in.range_length < frames)
+			frames = in.range_length;
+		return frames;
+	}
+
+
+	// ********************************
+	// **** Same as get_range_frames() but 0 for a pipe that is read until it ends.
+	int64_t dsp_split_combine::get_known_frames(file_description &in)
+	{
+		if (in.stream.is_open() && in.range_length <= 0)
+			return 0;
+		return get_range_frames(in);
+	}
+
+
+	// ********************************
+	// **** Move an input to the first frame of its range before a process reads it.
+	void dsp_split_combine::seek_input(file_description &in)
+	{
+		// A pipe can't tell how long it is.  Read it until it ends.
+		if (in.stream.is_open() && in.range_length <= 0)
+			in.range_left = INT64_MAX;
+		else
+			in.range_left = get_range_frames(in);
+
+		if (in.mapped.is_open())
+			in.mapped.seek(in.range_start, SEEK_SET);
+		else if (in.range_start > 0 && in.file.seek(in.range_start, SEEK_SET) != in.range_start)
+			in.range_left = 0;
+	}
+
+
+	// ********************************
+	// **** Start reading an input ahead of the process.  'frames' is the block size
+	// **** used by the process.  Reads go through read_input() either way.
+	template <typename _Type>
+	void dsp_split_combine::start_readahead(file_description &in, int64_t frames)
+	{
+		if (readahead_depth <= 0)
+			return;
+
+		int64_t block_frames = (readahead_frames > 0) ? readahead_frames : frames;
+		in.readahead.start(
+			[this, &in](void *buffer, int64_t count) { return read_direct<_Type>(in, (_Type *)buffer, count); },
+			(int64_t)sizeof(_Type) * in.format.get_channels(), block_frames, readahead_depth);
+	}
+
+
+	// ********************************
+	// **** Open an output file.  PCM outputs in WAV/RF64/W64/AIFF files are written by
+	// **** the native writer, everything else goes through libsndfile.
+	bool dsp_split_combine::open_output(file_description &out, int oformat, int channels, int rate)
+	{
+		out.write_error.clear();
+		if (out.stream.is_open())
+		{
+			out.file.open(out.stream.get_vio(), out.stream.get_user_data(), SFM_WRITE, oformat, channels, rate);
+			return out.file.is_open();
+		}
+
+		if (dsp::pcm_writer::is_supported(oformat) &&
+			out.writer.open(out.path.string(), oformat, channels, rate, (int64_t)out.format.get_frames(), direct_io, output_buffer))
+		{
+			if (io.is_async())
+				out.writer.set_io_engine(io);
+			return true;
+		}
+
+		// A WAV file can't hold more than 4GB.  libsndfile writes an RF64 file instead when
+		// the output is expected to be bigger and a plain WAV file if it ends up smaller.
+		bool promote = false;
+		int type = oformat & SF_FORMAT_TYPEMASK;
+		if ((type == SF_FORMAT_WAV || type == SF_FORMAT_WAVEX) &&
+			(int64_t)out.format.get_frames() * channels * get_sf_sample_bytes(oformat) > 0xFFFFFFFFll - 0x10000)
+		{
+			oformat = (oformat & ~SF_FORMAT_TYPEMASK) | SF_FORMAT_RF64;
+			promote = true;
+		}
+
+		out.file.open(out.path, SFM_WRITE, oformat, channels, rate);
+		if (promote && out.file.is_open())
+			out.file.command(SFC_RF64_AUTO_DOWNGRADE, nullptr, SF_TRUE);
+		return out.file.is_open();
+	}
+
+
+	// ********************************
+	// **** Returns true for libsndfile formats that are compressed while they are written.
+	bool dsp_split_combine::is_encoded(int sf_format)
+	{
+		switch (sf_format & SF_FORMAT_TYPEMASK)
+		{
+		case SF_FORMAT_FLAC:
+		case SF_FORMAT_OGG:
+			return true;
+		}
+		switch (sf_format & SF_FORMAT_SUBMASK)
+		{
+		case SF_FORMAT_ALAC_16:
+		case SF_FORMAT_ALAC_20:
+		case SF_FORMAT_ALAC_24:
+		case SF_FORMAT_ALAC_32:
+		case SF_FORMAT_VORBIS:
+			return true;
+		}
+		return false;
+	}
+
+
+	// ********************************
+	// **** Bytes per sample of an uncompressed libsndfile format.  0 for anything else.
+	int dsp_split_combine::get_sf_sample_bytes(int sf_format)
+	{
+		switch (sf_format & SF_FORMAT_SUBMASK)
+		{
+		case SF_FORMAT_PCM_S8:
+		case SF_FORMAT_PCM_U8:
+		case SF_FORMAT_ULAW:
+		case SF_FORMAT_ALAW:
+			return 1;
+		case SF_FORMAT_PCM_16:
+			return 2;
+		case SF_FORMAT_PCM_24:
+			return 3;
+		case SF_FORMAT_PCM_32:
+		case SF_FORMAT_FLOAT:
+			return 4;
+		case SF_FORMAT_DOUBLE:
+			return 8;
+		}
+		return 0;
+	}
+
+
+	// ********************************
+	// **** Copy bext chunk and text information to an output file.
+	void dsp_split_combine::set_output_info(file_description &out, dsp::dspbwf &bext, std::vector<SF_STRINGS_T> &strings)
+	{
+		if (out.writer.is_open())
+		{
+			out.writer.set_bext(*bext.data());
+			for (unsigned int j = 0; j < strings.size(); ++j)
+				out.writer.set_string(strings[j].id, strings[j].str.c_str());
+			return;
+		}
+
+		out.file.command(SFC_SET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
+		for (unsigned int j = 0; j < strings.size(); ++j)
+			out.file.set_string(strings[j].id, strings[j].str.c_str());
+	}
+
+
+	// ********************************
+	// **** Write frames to an output file.  Collects them in the staging buffer of the
+	// **** output when it has one.
+	template <typename _Type>
+	inline int64_t dsp_split_combine::write_output(file_description &out, const _Type *ptr, int64_t frames)
+	{
+		stage_timer t(counters.write);
+		count_write(out, frames);
+		if (out.staging.capacity() == 0)
+			return write_block<_Type>(out, ptr, frames);
+
+		size_t bytes = (size_t)(frames * sizeof(_Type) * out.format.get_channels());
+		if (out.staging.size() + bytes > out.staging.capacity() && flush_output<_Type>(out) < 0)
+			return 0;
+		if (bytes > out.staging.capacity())
+			return write_block<_Type>(out, ptr, frames);
+
+		const uint8_t *src = (const uint8_t *)ptr;
+		out.staging.insert(out.staging.end(), src, src + bytes);
+		return frames;
+	}
+
+
+	// ********************************
+	// **** Where to put the next block of an output.  Lends out a free block of the
+	// **** write-behind queue when frames go to it unstaged, else returns 'buffer'.
+	// **** put_output() must follow.  The channels of a lent block that the process
+	// **** doesn't write stay silent like those of a zeroed buffer.
+	template <typename _Type>
+	inline dsp::sample<_Type> *dsp_split_combine::borrow_output(file_description &out, dsp::sample<_Type> *buffer, int64_t frames)
+	{
+		if (!out.writebehind.is_running() || out.staging.capacity() != 0 || out.writebehind.get_block_frames() < frames)
+			return buffer;
+
+		stage_timer t(counters.write);
+		int64_t room;
+		void *block = out.writebehind.begin_write(room);
+		return (block != nullptr) ? (dsp::sample<_Type> *)block : buffer;
+	}
+
+
+	// ********************************
+	// **** Write a block from borrow_output().  A lent block is queued as it is.
+	template <typename _Type>
+	inline int64_t dsp_split_combine::put_output(file_description &out, const _Type *ptr, int64_t frames)
+	{
+		if (!out.writebehind.is_borrowed())
+			return write_output<_Type>(out, ptr, frames);
+
+		stage_timer t(counters.write);
+		count_write(out, frames);
+		return out.writebehind.end_write(frames);
+	}
+
+
+	// ********************************
+	// **** Write whatever is in the staging buffer of an output.  Returns the number of
+	// **** frames written or -1 if not all of them could be.
+	template <typename _Type>
+	int64_t dsp_split_combine::flush_output(file_description &out)
+	{
+		int64_t frames = (int64_t)(out.staging.size() / (sizeof(_Type) * out.format.get_channels()));
+		if (frames == 0)
+			return 0;
+		int64_t written = write_block<_Type>(out, (const _Type *)out.staging.data(), frames);
+		out.staging.clear();
+		return (written == frames) ? frames : -1;
+	}
+
+
+	// ********************************
+	// **** Keep the first write to 'out' that fell short so close_output() can report it.
+	void dsp_split_combine::write_failed(file_description &out)
+	{
+		if (!out.write_error.empty())
+			return;
+		out.write_error = "Could not write all frames.\n";
+		if (out.writer.is_open())
+			out.write_error += out.writer.get_error_str();
+		else
+			out.write_error += std::string(out.file.get_error_str()) + "\n";
+	}
+
+
+	// ********************************
+	// **** Write a block of frames to an output file.  Queues them for the background
+	// **** thread while write-behind is running.
+	template <typename _Type>
+	inline int64_t dsp_split_combine::write_block(file_description &out, const _Type *ptr, int64_t frames)
+	{
+		if (out.writebehind.is_running())
+			return out.writebehind.write_frames(ptr, frames);
+		return write_direct<_Type>(out, ptr, frames);
+	}
+
+
+	// ********************************
+	// **** Write frames straight to an output file.
+	template <typename _Type>
+	inline int64_t dsp_split_combine::write_direct(file_description &out, const _Type *ptr, int64_t frames)
+	{
+		if (out.writer.is_open())
+			return out.writer.write_frames<_Type>(ptr, frames);
+		return out.file.write_frames<_Type>(ptr, frames);
+	}
+
+
+	// ********************************
+	// **** Start writing an output behind the process.  'frames' is the largest block
+	// **** the process writes at once.  Writes go through write_output() either way.
+	// **** Outputs written by libsndfile collect 'output_buffer' bytes in a staging
+	// **** buffer first so the file gets a few large writes instead of a small one for
+	// **** every block.  The native writer has staging buffers of its own.
+	// ****   Compressed outputs are always written behind, even with write-behind off,
+	// **** so every encoder runs on its own thread and the process thread only reads
+	// **** and de-interleaves.
+	template <typename _Type>
+	void dsp_split_combine::start_writebehind(file_description &out, int64_t frames)
+	{
+		int64_t frame_size = (int64_t)sizeof(_Type) * out.format.get_channels();
+		int depth = writebehind_depth;
+
+		out.staging = std::vector<uint8_t>();
+		if (!out.writer.is_open() && output_buffer > frames * frame_size)
+		{
+			frames = output_buffer / frame_size;
+			out.staging.reserve((size_t)(frames * frame_size));
+
+			// One staged buffer being written while the next one fills is enough.
+			depth = std::min(depth, 1);
+		}
+
+		// Keep a second buffer queued so an encoder never waits on the process thread.
+		if (parallel_encode && out.file.is_open() && is_encoded(out.file.get_format()))
+			depth = std::max(depth, 2);
+
+		// The native writer doesn't wait on the disk when the I/O engine is asynchronous.
+		if (depth <= 0 || (out.writer.is_open() && io.is_async()))
+			return;
+
+		out.writebehind.start(
+			[this, &out](const void *buffer, int64_t count) { return write_direct<_Type>(out, (const _Type *)buffer, count); },
+			frame_size, frames, depth);
+	}
+
+
+	// ********************************
+	// **** Finish an output file.  Drains the write-behind queue and patches the header
+	// **** of a file written by the native writer.  Returns false and adds to 'msg' if
+	// **** anything could not be written.
+	bool dsp_split_combine::close_output(file_description &out, std::string &msg)
+	{
+		bool ret = true;
+		if (!out.write_error.empty())
+		{
+			msg += out.write_error;
+			out.write_error.clear();
+			ret = false;
+		}
+		if (!out.writebehind.stop())
+		{
+			msg += out.writebehind.get_error_str();
+			if (!out.writer.is_open())
+				msg += std::string(out.file.get_error_str()) + "\n";
+			ret = false;
+		}
+		if (out.writer.is_open() && !out.writer.close())
+		{
+			msg += out.writer.get_error_str();
+			ret = false;
+		}
+		if (out.stream.is_open())
+		{
+			// libsndfile writes what it still holds when it closes, then the ring goes out.
+			out.file = dsp::dspfile();
+			if (!out.stream.finish())
+			{
+				msg += "Could not write to the stream.\n";
+				ret = false;
+			}
+		}
+		return ret;
+	}
+
+
+	// ********************************
+	// **** Finish all output files and the copy outputs of a split.
+	bool dsp_split_combine::close_outputs(const char *func)
+	{
+		bool ret = true;
+		std::vector<file_description *> files;
+		for (auto &out : output)
+			files.push_back(&out);
+		for (auto &c : copies)
+			files.push_back(&c);
+		for (auto out : files)
+		{
+			std::string msg;
+			if (!close_output(*out, msg))
+			{
+				if (ret)
+					error = std::string(func) + ": Error writing output files.\n";
+				error += "\"" + out->path.string() + "\": " + msg;
+				ret = false;
+			}
+		}
+		return ret;
+	}
+
+
+	// ********************************
+	// **** Number of segments a process can cut input 'in' into.  Every segment opens the
+	// **** input again and seeks to its first frame, and every output in 'outs' must be
+	// **** written by the native writer so a segment can write its part of the file
+	// **** without waiting for the parts before it.  Returns 1 when the process has to
+	// **** run from start to end.
+	int dsp_split_combine::get_segments(file_description &in, const std::vector<int> &outs, int64_t frames)
+	{
+		if (segment_workers == 1 || in.stream.is_open() || !in.file.is_open() || get_range_frames(in) <= 0)
+			return 1;
+		for (int o : outs)
+		{
+			if (!output[o].writer.is_open())
+				return 1;
+		}
+
+		// A segment should be long enough to be worth a task.
+		int64_t most = get_range_frames(in) / (frames * 16);
+		// Files converted side by side share the workers of the pool.
+		int64_t workers = (segment_workers > 0) ? segment_workers : dsp::get_thread_pool().get_workers() / running_files;
+		return (int)std::max<int64_t>(1, std::min<int64_t>(workers, most));
+	}
+
+
+	// ********************************
+	// **** Run a process over input 'index' in 'segments' parts at once.  'routes' map the
+	// **** channels of the input to the outputs in 'outs'.  Each part is a whole number
+	// **** of blocks of 'frames' frames.
+	template <typename _TypeSrc, typename _TypeDst>
+	void dsp_split_combine::segment_template(int index, const std::vector<route_t> &routes, const std::vector<int> &outs, int64_t frames, int segments)
+	{
+		int64_t total = get_range_frames(input[index]);
+		for (int o : outs)
+		{
+			if (!output[o].writer.set_frames(total))
+				output[o].writer.fail("Could not set the length of the file.\n");
+		}
+
+		int64_t step = (total + segments - 1) / segments;
+		step = ((step + frames - 1) / frames) * frames;
+
+		// The segments run on the thread pool.  This thread runs whatever segments no
+		// worker took while it waits.
+		dsp::task_group segs;
+		for (int64_t start = 0; start < total; start += step)
+		{
+			int64_t count = std::min(step, total - start);
+			segs.run([this, index, &routes, &outs, start, count, frames] {
+				segment_worker<_TypeSrc, _TypeDst>(index, routes, outs, start, count, frames);
+			});
+		}
+		segs.wait();
+	}
+
+
+	// ********************************
+	// **** Process 'count' frames of input 'index' starting at frame 'start'.  Reads
+	// **** through handles of its own so it shares nothing with the other segments.
+	template <typename _TypeSrc, typename _TypeDst>
+	void dsp_split_combine::segment_worker(int index, const std::vector<route_t> &routes, const std::vector<int> &outs, int64_t start, int64_t count, int64_t frames)
+	{
+		file_description &in = input[index];
+		int channels = in.format.get_channels();
+
+		file_description seg(in.path, in.format);
+		seg.file.open(in.path.string(), SFM_READ);
+		if (in.mapped.is_open())
+		{
+			seg.mapped.open(
+				in.path.string(), in.mapped.get_data_offset(), in.mapped.get_frames() * in.mapped.get_sizeof_frame(),
+				channels, in.mapped.get_bytes_per_sample() * 8, in.mapped.is_float(), in.mapped.is_big_endian(), direct_io);
+		}
+
+		// 'start' counts from the first frame of the range.
+		int64_t first = in.range_start + start;
+		int64_t pos = -1;
+		if (seg.mapped.is_open())
+			pos = seg.mapped.seek(first, SEEK_SET);
+		else if (seg.file.is_open())
+			pos = seg.file.seek(first, SEEK_SET);
+
+		dsp::dspvector<_TypeSrc> inbuffer((int)(frames * channels));
+		std::vector<dsp::dspvector<_TypeDst>> outbuffers(output.size());
+		for (int o : outs)
+		{
+			outbuffers[o].resize((int)(frames * output[o].format.get_channels()));
+			outbuffers[o].zero();	// Output channels without a route stay silent.
+		}
+		std::vector<uint8_t> scratch;
+
+		int64_t held = (int64_t)(inbuffer.size() * sizeof(_TypeSrc));
+		for (auto &b : outbuffers)
+			held += (int64_t)(b.size() * sizeof(_TypeDst));
+		use_buffers(held);
+
+		bool ok = (pos == first);
+		while (ok && count > 0)
+		{
+			int64_t n = std::min(frames, count);
+			{
+				stage_timer t(counters.read);
+				ok = (read_direct<_TypeSrc>(seg, (_TypeSrc*)inbuffer.data(), n) == n);
+			}
+			if (!ok)
+				break;
+			count_read(in, n);
+			++counters.blocks;
+
+			stage_timer transpose(counters.transpose);
+			for (auto &r : routes)
+			{
+				dsp::copy_channel(
+					inbuffer.data() + r.src_ch, channels,
+					outbuffers[r.dst_file].data() + r.dst_ch, output[r.dst_file].format.get_channels(),
+					n);
+			}
+			transpose.stop();
+
+			stage_timer write(counters.write);
+			for (int o : outs)
+			{
+				ok = (output[o].writer.write_frames_at<_TypeDst>(start, (_TypeDst*)outbuffers[o].data(), n, scratch) == n) && ok;
+				count_write(output[o], n);
+			}
+			write.stop();
+
+			start += n;
+			count -= n;
+			if (!step_progress(n))
+				break;
+		}
+
+		use_buffers(-held);
+
+		// Reported when the outputs are closed.
+		if (count > 0 && !cancel_flag)
+		{
+			for (int o : outs)
+				output[o].writer.fail("Could not process frames " + std::to_string(start) + " to " + std::to_string(start + count) + ".\n");
+		}
+	}
+
+
+	// ********************************
+	// **** A private template function used to run the actual split.
+	template <typename _TypeSrc, typename _TypeDst>
+	void dsp_split_combine::split_template()
+	{
+		// Get number of frames to read each round.  And number of channels.
+		int channels = input[0].format.get_channels();
+		int num_outputs = (int)output.size();
+		int64_t out_channels = 0;
+		for (auto &out : output)
+			out_channels += out.format.get_channels();
+
+		// Copy outputs are written straight from the input buffer and taps get it as floats.
+		int64_t fanout_bytes = (int64_t)(sizeof(_TypeSrc) * channels * copies.size());
+		if (has_taps())
+			fanout_bytes += (int64_t)(sizeof(float) * channels);
+		int64_t frames = pick_block_frames(sizeof(_TypeSrc) * channels, sizeof(_TypeDst) * out_channels + fanout_bytes);
+
+		seek_input(input[0]);
+
+		std::vector<int> outs;
+		for (int i = 0; i < num_outputs; ++i)
+			outs.push_back(i);
+
+		// Wait for or shrink to what the memory budget allows.
+		dsp::memory_budget::lease mem;
+		frames = fit_budget(mem, frames, sizeof(_TypeSrc) * channels, sizeof(_TypeDst) * out_channels + fanout_bytes, outs, true);
+		if (frames <= 0)
+			return;
+
+		// Long inputs are cut into segments that run side by side.  Each has blocks of
+		// its own, so no more than the lease holds.  Copies and taps need the blocks in
+		// order.
+		int segments = has_fanout() ? 1 : get_segments(input[0], outs, frames);
+		segments = (int)std::min<int64_t>(segments, std::max<int64_t>(1, mem.get_bytes() / (frames * (sizeof(_TypeSrc) * channels + sizeof(_TypeDst) * out_channels))));
+		if (segments > 1)
+		{
+			segment_template<_TypeSrc, _TypeDst>(0, active_routes, outs, frames, segments);
+			return;
+		}
+
+		// Main buffer and one interleaved buffer for each output file.
+		dsp::dspvector<_TypeSrc> inbuffer((int)(frames * channels));
+		std::vector<dsp::dspvector<_TypeDst>> outbuffers(num_outputs);
+		for (int i = 0; i < num_outputs; ++i)
+		{
+			outbuffers[i].resize((int)(frames * output[i].format.get_channels()));
+			outbuffers[i].zero();	// Output channels without a route stay silent.
+			start_writebehind<_TypeDst>(output[i], frames);
+		}
+		for (auto &c : copies)
+			start_writebehind<_TypeSrc>(c, frames);
+		dsp::dspvector<float> tapbuffer;
+		if (has_taps())
+			tapbuffer.resize((int)(frames * channels));
+
+		// Start reading ahead of the loop.
+		start_readahead<_TypeSrc>(input[0], frames);
+
+		int64_t held = (int64_t)(inbuffer.size() * sizeof(_TypeSrc) + tapbuffer.size() * sizeof(float)) + get_buffer_bytes(input[0]);
+		for (int i = 0; i < num_outputs; ++i)
+			held += (int64_t)(outbuffers[i].size() * sizeof(_TypeDst)) + get_buffer_bytes(output[i]);
+		for (auto &c : copies)
+			held += get_buffer_bytes(c);
+		use_buffers(held);
+
+		// Main loop:
+		std::vector<dsp::sample<_TypeDst> *> dst(num_outputs);
+		int64_t rframes;
+		do
+		{
+			// Read input.  The block of the read-ahead ring is used in place when it can be.
+			const dsp::sample<_TypeSrc> *src = borrow_input<_TypeSrc>(input[0], inbuffer.data(), frames, rframes);
+			if (rframes <= 0)
+			{
+				return_input(input[0]);
+				break;
+			}
+			++counters.blocks;
+
+			// Outputs written behind get the channels straight into a block of their queue.
+			for (int i = 0; i < num_outputs; ++i)
+				dst[i] = borrow_output<_TypeDst>(output[i], outbuffers[i].data(), frames);
+
+			// Convert and de-interleave only the channels that are routed somewhere.
+			stage_timer transpose(counters.transpose);
+			for (auto &r : active_routes)
+			{
+				dsp::copy_channel(
+					src + r.src_ch, channels,
+					dst[r.dst_file] + r.dst_ch, output[r.dst_file].format.get_channels(),
+					rframes);
+			}
+			transpose.stop();
+
+			// Every tap sees the block as floats.
+			if (has_taps())
+			{
+				stage_timer convert(counters.convert);
+				dsp::copy_channel(src, 1, tapbuffer.data(), 1, rframes * channels);
+				feed_taps((const float*)tapbuffer.data(), channels, rframes);
+			}
+
+			// Write output.  Failures are reported when the outputs are closed.
+			for (int i = 0; i < num_outputs; ++i)
+			{
+				if (put_output<_TypeDst>(output[i], (const _TypeDst*)dst[i], rframes) != rframes)
+					write_failed(output[i]);
+			}
+			for (auto &c : copies)
+			{
+				if (write_output<_TypeSrc>(c, (const _TypeSrc*)src, rframes) != rframes)
+					write_failed(c);
+			}
+			return_input(input[0]);
+
+			// Send every write queued for this block to the kernel at once.
+			stage_timer write(counters.write);
+			io.submit();
+			write.stop();
+
+			if (!step_progress(rframes))
+				break;
+
+		} while (rframes == frames);
+
+		stage_timer write(counters.write);
+		for (auto &out : output)
+		{
+			if (flush_output<_TypeDst>(out) < 0)
+				write_failed(out);
+		}
+		for (auto &c : copies)
+		{
+			if (flush_output<_TypeSrc>(c) < 0)
+				write_failed(c);
+		}
+		write.stop();
+
+		input[0].readahead.stop();
+		use_buffers(-held);
+	}
+
+
+	// ********************************
+	// **** Returns true when split doesn't need to convert anything.  That is when the
+	// **** input is memory mapped and every output is written by the native writer with
+	// **** the same sample size, type and byte order as the input, and the split has no
+	// **** other sinks that need the samples decoded.
+	bool dsp_split_combine::can_split_raw()
+	{
+		dsp::mapped_pcm_reader &in = input[0].mapped;
+		if (!in.is_open() || output.empty() || has_fanout())
+			return false;
+
+		for (auto &out : output)
+		{
+			if (!out.writer.is_open() ||
+				out.writer.get_bytes_per_sample() != in.get_bytes_per_sample() ||
+				out.writer.is_float() != in.is_float() ||
+				out.writer.is_big_endian() != in.is_big_endian())
+				return false;
+		}
+		return true;
+	}
+
+
+	// ********************************
+	// **** Split without converting.  Each routed channel is copied byte for byte from
+	// **** the memory mapped input straight into the staging buffer of its output, so
+	// **** the outputs are bit identical to the input.
+	void dsp_split_combine::split_raw()
+	{
+		dsp::mapped_pcm_reader &in = input[0].mapped;
+		int64_t bytes = in.get_bytes_per_sample();
+		int64_t src_stride = in.get_sizeof_frame();
+		int num_outputs = (int)output.size();
+		int64_t out_channels = 0;
+		for (auto &out : output)
+			out_channels += out.format.get_channels();
+		int64_t frames = pick_block_frames(src_stride, bytes * out_channels);
+
+		// Nothing grows with the block size but the staging buffers of the outputs count.
+		std::vector<int> outs;
+		for (int i = 0; i < num_outputs; ++i)
+			outs.push_back(i);
+		dsp::memory_budget::lease mem;
+		if (fit_budget(mem, frames, 0, 0, outs) <= 0)
+			return;
+
+		// Routes for each output.
+		std::vector<std::vector<route_t>> out_routes(num_outputs);
+		for (auto &r : active_routes)
+			out_routes[r.dst_file].push_back(r);
+
+		int64_t held = 0;
+		for (auto &out : output)
+			held += get_buffer_bytes(out);
+		use_buffers(held);
+
+		seek_input(input[0]);
+		int64_t pos = in.tell();
+		int64_t end = pos + input[0].range_left;
+		while (pos < end)
+		{
+			int64_t n = std::min(frames, end - pos);
+			stage_timer read(counters.read);
+			const uint8_t *src = in.raw(pos, n);
+			read.stop();
+			if (src == nullptr)
+				break;
+			count_read(input[0], n);
+			++counters.blocks;
+
+			// Copying straight into the staging buffers of the outputs is the transpose.
+			stage_timer transpose(counters.transpose);
+			for (int i = 0; i < num_outputs; ++i)
+			{
+				int channels = output[i].format.get_channels();
+				int64_t dst_stride = bytes * channels;
+				for (int64_t done = 0; done < n;)
+				{
+					int64_t count = n - done;
+					uint8_t *dst = output[i].writer.reserve(count);
+					if (dst == nullptr)
+						break;	// Reported when the output is closed.
+
+					// Output channels without a route stay silent.
+					if ((int)out_routes[i].size() < channels)
+						std::memset(dst, 0, (size_t)(count * dst_stride));
+
+					for (auto &r : out_routes[i])
+					{
+						dsp::copy_channel_bytes(
+							src + done * src_stride + r.src_ch * bytes, src_stride,
+							dst + r.dst_ch * bytes, dst_stride,
+							(int)bytes, count);
+					}
+					output[i].writer.commit(count);
+					done += count;
+				}
+				count_write(output[i], n);
+			}
+			transpose.stop();
+
+			// Send every write queued for this block to the kernel at once.
+			stage_timer write(counters.write);
+			io.submit();
+			write.stop();
+
+			pos += n;
+			in.seek(pos, SEEK_SET);
+			if (!step_progress(n))
+				break;
+		}
+		use_buffers(-held);
+	}
+
+
+	// ********************************
+	// **** Template for the combine process.
+	template <typename _TypeSrc, typename _TypeDst>
+	void dsp_split_combine::combine_template()
+	{
+		// Get number of frames to read each round, number of channels etc...
+		bool done = false;
+		int i;
+		int64_t rframes, maxframes = 0;
+		int num_inputs = (int)input.size();
+		int channels = output[0].format.get_channels();
+
+		// Only inputs that are used by the routing map get read.
+		std::vector<bool> used(num_inputs, false);
+		for (auto &r : active_routes)
+			used[r.src_file] = true;
+
+		int64_t in_channels = 0;
+		for (i = 0; i < num_inputs; ++i)
+		{
+			if (used[i])
+				in_channels += input[i].format.get_channels();
+		}
+		int64_t frames = pick_block_frames(sizeof(_TypeSrc) * in_channels, sizeof(_TypeDst) * channels);
+
+		// Wait for or shrink to what the memory budget allows.
+		dsp::memory_budget::lease mem;
+		frames = fit_budget(mem, frames, sizeof(_TypeSrc) * in_channels, sizeof(_TypeDst) * channels, std::vector<int>(1, 0));
+		if (frames <= 0)
+			return;
+
+		// Create input buffers.
+		std::vector<dsp::dspvector<_TypeSrc>> inbuffers(num_inputs);
+		for (i = 0; i < num_inputs; ++i)
+		{
+			if (used[i])
+				inbuffers[i].resize((int)(frames * input[i].format.get_channels()));
+		}
 
-			// Calculate number of output channels
-			for (i = 0; i < num_inputs; ++i)
+		// Create the interleaved output buffer.  Output channels without a route stay silent.
+		dsp::dspvector<_TypeDst> outbuffer((int)(frames * channels));
+		outbuffer.zero();
+		start_writebehind<_TypeDst>(output[0], frames);
+
+		// Start reading ahead on every input that is used.
+		int64_t held = (int64_t)(outbuffer.size() * sizeof(_TypeDst)) + get_buffer_bytes(output[0]);
+		for (i = 0; i < num_inputs; ++i)
+		{
+			if (used[i])
 			{
-				int c = input[i].format.get_channels();
-				inbuffers[i].resize(frames * c);
-				midbuffers[i].resize(frames * c);
+				seek_input(input[i]);
+				start_readahead<_TypeSrc>(input[i], frames);
+				held += (int64_t)(inbuffers[i].size() * sizeof(_TypeSrc)) + get_buffer_bytes(input[i]);
 			}
+		}
+		use_buffers(held);
 
-			// Create output buffers.  We need two, one for building the deinterlaced.
-			dsp::dspvector<_TypeDst> midoutbuffer(frames * channels);
-			dsp::dspvector<_TypeDst> outbuffer(frames * channels);
-			dsp::transpose_to interleave(frames, channels, dsp::interleave);
-
-			// Setup some values.
-			int cur_channels = 0, bufsize = frames * channels;
+		// Run loop.
+		while (!done)
+		{
+			done = true;
+			maxframes = 0;
 
-			// Do the confusing process of combining multiple audio channels/files into one.
-			while (!done)
+			for (i = 0; i < num_inputs; ++i)
 			{
-				cur_c = 0;		// Current channel for output location calculation.
-				done = true;	// Default to true for each pass.
-				maxframes = 0;
+				if (!used[i])
+					continue;
 
-				for (i = 0; i < num_inputs; ++i)
-				{
-					cur_channels = input[i].format.get_channels();
+				int c = input[i].format.get_channels();
 
-					// Read in frames.
-					if ((rframes = (int)input[i].file.read_frames<_TypeDst>((_TypeDst*)inbuffers[i].data(), frames)) == frames)
-						done = false;
+				// Read in buffer.
+				if ((rframes = read_input<_TypeSrc>(input[i], (_TypeSrc*)inbuffers[i].data(), frames)) == frames)
+					done = false;
+				if (rframes < 0)
+					rframes = 0;
 
-					// If we read any frames...
-					if (rframes > maxframes)
-						maxframes = rframes;
+				// Zero out end of buffer if necessary.
+				stage_timer transpose(counters.transpose);
+				for (int64_t x = rframes * c; x < frames * c; ++x)
+					inbuffers[i][x] = dsp::sample_traits<_TypeSrc>::zero();
 
-					if (cur_channels == 1)
-					{
-						// Zero out extra samples.
-						for (int x = rframes * cur_channels; x < frames * cur_channels; ++x)
-							inbuffers[i][x] = dsp::sample_traits<_TypeDst>::zero();
+				// Set max frames.
+				if (rframes > maxframes)
+					maxframes = rframes;
 
-						std::copy(inbuffers[i].cbegin(), inbuffers[i].cend(), midoutbuffer.begin() + (frames * cur_c));
-						++cur_c;
-					} // if (cur_channels == 1)
-					else
-					{
-						dsp::transpose_to deinterleave(frames, cur_channels, dsp::deinterleave);
+			} // for (i = 0; i < num_inputs; ++i)
 
-						// Zero out extra samples.
-						for (int x = rframes * cur_channels; x < frames * cur_channels; ++x)
-							inbuffers[i][x] = dsp::sample_traits<_TypeDst>::zero();
+			if (maxframes)
+			{
+				++counters.blocks;
 
-						// De-interleave this files samples.
-						deinterleave(inbuffers[i], midbuffers[i]);
+				// Copy every routed channel straight into its place in the interleaved output,
+				// which is a block of the write-behind queue when there is one.
+				dsp::sample<_TypeDst> *dst = borrow_output<_TypeDst>(output[0], outbuffer.data(), frames);
+				stage_timer transpose(counters.transpose);
+				for (auto &r : active_routes)
+				{
+					dsp::copy_channel(
+						inbuffers[r.src_file].data() + r.src_ch, input[r.src_file].format.get_channels(),
+						dst + r.dst_ch, channels,
+						maxframes);
+				}
+				transpose.stop();
 
-						// Copy the samples to the output buffer.
-						std::copy(inbuffers[i].cbegin(), inbuffers[i].cend(), midoutbuffer.begin() + (frames * cur_c));
-						cur_c += cur_channels;
+				// And write to output file.
+				if (put_output<_TypeDst>(output[0], (const _TypeDst*)dst, maxframes) != maxframes)
+					write_failed(output[0]);
+				stage_timer write(counters.write);
+				io.submit();
+				write.stop();
 
-					} // if (cur_channels == 1) else
-				} // for (i = 0; i < num_inputs; ++i)
+				if (!step_progress(maxframes))
+					break;
 
-				if (maxframes)
-				{
-					// Finally, transpose input buffer to output buffer.
-					interleave(midoutbuffer, outbuffer);
+			} // if (maxframes)
+		} // while (!done)
 
-					// And write to output file.
-					output[0].file.write_frames<_TypeDst>((_TypeDst*)outbuffer.data(), maxframes);
+		stage_timer write(counters.write);
+		if (flush_output<_TypeDst>(output[0]) < 0)
+			write_failed(output[0]);
+		write.stop();
 
-				} // if (maxframes)
-			} // while (!done)
-		} // if (do_complex_method)
+		for (i = 0; i < num_inputs; ++i)
+			input[i].readahead.stop();
+		use_buffers(-held);
 	}
 
 
@@ -397,34 +2176,87 @@ namespace dsp
 	void dsp_split_combine::convert_template(int index)
 	{
 		// Get number of frames to read each round.  And number of channels.
-		int frames = get_buffer_length<_TypeDst>();
 		int channels = input[index].format.get_channels();
-
-		// Main buffer.
-		dsp::dspvector<_TypeSrc> inbuffer(frames * channels);
-		dsp::dspvector<_TypeDst> outbuffer(frames * channels);
-
-		// Main loop:
-		int rframes;
-		while ((rframes = (int)input[index].file.read_frames<_TypeSrc>((_TypeSrc*)inbuffer.data(), frames)) == frames)
+		int64_t frames = pick_block_frames(sizeof(_TypeSrc) * channels, sizeof(_TypeDst) * channels);
+
+		seek_input(input[index]);
+
+		// Wait for or shrink to what the memory budget allows.
+		std::vector<int> outs(1, index);
+		dsp::memory_budget::lease mem;
+		frames = fit_budget(mem, frames, sizeof(_TypeSrc) * channels, sizeof(_TypeDst) * channels, outs);
+		if (frames <= 0)
+			return;
+
+		// Long inputs are cut into segments that run side by side.  Each has blocks of
+		// its own, so no more than the lease holds.
+		int segments = get_segments(input[index], outs, frames);
+		segments = (int)std::min<int64_t>(segments, std::max<int64_t>(1, mem.get_bytes() / (frames * (sizeof(_TypeSrc) + sizeof(_TypeDst)) * channels)));
+		if (segments > 1)
 		{
-			outbuffer = inbuffer;
-			output[index].file.write_frames<_TypeDst>((_TypeDst*)outbuffer.data(), rframes);
+			std::vector<route_t> routes;
+			for (int c = 0; c < channels; ++c)
+				routes.emplace_back(index, c, index, c);
+			segment_template<_TypeSrc, _TypeDst>(index, routes, outs, frames, segments);
+			return;
 		}
 
-		// Handle leftovers...
-		if (rframes > 0)
+		// Main buffer.
+		dsp::dspvector<_TypeSrc> inbuffer((int)(frames * channels));
+		dsp::dspvector<_TypeDst> outbuffer((int)(frames * channels));
+
+		// Start reading ahead of and writing behind the loop.
+		start_readahead<_TypeSrc>(input[index], frames);
+		start_writebehind<_TypeDst>(output[index], frames);
+
+		int64_t held =
+			(int64_t)(inbuffer.size() * sizeof(_TypeSrc) + outbuffer.size() * sizeof(_TypeDst)) +
+			get_buffer_bytes(input[index]) + get_buffer_bytes(output[index]);
+		use_buffers(held);
+
+		// Main loop.  Converts straight from the read-ahead block into the write-behind
+		// block when both are there.
+		int64_t rframes;
+		do
 		{
-			outbuffer = inbuffer;
-			output[index].file.write_frames<_TypeDst>((_TypeDst*)outbuffer.data(), rframes);
-		}
+			const dsp::sample<_TypeSrc> *src = borrow_input<_TypeSrc>(input[index], inbuffer.data(), frames, rframes);
+			if (rframes <= 0)
+			{
+				return_input(input[index]);
+				break;
+			}
+			++counters.blocks;
+
+			dsp::sample<_TypeDst> *dst = borrow_output<_TypeDst>(output[index], outbuffer.data(), frames);
+			stage_timer convert(counters.convert);
+			dsp::copy_channel(src, 1, dst, 1, rframes * channels);
+			convert.stop();
+			return_input(input[index]);
+
+			if (put_output<_TypeDst>(output[index], (const _TypeDst*)dst, rframes) != rframes)
+				write_failed(output[index]);
+			stage_timer write(counters.write);
+			io.submit();
+			write.stop();
+			if (!step_progress(rframes))
+				break;
+
+		} while (rframes == frames);
+		stage_timer write(counters.write);
+		if (flush_output<_TypeDst>(output[index]) < 0)
+			write_failed(output[index]);
+		write.stop();
+
+		input[index].readahead.stop();
+		use_buffers(-held);
 	}
 	// ********************************
 
 
 	// ********************************
-	// **** Used to modifie a path to add " (chX)" into the name.
-	std::sys::path dsp_split_combine::name_output_split(std::sys::path p, int ch)
+	// **** Used to modifie a path to add " (chX)" into the name, or " (chX-Y)" when
+	// **** the file holds a group of channels.
+	std::sys::path dsp_split_combine::name_output_split(std::sys::path p, int ch, int last_ch)
 	{
 #if 0//_MSC_VER >= 1900
 		std::string name = "\\" + p.stem().string();// p.basename();
@@ -435,7 +2267,10 @@ namespace dsp
 #endif
 		p.remove_filename();
 		std::string nname = p.string();
-		nname += name + " (ch" + std::to_string(ch) + ")" + ext;
+		if (last_ch > ch)
+			nname += name + " (ch" + std::to_string(ch) + "-" + std::to_string(last_ch) + ")" + ext;
+		else
+			nname += name + " (ch" + std::to_string(ch) + ")" + ext;
 		p = nname;
 		return p;
 	}
@@ -445,19 +2280,41 @@ namespace dsp
 
 	// ********************************
 	// **** Split process.
-	bool dsp_split_combine::do_split()
+	bool dsp_split_combine::do_split() { return run_split("do_split()", true); }
+
+
+	// ********************************
+	// **** Fan-out process.  A split that feeds copies and taps, with or without split
+	// **** outputs.
+	bool dsp_split_combine::do_fanout()
+	{
+		bool split_outputs = !output.empty() || !routes.empty() || !split_layout.empty();
+		if (!split_outputs && !has_fanout())
+		{
+			error = "do_fanout(): No outputs, copies or taps to feed.\n";
+			return false;
+		}
+		return run_split("do_fanout()", split_outputs);
+	}
+
+
+	// ********************************
+	// **** Read the first input once and feed the split outputs, copies and taps.
+	bool dsp_split_combine::run_split(const char *func, bool split_outputs)
 	{
+		process_timer timer(counters);
+
 		// Sanity check.
 		if (input.size() < 1)
 		{
-			error = "do_split(): Input file name not set.";
+			error = std::string(func) + ": Input file name not set.";
 			return false;
 		}
 
 		// Open input.
 		if (!input[0].file.is_open())
 		{
-			error = "do_split(): Input file not opened.  ";
+			error = std::string(func) + ": Input file not opened.  ";
 			error += input[0].file.get_error_string();
 			return false;
 		}
@@ -466,9 +2323,53 @@ namespace dsp
 		unsigned int in_channels = input[0].file.get_channels();
 		out_format.set_channels(1);
 
+		// Set up the routing map.  By default every channel goes to its own mono file
+		// unless a channel grouping layout was given.  A fan-out without split outputs
+		// routes nothing.
+		active_routes = routes;
+		if (active_routes.empty() && split_outputs)
+		{
+			if (split_layout.empty())
+			{
+				for (unsigned int i = 0; i < in_channels; ++i)
+					active_routes.emplace_back(0, i, i, 0);
+			}
+			else
+			{
+				// Consecutive channels go to the same file.  Every channel has to be in a group.
+				int ch = 0;
+				for (int g = 0; g < (int)split_layout.size(); ++g)
+				{
+					for (int c = 0; c < split_layout[g]; ++c)
+						active_routes.emplace_back(0, ch++, g, c);
+				}
+				if (ch != (int)in_channels)
+				{
+					error = std::string(func) + ": The split layout has " + std::to_string(ch) +
+						" channels but the input has " + std::to_string(in_channels) + ".\n";
+					return false;
+				}
+			}
+		}
+
+		int num_outputs = split_outputs ? check_routes(func) : 0;
+		if (num_outputs < 0)
+			return false;
+
+		for (auto &r : active_routes)
+		{
+			if (r.src_file != 0)
+			{
+				error = std::string(func) + ": Routes can only use the first input file.\n";
+				return false;
+			}
+		}
+
 		// Get bext chunk information.
+		stage_timer metadata(counters.metadata);
 		dsp::dspbwf bext;
-		input[0].file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
+		if (input[0].file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO)))
+			bext.set_time_reference(bext.get_time_reference() + input[0].range_start);
 
 		// Get text information.
 		std::vector<SF_STRINGS_T> strings;
@@ -480,139 +2381,206 @@ namespace dsp
 		}
 
 		// Set up output file names.
-		if (output.size() != in_channels)
+		if ((int)output.size() != num_outputs)
 		{
 			// Start clean.
 			output.clear();
 
-			// Set base name, and extension.
-			for (unsigned int i = 0; i < in_channels; ++i)
+			// Set base name, and extension.  Files are named after the input channels
+			// in their first and last channel.
+			for (int i = 0; i < num_outputs; ++i)
 			{
-				output.emplace_back(name_output_split(input[0].path, i + 1), out_format);
+				int first = i, last = i, last_dst = -1;
+				for (auto &r : active_routes)
+				{
+					if (r.dst_file != i)
+						continue;
+					if (r.dst_ch == 0)
+						first = r.src_ch;
+					if (r.dst_ch > last_dst)
+					{
+						last_dst = r.dst_ch;
+						last = r.src_ch;
+					}
+				}
+				output.emplace_back(name_output_split(input[0].path, first + 1, last + 1), out_format);
 			}
 		}
 
-		// Open output files.
-		for (unsigned int i = 0; i < output.size(); ++i)
+		// Skip the split when the job cache says its outputs are up to date.  Taps need
+		// the samples, so a split with taps always runs.
+		std::vector<file_description *> outs;
+		for (auto &out : output)
+			outs.push_back(&out);
+		for (auto &c : copies)
+			outs.push_back(&c);
+		std::string job, signature;
+		bool cached = !has_taps() && get_job_signature("split", { &input[0] }, outs, active_routes, job, signature);
+		if (cached && done_jobs.is_done(job, signature))
 		{
-			if (output[i].format.get_rate() == 0)
-				output[i].format.set_rate(input[0].format.get_rate());
+			++counters.jobs_skipped;
+			start_progress(get_known_frames(input[0]));
+			step_progress(get_known_frames(input[0]));
+			return true;
+		}
 
-			if (output[i].format.get_bits() == 0)
+		// Open output files.  Split outputs get the routed channels, copies all of them.
+		auto open = [&](file_description &out, int channels)
+		{
+			if (out.format.get_rate() == 0)
+				out.format.set_rate(input[0].format.get_rate());
+
+			if (out.format.get_bits() == 0)
 			{
-				output[i].format.set_bits(input[0].format.get_bits());
-				output[i].format.set_float(input[0].format.is_floats());
-				output[i].format.set_interleaved(input[0].format.is_interleaved());
+				out.format.set_bits(input[0].format.get_bits());
+				out.format.set_float(input[0].format.is_floats());
+				out.format.set_interleaved(input[0].format.is_interleaved());
 			}
 
-			if (output[i].format.get_frames() == 0)
-				output[i].format.set_frames(input[0].format.get_frames());
-			output[i].format.set_channels(1);
+			if (out.format.get_frames() == 0)
+				out.format.set_frames(get_range_frames(input[0]));
+			out.format.set_channels(channels);
 
 #if 0//_MSC_VER >= 1900
-			int oformat = output[i].file.get_good_sf_format(output[i].path.extension().string(), output[i].format);//, out_sf_format);
+			int oformat = out.file.get_good_sf_format(out.path.extension().string(), out.format);//, out_sf_format);
 #else
-			int oformat = output[i].file.get_good_sf_format(output[i].path.extension(), output[i].format);//, out_sf_format);
+			int oformat = out.file.get_good_sf_format(out.path.extension(), out.format);//, out_sf_format);
 #endif
-			output[i].file.open(
-				output[i].path, SFM_WRITE,
-				oformat, 1, output[i].format.get_rate());
-
-			if (!output[i].file.is_open())
+			if (!open_output(out, oformat, out.format.get_channels(), out.format.get_rate()))
 			{
-				error = "do_split(): Could not open output file \"";
-				error += output[i].path.string();
+				error = std::string(func) + ": Could not open output file \"";
+				error += out.path.string();
 				error += "\".\n";
-				error += output[i].file.get_error_str();
+				error += out.file.get_error_str();
 				return false;
 			}
-		}
-
-		// Set information in output files.
+			return true;
+		};
 		for (unsigned int i = 0; i < output.size(); ++i)
 		{
-			// Set bext chunk information for output files.
-			output[i].file.command(SFC_SET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
-
-			// Set text information.
-			for (unsigned int j = 0; j < strings.size(); ++j)
-				output[i].file.set_string(strings[j].id, strings[j].str.c_str());
+			if (!open(output[i], get_route_channels(i)))
+				return false;
+		}
+		for (auto &c : copies)
+		{
+			if (!open(c, in_channels))
+				return false;
 		}
 
-		// Do the process.
-		switch ((input[0].format.get_bits() + 7) / 8)
+		// Set bext chunk and text information in output files.
+		for (unsigned int i = 0; i < output.size(); ++i)
+			set_output_info(output[i], bext, strings);
+		for (auto &c : copies)
+			set_output_info(c, bext, strings);
+		metadata.stop();
+
+		if (measure_levels)
+			levels.reset(in_channels);
+		start_progress(get_known_frames(input[0]));
+
+		// Without split outputs the samples are processed in the format of the input.
+		const dsp::dspformat &dst = output.empty() ? input[0].format : output[0].format;
+
+		// Do the process.  Outputs in the same sample format as the input are split
+		// byte for byte without converting anything.
+		if (can_split_raw())
+			split_raw();
+		else
 		{
-		case 1:
-			if (!output[0].format.is_floats())
-				split_template<int8_t, int8_t>();
-			else
+			switch ((input[0].format.get_bits() + 7) / 8)
 			{
-				if (output[0].format.get_bits() <= 32)
-					split_template<int8_t, float>();
-				else
-					split_template<int8_t, double>();
-			}
-			break;
-		case 2:
-			if (!output[0].format.is_floats())
-				split_template<int16_t, int16_t>();
-			else
-			{
-				if (output[0].format.get_bits() <= 32)
-					split_template<int16_t, float>();
+			case 1:
+				if (!dst.is_floats())
+					split_template<int8_t, int8_t>();
 				else
-					split_template<int16_t, double>();
-			}
-			break;
-		case 3:
-			if (!output[0].format.is_floats())
-				split_template<int32_t, int32_t>();
-			else
-			{
-				if (output[0].format.get_bits() <= 32)
-					split_template<int32_t, float>();
+				{
+					if (dst.get_bits() <= 32)
+						split_template<int8_t, float>();
+					else
+						split_template<int8_t, double>();
+				}
+				break;
+			case 2:
+				if (!dst.is_floats())
+					split_template<int16_t, int16_t>();
 				else
-					split_template<int32_t, double>();
-			}
-			break;
-		case 4:
-			if (!input[0].format.is_floats())
-			{
-				if (!output[0].format.is_floats())
+				{
+					if (dst.get_bits() <= 32)
+						split_template<int16_t, float>();
+					else
+						split_template<int16_t, double>();
+				}
+				break;
+			case 3:
+				if (!dst.is_floats())
 					split_template<int32_t, int32_t>();
 				else
 				{
-					if (output[0].format.get_bits() <= 32)
+					if (dst.get_bits() <= 32)
 						split_template<int32_t, float>();
 					else
 						split_template<int32_t, double>();
 				}
-			}
-			else
-			{
-				if (output[0].format.get_bits() <= 32)
-					split_template<float, float>();
-				else
-					split_template<float, double>();
-			}
-			break;
-		case 8:
-		default:
-			if (!input[0].format.is_floats())
-			{
-				if (!output[0].format.is_floats())
-					split_template<int64_t, int64_t>();
+				break;
+			case 4:
+				if (!input[0].format.is_floats())
+				{
+					if (!dst.is_floats())
+						split_template<int32_t, int32_t>();
+					else
+					{
+						if (dst.get_bits() <= 32)
+							split_template<int32_t, float>();
+						else
+							split_template<int32_t, double>();
+					}
+				}
 				else
 				{
-					if (output[0].format.get_bits() <= 32)
-						split_template<int64_t, float>();
+					if (dst.get_bits() <= 32)
+						split_template<float, float>();
+					else
+						split_template<float, double>();
+				}
+				break;
+			case 8:
+			default:
+				if (!input[0].format.is_floats())
+				{
+					if (!dst.is_floats())
+						split_template<int64_t, int64_t>();
 					else
-						split_template<int64_t, double>();
+					{
+						if (dst.get_bits() <= 32)
+							split_template<int64_t, float>();
+						else
+							split_template<int64_t, double>();
+					}
 				}
+				else
+					split_template<double, double>();
+				break;
 			}
-			else
-				split_template<double, double>();
-			break;
+		}
+
+		// Finish the output files.  A cancelled split leaves them short.
+		stage_timer write(counters.write);
+		bool closed = close_outputs(func);
+		write.stop();
+		if (!closed || cancel_flag)
+		{
+			if (cached)
+				done_jobs.forget(job);
+			if (cancel_flag)
+				error = std::string(func) + ": Cancelled.\n";
+			return false;
+		}
+		if (cached)
+		{
+			std::vector<std::string> paths;
+			for (auto out : outs)
+				paths.push_back(out->path.string());
+			done_jobs.set_done(job, signature, paths);
 		}
 
 		// Default to success.
@@ -625,6 +2593,8 @@ namespace dsp
 	// **** Do combine process.
 	bool dsp_split_combine::do_combine()
 	{
+		process_timer timer(counters);
+
 		// Sanity check inputs
 		if (input.size() < 1)
 		{
@@ -639,8 +2609,7 @@ namespace dsp
 			return false;
 		}
 
-		// Open inputs and sanity check them but also count the total number of channels.
-		int channels = 0;
+		// Open inputs and sanity check them.
 		for (unsigned int i = 0; i < input.size(); ++i)
 		{
 			if (!input[i].file.is_open())
@@ -651,11 +2620,35 @@ namespace dsp
 				error += input[i].file.get_error_str();
 				return false;
 			}
-			int c = input[i].format.get_channels();
-			channels += c;
 		}
 
+		// Set up the routing map.  By default every channel of every input is added in order.
+		active_routes = routes;
+		if (active_routes.empty())
+		{
+			int c = 0;
+			for (unsigned int i = 0; i < input.size(); ++i)
+			{
+				for (int j = 0; j < input[i].format.get_channels(); ++j)
+					active_routes.emplace_back(i, j, 0, c++);
+			}
+		}
+
+		int num_outputs = check_routes("do_combine()");
+		if (num_outputs < 0)
+			return false;
+
+		if (num_outputs != 1)
+		{
+			error = "do_combine(): Routes can only use the first output file.\n";
+			return false;
+		}
+
+		// Total number of channels in the output file.
+		int channels = get_route_channels(0);
+
 		// Open output files.
+		stage_timer metadata(counters.metadata);
 //		for (unsigned int i = 0; i < output.size(); ++i)
 		unsigned int i = 0;
 		{
@@ -670,7 +2663,7 @@ namespace dsp
 			}
 
 			if (output[i].format.get_frames() == 0)
-				output[i].format.set_frames(input[0].format.get_frames());
+				output[i].format.set_frames(get_range_frames(input[0]));
 
 			output[i].format.set_channels(channels);
 
@@ -681,11 +2674,7 @@ namespace dsp
 			int oformat =
 				output[i].file.get_good_sf_format(output[i].path.extension(), output[i].format);//, out_sf_format);
 #endif
-			output[i].file.open(
-				output[i].path, SFM_WRITE,
-				oformat, channels, output[i].format.get_rate());
-
-			if (!output[i].file.is_open())
+			if (!open_output(output[i], oformat, channels, output[i].format.get_rate()))
 			{
 				error = "do_combine(): Could not open output file \"";
 				error += output[i].path.string();
@@ -697,7 +2686,8 @@ namespace dsp
 
 		// Get bext chunk information.
 		dsp::dspbwf bext;
-		input[0].file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
+		if (input[0].file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO)))
+			bext.set_time_reference(bext.get_time_reference() + input[0].range_start);
 
 		// Get text information.
 		std::vector<SF_STRINGS_T> strings;
@@ -708,16 +2698,24 @@ namespace dsp
 				strings.emplace_back(tmp, i);
 		}
 
-		// Set information in output files.
+		// Set bext chunk and text information in output files.
 		for (unsigned int i = 0; i < output.size(); ++i)
-		{
-			// Set bext chunk information for output files.
-			output[i].file.command(SFC_SET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
+			set_output_info(output[i], bext, strings);
+		metadata.stop();
 
-			// Set text information.
-			for (unsigned int j = 0; j < strings.size(); ++j)
-				output[i].file.set_string(strings[j].id, strings[j].str.c_str());
+		// Combine goes on until the longest input used by a route ends.
+		int64_t total = 0;
+		for (auto &r : active_routes)
+		{
+			int64_t frames = get_known_frames(input[r.src_file]);
+			if (frames == 0)
+			{
+				total = 0;
+				break;
+			}
+			total = std::max(total, frames);
 		}
+		start_progress(total);
 
 		// Do the process.
 		switch ((input[0].format.get_bits() + 7) / 8)
@@ -746,6 +2744,17 @@ namespace dsp
 			break;
 		}
 
+		// Finish the output files.  A cancelled combine leaves them short.
+		stage_timer write(counters.write);
+		bool closed = close_outputs("do_combine()");
+		write.stop();
+		if (!closed || cancel_flag)
+		{
+			if (cancel_flag)
+				error = "do_combine(): Cancelled.\n";
+			return false;
+		}
+
 		// Default to success.
 		return true;
 	}
@@ -756,11 +2765,10 @@ namespace dsp
 	// **** Do conversion process.
 	bool dsp_split_combine::do_convert()
 	{
+		process_timer timer(counters);
+
 		// Setup some variables for the conversions.
 		int num_files = input.size();
-		int oformat;
-		dsp::dspbwf bext;
-		std::vector<SF_STRINGS_T> strings;
 		error = "do_convert():\n";
 
 		// Sanity check the input.
@@ -776,101 +2784,174 @@ namespace dsp
 			return false;
 		}
 
-		// loop through all files in the list and do the conversions.
-		// FIXME: Test multi-threading here.  Can we do multiple processes at once?
-		for (int i = 0; i < num_files; ++i)
+		// Convert the files in up to 'convert_workers' tasks on the thread pool.  Each task
+		// takes the next file in the list until there are none left.  The io_uring ring
+		// belongs to the session and can only be driven by one thread.
+		int workers = (convert_workers > 0) ? convert_workers : dsp::get_thread_pool().get_workers();
+		if (io.is_async())
+			workers = 1;
+		workers = std::max(1, std::min(workers, num_files));
+
+		// Progress counts the frames of every file.
+		int64_t total = 0;
+		for (auto &in : input)
 		{
-			// Check that input is open and can be read.
-			if (!input[i].file.is_open())
+			int64_t frames = in.file.is_open() ? get_known_frames(in) : 0;
+			if (in.file.is_open() && frames == 0)
 			{
-				error +=
-					"Error with input file \"" + input[i].path.string() + "\".\n"
-					+ input[i].file.get_error_string() + "\n";
-				continue;
+				total = 0;
+				break;
 			}
+			total += frames;
+		}
+		start_progress(total);
 
-			// Get bext chunk information.
-			bext.clear();
-			input[i].file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
-
-			// Get text information.
-			strings.clear();
-			for (unsigned int j = SF_STR_FIRST; j < SF_STR_LAST; ++j)
+		std::vector<std::string> msgs(num_files);
+		std::atomic<int> next(0);
+		std::atomic<bool> ret(true);
+		auto run = [&]()
+		{
+			for (int i = next++; i < num_files && !cancel_flag; i = next++)
 			{
-				const char *tmp = input[i].file.get_cstring(j);
-				if (tmp)
-					strings.emplace_back(tmp, j);
+				if (!convert_file(i, msgs[i]))
+					ret = false;
 			}
+		};
+
+		running_files = workers;
+		dsp::task_group files;
+		for (int i = 1; i < workers; ++i)
+			files.run(run);
+		run();
+		files.wait();
+		running_files = 1;
+
+		// Files that were not converted yet are skipped.
+		if (cancel_flag)
+		{
+			error = "do_convert(): Cancelled.\n";
+			return false;
+		}
+
+		// Errors are reported in the order of the file list.
+		for (auto &msg : msgs)
+			error += msg;
+		return ret;
+	}
+
+
+	// ********************************
+	// **** Convert input 'i' to output 'i'.  Adds anything that went wrong to 'msg'.
+	// **** Returns false if the output file could not be opened or written.  Runs on the
+	// **** threads of do_convert() so it only touches the files at 'i'.
+	bool dsp_split_combine::convert_file(int i, std::string &msg)
+	{
+		dsp::dspbwf bext;
+		std::vector<SF_STRINGS_T> strings;
+
+		// Check that input is open and can be read.
+		if (!input[i].file.is_open())
+		{
+			msg +=
+				"Error with input file \"" + input[i].path.string() + "\".\n"
+				+ input[i].file.get_error_string() + "\n";
+			return true;
+		}
+
+		// Skip the file when the job cache says its output is up to date.
+		std::string job, signature;
+		bool cached = get_job_signature("convert", { &input[i] }, { &output[i] }, std::vector<route_t>(), job, signature);
+		if (cached && done_jobs.is_done(job, signature))
+		{
+			++counters.jobs_skipped;
+			step_progress(get_known_frames(input[i]));
+			return true;
+		}
+
+		// Get bext chunk information.
+		stage_timer metadata(counters.metadata);
+		if (input[i].file.command(SFC_GET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO)))
+			bext.set_time_reference(bext.get_time_reference() + input[i].range_start);
+
+		// Get text information.
+		for (unsigned int j = SF_STR_FIRST; j < SF_STR_LAST; ++j)
+		{
+			const char *tmp = input[i].file.get_cstring(j);
+			if (tmp)
+				strings.emplace_back(tmp, j);
+		}
 
-			// Setup the output format.
-			out_format = input[i].file.get_dspformat();
-			out_sf_format = input[i].file.get_format();
+		// Setup the output format.
+		dsp::dspformat fmt = input[i].file.get_dspformat();
 
-			output[i].format.set_channels(input[i].format.get_channels());
+		output[i].format.set_channels(input[i].format.get_channels());
+		output[i].format.set_frames(get_range_frames(input[i]));
 
 #if 0//_MSC_VER >= 1900
-			oformat =
-				output[i].file.get_good_sf_format(
-					output[i].path.extension().string(), output[i].format);//, out_sf_format);
+		int oformat =
+			output[i].file.get_good_sf_format(
+				output[i].path.extension().string(), output[i].format);//, out_sf_format);
 #else
-			oformat =
-				output[i].file.get_good_sf_format(
-					output[i].path.extension(), output[i].format);//, out_sf_format);
+		int oformat =
+			output[i].file.get_good_sf_format(
+				output[i].path.extension(), output[i].format);//, out_sf_format);
 #endif
-			// Open the file.
-			output[i].file.open(
-				output[i].path, SFM_WRITE,
-				oformat, out_format.get_channels(), out_format.get_rate());
-
-			// Check that the output file is open.
-			if (!output[i].file.is_open())
-			{
-				error += "Could not open output file \"";
-				error += output[i].path.string();
-				error += "\".\n";
-				error += output[i].file.get_error_str();
-				return false;
-			}
-
-			// Set bext chunk information for output file.
-			output[i].file.command(SFC_SET_BROADCAST_INFO, &bext, sizeof(SF_BROADCAST_INFO));
+		// Open the file.
+		// Check that the output file is open.
+		if (!open_output(output[i], oformat, fmt.get_channels(), fmt.get_rate()))
+		{
+			msg += "Could not open output file \"";
+			msg += output[i].path.string();
+			msg += "\".\n";
+			msg += output[i].file.get_error_str();
+			return false;
+		}
 
-			// Set text information.
-			for (unsigned int j = 0; j < strings.size(); ++j)
-				output[i].file.set_string(strings[j].id, strings[j].str.c_str());
+		// Set bext chunk and text information for output file.
+		set_output_info(output[i], bext, strings);
+		metadata.stop();
 
 
-			// Call convert template function.
-			switch ((input[i].format.get_bits() + 7) / 8)
-			{
-			case 1:
-				convert_template<int8_t, int8_t>(i);
-				break;
-			case 2:
-				convert_template<int16_t, int16_t>(i);
-				break;
-			case 3:
+		// Call convert template function.
+		switch ((input[i].format.get_bits() + 7) / 8)
+		{
+		case 1:
+			convert_template<int8_t, int8_t>(i);
+			break;
+		case 2:
+			convert_template<int16_t, int16_t>(i);
+			break;
+		case 3:
+			convert_template<int32_t, int32_t>(i);
+			break;
+		case 4:
+			if (!input[i].format.is_floats())
 				convert_template<int32_t, int32_t>(i);
-				break;
-			case 4:
-				if (!input[i].format.is_floats())
-					convert_template<int32_t, int32_t>(i);
-				else
-					convert_template<float, float>(i);
-				break;
-			case 8:
-			default:
-				if (!input[i].format.is_floats())
-					convert_template<int64_t, int64_t>(i);
-				else
-					convert_template<double, double>(i);
-				break;
-			}
+			else
+				convert_template<float, float>(i);
+			break;
+		case 8:
+		default:
+			if (!input[i].format.is_floats())
+				convert_template<int64_t, int64_t>(i);
+			else
+				convert_template<double, double>(i);
+			break;
 		}
-		// End of loop. Be sure to wait here for active jobs if multi-threaded...
 
-		// Exit with success.
-		return true;
+		// Finish the output file.
+		std::string close_msg;
+		stage_timer write(counters.write);
+		bool closed = close_output(output[i], close_msg);
+		write.stop();
+		if (!closed)
+			msg += "Error writing output file \"" + output[i].path.string() + "\".\n" + close_msg;
+
+		if (cached && closed && !cancel_flag)
+			done_jobs.set_done(job, signature, std::vector<std::string>(1, output[i].path.string()));
+		else if (cached)
+			done_jobs.forget(job);
+		return closed;
 	}
 	// ********************************
 	// **** End dsp_split_file
@@ -4,10 +4,23 @@
  */
 
 #include "dsp_file.h"
+#include "dsp_mapped_file.h"
+#include "dsp_pcm_writer.h"
+#include "dsp_readahead.h"
+#include "dsp_writebehind.h"
+#include "dsp_io_engine.h"
+#include "dsp_stream_vio.h"
+#include "dsp_probe.h"
 #include "dsp_transpose.h"
+#include "dsp_memory_budget.h"
+#include "dsp_job_cache.h"
 
 #include "cpp-dsp.h"
 
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <filesystem>
 namespace std { using namespace tr2; }
 
@@ -16,6 +29,117 @@ namespace std { using namespace tr2; }
 // **** dsp namespace for dsp classes and functions.
 namespace dsp
 {
+	// ********************************
+	// **** Where the last process spent its time.  Every process is a pipeline of three
+	// **** stages.  Read-ahead threads decode the inputs, the process thread converts
+	// **** and routes the channels and write-behind threads encode the outputs.  Each
+	// **** stage is either busy or waiting on its neighbours.  Times are in nanoseconds
+	// **** and add up over all inputs or outputs.
+	class pipeline_stats
+	{
+	public:
+		enum { read_stage, process_stage, write_stage };
+
+		uint64_t read_ns;				// Reading and decoding the inputs.
+		uint64_t read_wait_ns;			// Read-ahead waiting for room.  The process is slower.
+		uint64_t process_read_wait_ns;	// Process waiting for input.  Reading is slower.
+		uint64_t process_write_wait_ns;	// Process waiting for room to write.  Writing is slower.
+		uint64_t write_ns;				// Encoding and writing the outputs.
+		uint64_t write_wait_ns;			// Write-behind waiting for blocks.
+		double read_fill;				// Average blocks waiting in the read-ahead queues.
+		double write_fill;				// Average blocks waiting in the write-behind queues.
+		int bottleneck;					// The stage the others waited on the most.
+		pipeline_stats() :
+			read_ns(0), read_wait_ns(0), process_read_wait_ns(0), process_write_wait_ns(0),
+			write_ns(0), write_wait_ns(0), read_fill(0.0), write_fill(0.0), bottleneck(process_stage) {}
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** Wall clock and CPU time spent in one stage of a process, in nanoseconds.
+	class stage_time
+	{
+	public:
+		uint64_t wall_ns;
+		uint64_t cpu_ns;
+		stage_time() : wall_ns(0), cpu_ns(0) {}
+	};
+
+	// ********************************
+	// **** Counters for the last (or running) split, combine or convert.  Stage times
+	// **** are taken on the threads that run the process, that is the process thread,
+	// **** the segment workers and the convert workers, and add up over all of them.
+	// **** Reading and writing include the time spent waiting on the read-ahead and
+	// **** write-behind threads, dsp::pipeline_stats tells what those did.  Bytes are
+	// **** counted in the sample format of each file.
+	class process_stats
+	{
+	public:
+		uint64_t frames_read;			// Frames read from all inputs.
+		uint64_t bytes_read;
+		uint64_t frames_written;		// Frames written to all outputs.
+		uint64_t bytes_written;
+		uint64_t blocks;				// Blocks processed.
+		stage_time read;				// Getting frames from the inputs.
+		stage_time convert;				// Converting samples (convert).
+		stage_time transpose;			// Routing channels between interleaved buffers (split and combine).
+		stage_time write;				// Handing frames to the outputs and finishing them.
+		stage_time metadata;			// Opening outputs and copying bext and text information.
+		uint64_t wall_ns;				// Wall clock time of the whole process.
+		uint64_t cpu_ns;				// CPU time of the whole program while the process ran.
+		uint64_t peak_buffer_bytes;		// Most memory held by sample buffers and queues at once.
+		double mb_per_sec;				// Bytes read and written per second, in MB.
+		uint64_t budget_waits;			// Times the process waited for the memory budget.
+		uint64_t budget_shrinks;		// Times it used smaller blocks to fit the memory budget.
+		uint64_t jobs_skipped;			// Files converted or splits skipped by the job cache.
+		process_stats() :
+			frames_read(0), bytes_read(0), frames_written(0), bytes_written(0), blocks(0),
+			wall_ns(0), cpu_ns(0), peak_buffer_bytes(0), mb_per_sec(0.0), budget_waits(0), budget_shrinks(0), jobs_skipped(0) {}
+	};
+	// ********************************
+
+
+	// ********************************
+	// **** Peak and RMS level of each channel, measured from the blocks a split reads.
+	// **** Levels are in full scale, 1.0 is the loudest a sample can be.
+	class channel_levels
+	{
+	public:
+		std::vector<double> peak;
+		std::vector<double> squares;	// Sum of the squared samples.
+		int64_t frames;
+		channel_levels() : frames(0) {}
+
+		void reset(int channels)
+		{
+			peak.assign(channels, 0.0);
+			squares.assign(channels, 0.0);
+			frames = 0;
+		}
+
+		// Add a block of interleaved samples.
+		void add(const float *samples, int channels, int64_t count)
+		{
+			if (channels != (int)peak.size())
+				return;
+			for (int64_t i = 0; i < count; ++i)
+			{
+				for (int c = 0; c < channels; ++c, ++samples)
+				{
+					double s = *samples;
+					peak[c] = std::max(peak[c], std::abs(s));
+					squares[c] += s * s;
+				}
+			}
+			frames += count;
+		}
+
+		double get_rms(int channel) const { return (frames > 0) ? std::sqrt(squares[channel] / frames) : 0.0; }
+	};
+	// ********************************
+
+
 	// ********************************
 	// **** dsp_split_combine - Class to split a file.
 	class dsp_split_combine
@@ -36,7 +160,17 @@ namespace dsp
 		public:
 			std::sys::path	path;
 			dsp::dspformat	format;
+			dsp::stream_vio	stream;			// Open when 'file' reads or writes a pipe.  Must outlive 'file'.
 			dsp::dspfile	file;
+			dsp::mapped_pcm_reader mapped;	// Open when the sample data can be read without libsndfile.
+			dsp::pcm_writer	writer;			// Open when the output is written without libsndfile.
+			dsp::readahead	readahead;		// Running while a process reads this input.
+			dsp::writebehind writebehind;	// Running from the start of a process until the output is closed.
+			std::vector<uint8_t> staging;	// Blocks collected for one large write.  No capacity writes every block.
+			std::string		write_error;	// First write that fell short.  Reported by close_output().
+			int64_t range_start = 0;		// First frame a process reads.
+			int64_t range_length = 0;		// Frames a process reads.  0 reads to the end.
+			int64_t range_left = INT64_MAX;	// Frames left in the range while a process runs.
 			file_description() {}
 			file_description(const char *_name) : path(_name) {}
 			file_description(std::sys::path &_path) : path(_path) {}
@@ -45,12 +179,94 @@ namespace dsp
 				path(_path), file(_file), format(_format) {}
 		};
 
+		// A single entry in the routing map.  All indexes are zero based.
+		class route_t
+		{
+		public:
+			int src_file;	// Index of the input file.
+			int src_ch;		// Channel in the input file.
+			int dst_file;	// Index of the output file.
+			int dst_ch;		// Channel in the output file.
+			route_t(int sf, int sc, int df, int dc) : src_file(sf), src_ch(sc), dst_file(df), dst_ch(dc) {}
+		};
+
 		bool format_override;
 		dsp::dspformat out_format;
 		int out_sf_format;
 
 		std::vector<file_description> input;	// Input files
 		std::vector<file_description> output;	// Output files
+		std::vector<route_t> routes;			// Channel routing map.  Empty means route everything.
+		std::vector<route_t> active_routes;		// Routing map used by the running process.
+		std::vector<int> split_layout;			// Number of channels in each split output file.
+
+		int readahead_depth;					// Blocks read ahead of each input.  0 reads in line.
+		int readahead_frames;					// Frames per read-ahead block.  0 uses the process buffer length.
+		int writebehind_depth;					// Blocks queued behind each output.  0 writes in line.
+		int64_t output_buffer;					// Bytes collected for each output before a write.  0 writes every block.
+		bool parallel_encode;					// Compressed outputs are encoded on their own write-behind threads.
+		int segment_workers;					// Segments of one input processed at once.  0 is one per pool worker, 1 turns it off.
+		int convert_workers;					// Files do_convert() converts at once.  0 is one per pool worker.
+		int running_files;						// Files being processed at once by the running process.
+		int stream_window;						// Ring buffer size in bytes for stream inputs and outputs.
+		bool direct_io;							// Native reader/writer bypass the page cache.
+		int64_t block_frames;					// Frames per processing block.  0 picks it from the cache sizes.
+		std::atomic<int64_t> last_block_frames;	// Frames per block used by the last process.
+		dsp::io_engine io;						// Batches reads and writes of the native reader/writer.
+		dsp::probe_cache probes;				// Header information by path, size and time.  Kept by clear().
+		dsp::job_cache done_jobs;				// Jobs that finished and what they wrote.  Kept by clear().
+
+		std::function<void(int64_t, int64_t)> progress;	// Called after every block.  Can be empty.
+		std::atomic<int64_t> progress_done;		// Frames done by the running process.
+		std::atomic<int64_t> progress_total;	// Frames the running process will do.  0 when it isn't known.
+		std::atomic<bool> cancel_flag;			// Stops the running process after its current block.
+
+		// Fan-out.  Sinks a split feeds from the same blocks as its split outputs.
+		std::vector<file_description> copies;	// Outputs of every channel of the first input.
+		std::vector<std::function<void(const float *, int, int64_t)>> taps;	// Called with every block as floats.
+		bool measure_levels;					// Fill 'levels' while splitting.
+		dsp::channel_levels levels;				// Levels of the first input measured by the last split.
+
+		// Counters behind get_stats().  Updated from every thread of a process.
+		class stage_counter
+		{
+		public:
+			std::atomic<uint64_t> wall_ns, cpu_ns;
+			stage_counter() : wall_ns(0), cpu_ns(0) {}
+		};
+		class stats_counters
+		{
+		public:
+			std::atomic<uint64_t> frames_read, bytes_read, frames_written, bytes_written, blocks;
+			stage_counter read, convert, transpose, write, metadata;
+			std::atomic<int64_t> buffer_bytes, peak_buffer_bytes;
+			std::atomic<uint64_t> budget_waits, budget_shrinks;
+			std::atomic<uint64_t> jobs_skipped;
+			std::atomic<uint64_t> wall_start, cpu_start, wall_ns, cpu_ns;
+			std::atomic<bool> running;
+			stats_counters() { reset(); }
+			void reset();
+		} counters;
+
+		// Adds the time from construction to stop() or destruction to a stage.
+		class stage_timer
+		{
+			stage_counter *stage;
+			uint64_t wall, cpu;
+		public:
+			stage_timer(stage_counter &s);
+			~stage_timer() { stop(); }
+			void stop();
+		};
+
+		// Times a whole process from construction to destruction.
+		class process_timer
+		{
+			stats_counters &c;
+		public:
+			process_timer(stats_counters &_c);
+			~process_timer();
+		};
 
 		// A wide string for passing error information back to a calling process.
 		std::string error;
@@ -79,29 +295,327 @@ namespace dsp
 			int &MediaType,				// 1 = wav, 2 = aif;
 			SF_BROADCAST_INFO &bext
 		);
+		bool add_input_ex64(
+			const char *name,			// Path to and name of file.
+			int &Channels,				// Total number of channels.
+			int &SampleSize,			// Bits per sample.
+			int &FrameSize,				// Size of a single frame of audio (Channels * BytesPerSample).
+			int &SampleRate,			// Sample rate.
+			int &Float,					// True or false.
+			int &ByteOrder,				// Endianness.
+			int64_t &dataOffset,		// File offset of sample data.
+			int64_t &dataSize,			// Size of sample data in bytes.
+			int &HasBWF,				// 0 for no BWF and 1 for has BWF.
+			int &MediaType,				// 1 = wav, 2 = aif;
+			SF_BROADCAST_INFO &bext
+		);
+		// ********************************
+		// **** Same as add_input_ex() without adding the file.  Only reads the header of
+		// **** uncompressed files and remembers it.  set_probe_cache() keeps what was
+		// **** learned in a file so unchanged files are never read again.
+		bool probe_input(
+			const char *name,
+			int &Channels,
+			int &SampleSize,
+			int &FrameSize,
+			int &SampleRate,
+			int &Float,
+			int &ByteOrder,
+			int64_t &dataOffset,
+			int64_t &dataSize,
+			int &HasBWF,
+			int &MediaType,
+			SF_BROADCAST_INFO &bext
+		);
+		bool set_probe_cache(const char *name);
+		bool save_probe_cache();
+
+		// ********************************
+		// **** Job cache.  Converts and splits whose outputs are still as a run with the
+		// **** same inputs and parameters left them are skipped.  Inputs are known by path,
+		// **** size and modification time, and with 'hash' by a hash of their content as
+		// **** well.  The parameters are the output paths and formats, the routes and the
+		// **** input ranges.  Streams and splits with taps always run.  The cache is kept
+		// **** in the file 'name' between runs.  An empty name turns it off.  Returns false
+		// **** if 'name' can't be read or created or the old cache could not be written.
+		// **** get_stats() tells how many jobs were skipped.  The file is also written when
+		// **** the session ends, where a failure can't be reported, so call save_job_cache()
+		// **** first to find out.
+		bool set_job_cache(const char *name, bool hash);
+		bool save_job_cache();
+
 		bool add_input(const char *name, int &channels);					// This function adds an input file and sets 'channels' to the number detected in the input file.
 		bool add_output_path(std::sys::path &path, int fmtcodec, int rate);	// Add full path and file name using filesystem>path.
 		bool add_output(const char *name, int fmtcodec, int rate);			// Add full path and file name using a C string.
 
+		// ********************************
+		// **** Streams.  Reads or writes a pipe, stdin or stdout through a ring buffer of
+		// **** 'window' bytes.  'name' is only used to pick the file type from its extension
+		// **** and in error messages.  Outputs must use a type that doesn't need its header
+		// **** patched after the data is written (raw, au, caf).  Others are refused.
+		bool add_input_stream(int fd, const char *name, int &channels);
+		bool add_output_stream(int fd, const char *name, int fmtcodec, int rate);
+		bool set_stream_window(int window);
+
+		// ********************************
+		// **** Channel routing.  Routes a channel of an input file to a channel of an output file.
+		// **** When no routes are set split and combine route every channel in order.
+		bool add_route(int src_file, int src_ch, int dst_file, int dst_ch);
+		bool clear_routes();
+
+		// ********************************
+		// **** Channel grouping for split.  Each entry is the number of consecutive input
+		// **** channels written to one interleaved output file, e.g. { 2, 2, 6, 1, 1 }.
+		// **** The groups must add up to the channels of the input or the split fails.
+		// **** Ignored when routes are set.  A count of 0 goes back to mono files.
+		bool set_split_layout(const int *groups, int count);
+
+		// ********************************
+		// **** Read-ahead.  Each input is read 'depth' blocks ahead of the process on a
+		// **** background thread.  A depth of 0 turns it off.  A 'block_frames' of 0 uses
+		// **** the same block size as the process.
+		bool set_readahead(int depth, int block_frames);
+		bool get_readahead_stats(int index, dsp::readahead_stats &stats);
+
+		// ********************************
+		// **** Write-behind.  Blocks for each output are queued and written on a background
+		// **** thread so the process only waits when 'depth' blocks are already queued.
+		// **** A depth of 0 turns it off.
+		bool set_writebehind(int depth);
+		bool get_writebehind_stats(int index, dsp::writebehind_stats &stats);
+
+		// ********************************
+		// **** Sums up the read-ahead and write-behind counters of the last process and
+		// **** tells which stage held the others up.
+		bool get_pipeline_stats(dsp::pipeline_stats &stats);
+
+		// ********************************
+		// **** Frames, bytes, stage times, peak buffer memory and speed of the last
+		// **** process.  Can be called while a process runs.
+		bool get_stats(dsp::process_stats &stats);
+
+		// ********************************
+		// **** Output buffer.  Each output collects this many bytes of samples and writes
+		// **** them at once, so outputs that are written side by side still end up in long
+		// **** runs on the disk.  Default is 4MB.  0 writes every block as it comes.
+		bool set_output_buffer(int bytes);
+
+		// ********************************
+		// **** Parallel encoding.  Compressed outputs (FLAC, ALAC, Ogg) are encoded on a
+		// **** thread of their own while the process reads and de-interleaves, so a split
+		// **** to many compressed files uses as many cores as there are files.  On by
+		// **** default.
+		bool set_parallel_encode(bool enable);
+
+		// ********************************
+		// **** Segments.  A long input written to native writer outputs is cut into up to
+		// **** 'workers' ranges of frames that are read, converted and written at the same
+		// **** time, each range by its own thread with its own handle to the input.  The
+		// **** default of 0 uses one per core, 1 processes every file from start to end.
+		bool set_segments(int workers);
+
+		// ********************************
+		// **** Convert workers.  do_convert() converts up to 'workers' files at the same time
+		// **** and returns when all of them are done.  The default of 0 uses one per core,
+		// **** 1 converts one file after another.  Fewer workers suit slow disks and more
+		// **** suit compressed files.  Errors are reported in the order of the file list.
+		bool set_convert_workers(int workers);
+
+		// ********************************
+		// **** Input range.  Split, combine and convert read only 'length' frames of input
+		// **** 'index' starting at 'start', seeking straight to it.  With 'timecode' the
+		// **** start is a bext time reference (samples since midnight) and the file must
+		// **** have a bext chunk.  A length of 0 reads to the end.  The time reference of
+		// **** the outputs moves with the start.
+		bool set_input_range(int index, int64_t start, int64_t length, bool timecode);
+
+		// ********************************
+		// **** I/O engine.  dsp::io_engine::uring queues the writes of every output for a
+		// **** block and sends them to the kernel with one system call on Linux.  Falls
+		// **** back to blocking writes when io_uring isn't available.  get_io_engine()
+		// **** tells which one is really in use.
+		bool set_io_engine(int mode);
+		int get_io_engine();
+
+		// ********************************
+		// **** Block size.  Every process reads, converts and writes this many frames at a
+		// **** time.  The default of 0 works it out from the number of channels, the sample
+		// **** sizes, the read-ahead and write-behind depths and the cache sizes of the
+		// **** machine.  get_block_frames() tells what the last process used.
+		bool set_block_frames(int frames);
+		bool get_block_frames(int &frames);
+
+		// ********************************
+		// **** Direct I/O.  The sample data of memory mapped inputs and native writer outputs
+		// **** is read and written around the page cache so bulk jobs don't push out data
+		// **** other programs are using.  Applies to files added after the call.  Files on
+		// **** file systems that can't do it are read and written normally.
+		bool set_direct_io(bool enable);
+
+		// ********************************
+		// **** Progress and cancel.  'fn' is called with the frames done so far and the
+		// **** total after every block a process writes.  Segments and convert workers
+		// **** call it from their own threads.  The total is 0 for pipes of unknown length.
+		// **** set_cancel(true) may be called from any thread and makes the running process
+		// **** stop after its current block and return false.  Outputs are left as far as
+		// **** they got.  The flag stays set until set_cancel(false) or clear().
+		bool set_progress(std::function<void(int64_t done, int64_t total)> fn);
+		bool get_progress(int64_t &done, int64_t &total);
+		bool set_cancel(bool cancel);
+		bool is_cancelled();
+
+		// ********************************
+		// **** Fan-out.  A split reads and decodes the first input once and hands every
+		// **** block to all of its sinks: the split outputs, every copy output and every
+		// **** tap.  A copy output gets all channels of the input in a format of its own,
+		// **** e.g. a FLAC archive next to a split to mono WAV files.  A tap is called
+		// **** with each block as interleaved floats on the process thread, so it should
+		// **** be quick.  set_levels(true) adds a tap that measures the peak and RMS level
+		// **** of every channel.  do_fanout() is do_split() that only writes split outputs
+		// **** when outputs, routes or a layout were set.  Sinks are kept until
+		// **** clear_fanout() or clear().
+		bool add_copy_output(const char *name, int fmtcodec, int rate);
+		bool add_tap(std::function<void(const float *samples, int channels, int64_t frames)> fn);
+		bool set_levels(bool enable);
+		bool get_levels(int channel, double &peak, double &rms);
+		bool clear_fanout();
+
 		// Functions to process files.
 	private:
+		// Checks the routing map against the inputs and returns the number of output files.
+		int check_routes(const char *func);
+
+		void describe_input(
+			dsp::dspfile &tmp,
+			int &Channels,
+			int &SampleSize,
+			int &FrameSize,
+			int &SampleRate,
+			int &Float,
+			int &ByteOrder,
+			int64_t &dataOffset,
+			int64_t &dataSize,
+			int &HasBWF,
+			int &MediaType,
+			SF_BROADCAST_INFO &bext
+		);
+
+		// Returns the number of channels the routing map sends to output file 'index'.
+		int get_route_channels(int index);
+
+		int64_t pick_block_frames(int64_t in_frame_bytes, int64_t out_frame_bytes);
+
+		// Lease the memory of a process from dsp::get_memory_budget().  Returns the block
+		// size that fits or 0 if the process was cancelled while it waited.  'with_copies'
+		// counts the staging buffers of the copy outputs too.
+		int64_t fit_budget(dsp::memory_budget::lease &mem, int64_t frames, int64_t in_frame_bytes, int64_t out_frame_bytes, const std::vector<int> &outs, bool with_copies = false);
+
+		// Read frames from an input using the read-ahead ring or the memory map when possible.
+		template <typename _Type>
+		int64_t read_input(file_description &in, _Type *ptr, int64_t frames);
+
+		template <typename _Type>
+		int64_t read_direct(file_description &in, _Type *ptr, int64_t frames);
+
+		// Work on the blocks of the read-ahead ring and the write-behind queue in place
+		// when their blocks are as long as the process blocks, else on the buffers given.
+		template <typename _Type>
+		const dsp::sample<_Type> *borrow_input(file_description &in, dsp::sample<_Type> *buffer, int64_t frames, int64_t &got);
+		void return_input(file_description &in);
+
+		template <typename _Type>
+		dsp::sample<_Type> *borrow_output(file_description &out, dsp::sample<_Type> *buffer, int64_t frames);
+
+		template <typename _Type>
+		int64_t put_output(file_description &out, const _Type *ptr, int64_t frames);
+
+		template <typename _Type>
+		void start_readahead(file_description &in, int64_t frames);
+
+		int64_t get_range_frames(file_description &in);
+		int64_t get_known_frames(file_description &in);
+
+		// Progress of the running process.  step_progress() returns false once it is cancelled.
+		void start_progress(int64_t total);
+		bool step_progress(int64_t frames);
+
+		// Counters for get_stats().
+		void count_read(file_description &in, int64_t frames);
+		void count_write(file_description &out, int64_t frames);
+		void use_buffers(int64_t bytes);
+		int64_t get_buffer_bytes(file_description &f);
+		void seek_input(file_description &in);
+
+		// Open an output file, set its metadata, write to it and finish it.  Uncompressed
+		// outputs use the native writer, everything else libsndfile.
+		bool open_output(file_description &out, int oformat, int channels, int rate);
+		static int get_sf_sample_bytes(int sf_format);
+		static bool is_encoded(int sf_format);
+		void set_output_info(file_description &out, dsp::dspbwf &bext, std::vector<SF_STRINGS_T> &strings);
+
+		template <typename _Type>
+		int64_t write_output(file_description &out, const _Type *ptr, int64_t frames);
+
+		template <typename _Type>
+		int64_t flush_output(file_description &out);
+		void write_failed(file_description &out);
+
+		template <typename _Type>
+		int64_t write_block(file_description &out, const _Type *ptr, int64_t frames);
+
 		template <typename _Type>
-		unsigned int get_buffer_length();
+		int64_t write_direct(file_description &out, const _Type *ptr, int64_t frames);
+
+		template <typename _Type>
+		void start_writebehind(file_description &out, int64_t frames);
+
+		bool close_output(file_description &out, std::string &msg);
+		bool close_outputs(const char *func);
+
+		// Key and signature of a job for the job cache.  False when it can't be cached.
+		bool get_job_signature(
+			const char *op, const std::vector<file_description *> &ins, const std::vector<file_description *> &outs,
+			const std::vector<route_t> &job_routes, std::string &job, std::string &signature);
+
+		// True when a split has sinks besides its split outputs.
+		bool has_fanout();
+		bool has_taps();
+		void feed_taps(const float *samples, int channels, int64_t frames);
+
+		// Cut a long input into ranges that are processed at the same time.
+		int get_segments(file_description &in, const std::vector<int> &outs, int64_t frames);
+
+		template <typename _TypeSrc, typename _TypeDst>
+		void segment_template(int index, const std::vector<route_t> &routes, const std::vector<int> &outs, int64_t frames, int segments);
+
+		template <typename _TypeSrc, typename _TypeDst>
+		void segment_worker(int index, const std::vector<route_t> &routes, const std::vector<int> &outs, int64_t start, int64_t count, int64_t frames);
+
+		// do_split() and do_fanout().  Sets up default split outputs when 'split_outputs'
+		// and there are none, otherwise only writes the outputs that were added.
+		bool run_split(const char *func, bool split_outputs);
 
 		template <typename _TypeSrc, typename _TypeDst>
 		void split_template();
 
+		// Split encoded samples byte for byte when no conversion is needed.
+		bool can_split_raw();
+		void split_raw();
+
 		template <typename _TypeSrc, typename _TypeDst>
 		void combine_template();
 
+		bool convert_file(int i, std::string &msg);
+
 		template <typename _TypeSrc, typename _TypeDst>
 		void convert_template(int index);
 
-		// Modifies a path to add " (chX)" into the name.
-		std::sys::path name_output_split(std::sys::path p, int ch);
+		// Modifies a path to add " (chX)" or " (chX-Y)" into the name.
+		std::sys::path name_output_split(std::sys::path p, int ch, int last_ch = 0);
 
 	public:
 		bool do_split();
+		bool do_fanout();
 		bool do_combine();
 		bool do_convert();
 	};